@@ -22,6 +22,7 @@ from envpool.registration import (
   make_spec,
   register,
 )
+from envpool.utils import compute_gae, compute_nstep_return
 
 __version__ = "0.5.4"
 __all__ = [
@@ -31,4 +32,6 @@ __all__ = [
   "make_gym",
   "make_spec",
   "list_all_envs",
+  "compute_gae",
+  "compute_nstep_return",
 ]
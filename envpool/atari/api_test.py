@@ -75,6 +75,25 @@ class _SpecTest(absltest.TestCase):
     )
     self.assertRaises(ValueError, AtariEnvSpec, config)
 
+  def test_multi_task_action_bounds(self) -> None:
+    # pong has 6 actions and breakout has 4
+    specs = [
+      AtariEnvSpec(AtariEnvSpec.gen_config(task=task, num_envs=4))
+      for task in ["pong", "breakout"]
+    ]
+    self.assertRaises(ValueError, AtariGymEnvPool, specs)
+    specs = [
+      AtariEnvSpec(
+        AtariEnvSpec.gen_config(task=task, num_envs=4, full_action_space=True)
+      ) for task in ["pong", "breakout"]
+    ]
+    env = AtariGymEnvPool(specs)
+    self.assertEqual(env.action_space.n, 18)
+    env.reset()
+    for _ in range(10):
+      _, _, _, info = env.step(np.full(4, 17))
+    np.testing.assert_allclose(info["task_id"], [0, 1, 0, 1])
+
   def test_metadata(self) -> None:
     num_envs = 4
     config = AtariEnvSpec.gen_config(task="pong", num_envs=num_envs)
@@ -259,8 +278,14 @@ class _GymSyncTest(absltest.TestCase):
     np.testing.assert_allclose(done.shape, (num_envs,))
     self.assertEqual(done.dtype, np.bool_)
     self.assertIsInstance(info, dict)
-    self.assertEqual(len(info), 5)
+    self.assertEqual(len(info), 11)
     self.assertEqual(info["env_id"].dtype, np.int32)
+    self.assertEqual(info["task_id"].dtype, np.int32)
+    self.assertEqual(info["episode_return"].dtype, np.float32)
+    self.assertEqual(info["episode_length"].dtype, np.int32)
+    self.assertEqual(info["episode_raw_return"].dtype, np.float32)
+    self.assertEqual(info["episode_raw_length"].dtype, np.int32)
+    self.assertEqual(info["env_failed"].dtype, np.bool_)
     self.assertEqual(info["lives"].dtype, np.int32)
     self.assertEqual(info["players"]["env_id"].dtype, np.int32)
     self.assertEqual(info["TimeLimit.truncated"].dtype, np.bool_)
@@ -295,8 +320,14 @@ class _GymSyncTest(absltest.TestCase):
     np.testing.assert_allclose(done.shape, (num_envs,))
     self.assertEqual(done.dtype, np.bool_)
     self.assertIsInstance(info, dict)
-    self.assertEqual(len(info), 5)
+    self.assertEqual(len(info), 11)
     self.assertEqual(info["env_id"].dtype, np.int32)
+    self.assertEqual(info["task_id"].dtype, np.int32)
+    self.assertEqual(info["episode_return"].dtype, np.float32)
+    self.assertEqual(info["episode_length"].dtype, np.int32)
+    self.assertEqual(info["episode_raw_return"].dtype, np.float32)
+    self.assertEqual(info["episode_raw_length"].dtype, np.int32)
+    self.assertEqual(info["env_failed"].dtype, np.bool_)
     self.assertEqual(info["lives"].dtype, np.int32)
     self.assertEqual(info["players"]["env_id"].dtype, np.int32)
     self.assertEqual(info["TimeLimit.truncated"].dtype, np.bool_)
@@ -17,8 +17,6 @@
 #ifndef ENVPOOL_ATARI_ATARI_ENV_H_
 #define ENVPOOL_ATARI_ATARI_ENV_H_
 
-#include <algorithm>
-#include <deque>
 #include <memory>
 #include <random>
 #include <string>
@@ -28,7 +26,9 @@
 #include "ale_interface.hpp"
 #include "envpool/core/async_envpool.h"
 #include "envpool/core/env.h"
-#include "envpool/utils/image_process.h"
+#include "envpool/utils/image_pipeline.h"
+#include "envpool/utils/load_cache.h"
+#include "envpool/utils/simd.h"
 
 namespace atari {
 
@@ -46,6 +46,23 @@ std::string GetRomPath(const std::string& base_path, const std::string& task) {
   return ss.str();
 }
 
+/**
+ * Size of the minimal action set of the given rom. Loading a rom is
+ * expensive, so the result is cached per rom path for the whole process;
+ * the specs of different roms load them concurrently.
+ */
+int GetActionSize(const std::string& rom_path) {
+  static LoadCache<int> cache;
+  return cache.Get(rom_path, [&] {
+    ale::ALEInterface env;
+    env.loadROM(rom_path);
+    return static_cast<int>(env.getMinimalActionSet().size());
+  });
+}
+
+// size of the legal action set of ALE, shared by all the games
+constexpr int kFullActionSize = 18;
+
 class AtariEnvFns {
  public:
   static decltype(auto) DefaultConfig() {
@@ -56,7 +73,8 @@ class AtariEnvFns {
         "reward_clip"_.Bind(false), "img_height"_.Bind(84),
         "img_width"_.Bind(84), "task"_.Bind(std::string("pong")),
         "repeat_action_probability"_.Bind(0.0F),
-        "use_inter_area_resize"_.Bind(true), "gray_scale"_.Bind(true));
+        "use_inter_area_resize"_.Bind(true), "gray_scale"_.Bind(true),
+        "full_action_space"_.Bind(false));
   }
   template <typename Config>
   static decltype(auto) StateSpec(const Config& conf) {
@@ -66,13 +84,16 @@ class AtariEnvFns {
                         {0, 255})),
                     "discount"_.Bind(Spec<float>({-1}, {0.0, 1.0})),
                     "info:lives"_.Bind(Spec<int>({-1}, {0, 5})),
-                    "info:reward"_.Bind(Spec<float>({-1})));
+                    "info:reward"_.Bind(Spec<float>({-1})),
+                    "info:episode_raw_return"_.Bind(Spec<float>({})),
+                    "info:episode_raw_length"_.Bind(Spec<int>({})));
   }
   template <typename Config>
   static decltype(auto) ActionSpec(const Config& conf) {
-    ale::ALEInterface env;
-    env.loadROM(GetRomPath(conf["base_path"_], conf["task"_]));
-    int action_size = env.getMinimalActionSet().size();
+    int action_size =
+        conf["full_action_space"_]
+            ? kFullActionSize
+            : GetActionSize(GetRomPath(conf["base_path"_], conf["task"_]));
     return MakeDict("action"_.Bind(Spec<int>({-1}, {0, action_size - 1})));
   }
 };
@@ -92,10 +113,13 @@ class AtariEnv : public Env<AtariEnvSpec> {
   bool gray_scale_, episodic_life_, use_inter_area_resize_;
   bool done_;
   int lives_;
-  FrameSpec raw_spec_, resize_spec_, transpose_spec_;
-  std::deque<Array> stack_buf_;
+  // unclipped return and length of the whole game, across the lives
+  int raw_length_;
+  float raw_return_;
+  FrameSpec raw_spec_;
   std::vector<Array> maxpool_buf_;
-  Array resize_img_;
+  // resize -> channel first -> frame stack
+  ImagePipeline pipeline_;
   std::uniform_int_distribution<> dist_noop_;
   std::string rom_path_;
 
@@ -114,31 +138,62 @@ class AtariEnv : public Env<AtariEnvSpec> {
         episodic_life_(spec.config["episodic_life"_]),
         use_inter_area_resize_(spec.config["use_inter_area_resize"_]),
         done_(true),
+        raw_length_(0),
+        raw_return_(0),
         raw_spec_({kRawHeight, kRawWidth, gray_scale_ ? 1 : 3}),
-        resize_spec_({spec.config["img_height"_], spec.config["img_width"_],
-                      gray_scale_ ? 1 : 3}),
-        transpose_spec_({gray_scale_ ? 1 : 3, spec.config["img_height"_],
-                         spec.config["img_width"_]}),
-        resize_img_(resize_spec_),
+        pipeline_(kRawHeight, kRawWidth, gray_scale_ ? 1 : 3),
         dist_noop_(0, spec.config["noop_max"_] - 1),
         rom_path_(GetRomPath(spec.config["base_path"_], spec.config["task"_])) {
     env_->setFloat("repeat_action_probability",
                    spec.config["repeat_action_probability"_]);
     env_->setInt("random_seed", seed_);
     env_->loadROM(rom_path_);
-    action_set_ = env_->getMinimalActionSet();
-    for (auto a : action_set_) {
+    // fire reset depends on the game, not on the action space
+    for (auto a : env_->getMinimalActionSet()) {
       if (a == 1) {
         fire_reset_ = true;
       }
     }
-    // init buf
+    action_set_ = spec.config["full_action_space"_]
+                      ? env_->getLegalActionSet()
+                      : env_->getMinimalActionSet();
+    // init buf, from the allocator of the pool that builds this env
     for (int i = 0; i < 2; ++i) {
-      maxpool_buf_.emplace_back(Array(raw_spec_));
-    }
-    for (int i = 0; i < stack_num_; ++i) {
-      stack_buf_.emplace_back(Array(transpose_spec_));
+      maxpool_buf_.emplace_back(Array(raw_spec_, Allocator::Current()));
     }
+    pipeline_
+        .Resize(spec.config["img_height"_], spec.config["img_width"_],
+                use_inter_area_resize_)
+        .ChannelFirst()
+        .Stack(stack_num_);
+  }
+
+  static bool IsHotConfig(const std::string& key) {
+    return key == "max_episode_steps" || key == "frame_skip" ||
+           key == "noop_max" || key == "zero_discount_on_life_loss" ||
+           key == "episodic_life" || key == "reward_clip" ||
+           key == "use_inter_area_resize";
+  }
+
+  void Reconfigure(const Spec& spec) override {
+    Env<AtariEnvSpec>::Reconfigure(spec);
+    max_episode_steps_ = spec.config["max_episode_steps"_];
+    frame_skip_ = spec.config["frame_skip"_];
+    reward_clip_ = spec.config["reward_clip"_];
+    zero_discount_on_life_loss_ = spec.config["zero_discount_on_life_loss"_];
+    episodic_life_ = spec.config["episodic_life"_];
+    use_inter_area_resize_ = spec.config["use_inter_area_resize"_];
+    pipeline_.SetInterArea(use_inter_area_resize_);
+    dist_noop_ =
+        std::uniform_int_distribution<>(0, spec.config["noop_max"_] - 1);
+  }
+
+  void Reseed(int seed) override {
+    Env<AtariEnvSpec>::Reseed(seed);
+    // ALE only reads random_seed when loading the rom
+    env_->setInt("random_seed", seed_);
+    env_->loadROM(rom_path_);
+    elapsed_step_ = max_episode_steps_ + 1;
   }
 
   void Reset() override {
@@ -147,12 +202,16 @@ class AtariEnv : public Env<AtariEnvSpec> {
     if (env_->game_over() || elapsed_step_ >= max_episode_steps_) {
       env_->reset_game();
       elapsed_step_ = 0;
+      raw_length_ = 0;
+      raw_return_ = 0;
       push_all = true;
     }
     while ((noop--) != 0) {
       env_->act(static_cast<ale::Action>(0));
       if (env_->game_over()) {
         env_->reset_game();
+        raw_length_ = 0;
+        raw_return_ = 0;
         push_all = true;
       }
     }
@@ -208,6 +267,8 @@ class AtariEnv : public Env<AtariEnvSpec> {
       discount = 1.0F - static_cast<float>(done_);
     }
     float info_reward = reward;
+    raw_return_ += reward;
+    ++raw_length_;
     if (reward_clip_) {
       if (reward > 0) {
         reward = 1;
@@ -221,6 +282,35 @@ class AtariEnv : public Env<AtariEnvSpec> {
 
   bool IsDone() override { return done_; }
 
+  void Save(SnapshotWriter* writer) override {
+    SaveEnv(writer);
+    // the system state includes the emulator RNG
+    writer->Write(env_->cloneSystemState().serialize());
+    writer->Write(elapsed_step_);
+    writer->Write(done_);
+    writer->Write(lives_);
+    writer->Write(raw_length_);
+    writer->Write(raw_return_);
+    for (const auto& buf : pipeline_.Frames()) {
+      writer->Write(buf);
+    }
+  }
+
+  void Load(SnapshotReader* reader) override {
+    LoadEnv(reader);
+    std::string system_state;
+    reader->Read(&system_state);
+    env_->restoreSystemState(ale::ALEState(system_state));
+    reader->Read(&elapsed_step_);
+    reader->Read(&done_);
+    reader->Read(&lives_);
+    reader->Read(&raw_length_);
+    reader->Read(&raw_return_);
+    for (auto& buf : pipeline_.Frames()) {
+      reader->Read(&buf);
+    }
+  }
+
  private:
   void WriteState(float reward, float discount, float info_reward) {
     State state = Allocate();
@@ -228,68 +318,35 @@ class AtariEnv : public Env<AtariEnvSpec> {
     state["reward"_] = reward;
     state["info:lives"_] = lives_;
     state["info:reward"_] = info_reward;
-    for (int i = 0; i < stack_num_; ++i) {
-      state["obs"_]
-          .Slice(gray_scale_ ? i : i * 3, gray_scale_ ? i + 1 : (i + 1) * 3)
-          .Assign(stack_buf_[i]);
-    }
+    state["info:episode_raw_return"_] = raw_return_;
+    state["info:episode_raw_length"_] = raw_length_;
+    pipeline_.Write(state["obs"_]);
   }
 
   /**
    * FrameStack env wrapper implementation.
    *
-   * The original gray scale image are saved inside maxpool_buf_.
-   * The stacked result is in stack_buf_ where len(stack_buf_) == stack_num_.
+   * The original gray scale image are saved inside maxpool_buf_, and
+   * pipeline_ resizes it and keeps the last stack_num_ frames.
    *
-   * At reset time, we need to clear all data in stack_buf_ with push_all =
-   * true and maxpool = false (there is only one observation); at step time,
-   * we push max(maxpool_buf_[0], maxpool_buf_[1]) at the end of
-   * stack_buf_, and pop the first item in stack_buf_, with push_all = false
-   * and maxpool = true.
+   * At reset time, we need to clear all data in the frame stack with push_all
+   * = true and maxpool = false (there is only one observation); at step time,
+   * we push max(maxpool_buf_[0], maxpool_buf_[1]) at the end of the frame
+   * stack, which drops the oldest frame, with push_all = false and maxpool =
+   * true.
    *
    * @param push_all whether to use the most recent observation to write all
-   *   of the data in stack_buf_.
+   *   of the frame stack.
    * @param maxpool whether to perform maxpool operation on the last two
    *   observation. Maybe there is only one?
    */
   void PushStack(bool push_all, bool maxpool) {
-    auto* ptr = static_cast<uint8_t*>(maxpool_buf_[0].Data());
     if (maxpool) {
-      auto* ptr1 = static_cast<uint8_t*>(maxpool_buf_[1].Data());
-      for (std::size_t i = 0; i < maxpool_buf_[0].size; ++i) {
-        ptr[i] = std::max(ptr[i], ptr1[i]);
-      }
-    }
-    Resize(maxpool_buf_[0], &resize_img_, use_inter_area_resize_);
-    Array tgt = std::move(*stack_buf_.begin());
-    ptr = static_cast<uint8_t*>(tgt.Data());
-    stack_buf_.pop_front();
-    if (gray_scale_) {
-      tgt.Assign(resize_img_);
-    } else {
-      auto* ptr1 = static_cast<uint8_t*>(resize_img_.Data());
-      // tgt = resize_img_.transpose(1, 2, 0)
-      // tgt[i, j, k] = resize_img_[j, k, i]
-      std::size_t h = resize_img_.Shape(0);
-      std::size_t w = resize_img_.Shape(1);
-      for (std::size_t j = 0; j < h; ++j) {
-        for (std::size_t k = 0; k < w; ++k) {
-          for (std::size_t i = 0; i < 3; ++i) {
-            ptr[i * h * w + j * w + k] = ptr1[j * w * 3 + k * 3 + i];
-          }
-        }
-      }
-    }
-    std::size_t size = tgt.size;
-    stack_buf_.push_back(std::move(tgt));
-    if (push_all) {
-      for (auto& s : stack_buf_) {
-        auto* ptr_s = static_cast<uint8_t*>(s.Data());
-        if (ptr != ptr_s) {
-          std::memcpy(ptr_s, ptr, size);
-        }
-      }
+      MaxInplace(static_cast<uint8_t*>(maxpool_buf_[0].Data()),
+                 static_cast<uint8_t*>(maxpool_buf_[1].Data()),
+                 maxpool_buf_[0].size);
     }
+    pipeline_.Push(maxpool_buf_[0], push_all);
   }
 };
 
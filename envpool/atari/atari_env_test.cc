@@ -335,6 +335,50 @@ TEST(AtariEnvTest, ZeroDiscountOnLifeLoss) {
   }
 }
 
+TEST(AtariEnvTest, MultiTaskFullActionSpace) {
+  int batch = 4;
+  // pong has 6 actions and breakout has 4
+  std::vector<atari::AtariEnvSpec> specs;
+  for (const char* task : {"pong", "breakout"}) {
+    auto config = atari::AtariEnvSpec::DEFAULT_CONFIG;
+    config["num_envs"_] = batch;
+    config["task"_] = task;
+    specs.emplace_back(config);
+  }
+  EXPECT_THROW(atari::AtariEnvPool{specs}, std::invalid_argument);
+  for (auto& spec : specs) {
+    auto config = spec.config;
+    config["full_action_space"_] = true;
+    spec = atari::AtariEnvSpec(config);
+  }
+  EXPECT_EQ(std::get<1>(specs[1].action_spec["action"_].bounds),
+            atari::kFullActionSize - 1);
+  atari::AtariEnvPool envpool(specs);
+  Array all_env_ids(Spec<int>({batch}));
+  for (int i = 0; i < batch; ++i) {
+    all_env_ids[i] = i;
+  }
+  envpool.Reset(all_env_ids);
+  std::vector<Array> raw_action(3);
+  AtariAction action(&raw_action);
+  for (int t = 0; t < 20; ++t) {
+    auto state_vec = envpool.Recv();
+    AtariState state(&state_vec);
+    for (int j = 0; j < batch; ++j) {
+      int env_id = state["info:env_id"_][j];
+      EXPECT_EQ(static_cast<int>(state["info:task_id"_][j]), env_id % 2);
+    }
+    action["env_id"_] = state["info:env_id"_];
+    action["players.env_id"_] = state["info:env_id"_];
+    action["action"_] = Array(Spec<int>({batch}));
+    for (int j = 0; j < batch; ++j) {
+      // the last legal action, out of the minimal set of both games
+      action["action"_][j] = atari::kFullActionSize - 1;
+    }
+    envpool.Send(action);
+  }
+}
+
 TEST(AtariEnvSpeedTest, Benchmark) {
   int num_envs = 8;
   int batch = 3;
@@ -0,0 +1,34 @@
+// Copyright 2022 Garena Online Private Limited
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <string>
+
+#include "envpool/atari/atari_env.h"
+#include "envpool/core/workload.h"
+
+using atari::AtariEnvPool;
+
+int main(int argc, char** argv) {
+  int num_steps = argc > 1 ? std::stoi(argv[1]) : 5000;
+  for (std::string task : {"pong", "breakout"}) {
+    auto config = WorkloadConfig<AtariEnvPool>(8);
+    config["task"_] = task;
+    RunWorkload<AtariEnvPool>(task, config, num_steps);
+  }
+  // the RGB path: maxpool and HWC -> CHW transpose on 3 channels
+  auto config = WorkloadConfig<AtariEnvPool>(8);
+  config["gray_scale"_] = false;
+  RunWorkload<AtariEnvPool>("pong (rgb)", config, num_steps);
+  return 0;
+}
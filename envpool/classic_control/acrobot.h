@@ -88,6 +88,20 @@ class AcrobotEnv : public Env<AcrobotEnvSpec> {
 
   bool IsDone() override { return done_; }
 
+  void Save(SnapshotWriter* writer) override {
+    SaveEnv(writer);
+    writer->Write(elapsed_step_);
+    writer->Write(done_);
+    writer->Write(s_);
+  }
+
+  void Load(SnapshotReader* reader) override {
+    LoadEnv(reader);
+    reader->Read(&elapsed_step_);
+    reader->Read(&done_);
+    reader->Read(&s_);
+  }
+
   void Reset() override {
     s_.s0 = dist_(gen_);
     s_.s1 = dist_(gen_);
@@ -170,7 +184,7 @@ class AcrobotEnv : public Env<AcrobotEnvSpec> {
   }
 
   void WriteState(float reward) {
-    State state = Allocate();
+    auto state = AllocateRecord();
     state["obs"_][0] = static_cast<float>(std::cos(s_.s0));
     state["obs"_][1] = static_cast<float>(std::sin(s_.s0));
     state["obs"_][2] = static_cast<float>(std::cos(s_.s1));
@@ -77,6 +77,26 @@ class CartPoleEnv : public Env<CartPoleEnvSpec> {
 
   bool IsDone() override { return done_; }
 
+  void Save(SnapshotWriter* writer) override {
+    SaveEnv(writer);
+    writer->Write(elapsed_step_);
+    writer->Write(done_);
+    writer->Write(x_);
+    writer->Write(x_dot_);
+    writer->Write(theta_);
+    writer->Write(theta_dot_);
+  }
+
+  void Load(SnapshotReader* reader) override {
+    LoadEnv(reader);
+    reader->Read(&elapsed_step_);
+    reader->Read(&done_);
+    reader->Read(&x_);
+    reader->Read(&x_dot_);
+    reader->Read(&theta_);
+    reader->Read(&theta_dot_);
+  }
+
   void Reset() override {
     x_ = dist_(gen_);
     x_dot_ = dist_(gen_);
@@ -114,7 +134,7 @@ class CartPoleEnv : public Env<CartPoleEnvSpec> {
 
  private:
   void WriteState(float reward) {
-    State state = Allocate();
+    auto state = AllocateRecord();
     state["obs"_][0] = static_cast<float>(x_);
     state["obs"_][1] = static_cast<float>(x_dot_);
     state["obs"_][2] = static_cast<float>(theta_);
@@ -0,0 +1,40 @@
+// Copyright 2022 Garena Online Private Limited
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <string>
+
+#include "envpool/classic_control/acrobot.h"
+#include "envpool/classic_control/cartpole.h"
+#include "envpool/classic_control/mountain_car_continuous.h"
+#include "envpool/classic_control/pendulum.h"
+#include "envpool/core/workload.h"
+
+using classic_control::AcrobotEnvPool;
+using classic_control::CartPoleEnvPool;
+using classic_control::MountainCarContinuousEnvPool;
+using classic_control::PendulumEnvPool;
+
+int main(int argc, char** argv) {
+  int num_steps = argc > 1 ? std::stoi(argv[1]) : 100000;
+  RunWorkload<CartPoleEnvPool>(
+      "CartPole-v1", WorkloadConfig<CartPoleEnvPool>(8), num_steps);
+  RunWorkload<PendulumEnvPool>(
+      "Pendulum-v1", WorkloadConfig<PendulumEnvPool>(8), num_steps);
+  RunWorkload<AcrobotEnvPool>(
+      "Acrobot-v1", WorkloadConfig<AcrobotEnvPool>(8), num_steps);
+  RunWorkload<MountainCarContinuousEnvPool>(
+      "MountainCarContinuous-v0",
+      WorkloadConfig<MountainCarContinuousEnvPool>(8), num_steps);
+  return 0;
+}
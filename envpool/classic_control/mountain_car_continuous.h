@@ -69,6 +69,22 @@ class MountainCarContinuousEnv : public Env<MountainCarContinuousEnvSpec> {
 
   bool IsDone() override { return done_; }
 
+  void Save(SnapshotWriter* writer) override {
+    SaveEnv(writer);
+    writer->Write(elapsed_step_);
+    writer->Write(done_);
+    writer->Write(pos_);
+    writer->Write(vel_);
+  }
+
+  void Load(SnapshotReader* reader) override {
+    LoadEnv(reader);
+    reader->Read(&elapsed_step_);
+    reader->Read(&done_);
+    reader->Read(&pos_);
+    reader->Read(&vel_);
+  }
+
   void Reset() override {
     pos_ = dist_(gen_);
     vel_ = 0.0;
@@ -110,7 +126,7 @@ class MountainCarContinuousEnv : public Env<MountainCarContinuousEnvSpec> {
 
  private:
   void WriteState(float reward) {
-    State state = Allocate();
+    auto state = AllocateRecord();
     state["obs"_][0] = static_cast<float>(pos_);
     state["obs"_][1] = static_cast<float>(vel_);
     state["reward"_] = reward;
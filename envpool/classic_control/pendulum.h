@@ -68,6 +68,22 @@ class PendulumEnv : public Env<PendulumEnvSpec> {
 
   bool IsDone() override { return done_; }
 
+  void Save(SnapshotWriter* writer) override {
+    SaveEnv(writer);
+    writer->Write(elapsed_step_);
+    writer->Write(done_);
+    writer->Write(theta_);
+    writer->Write(theta_dot_);
+  }
+
+  void Load(SnapshotReader* reader) override {
+    LoadEnv(reader);
+    reader->Read(&elapsed_step_);
+    reader->Read(&done_);
+    reader->Read(&theta_);
+    reader->Read(&theta_dot_);
+  }
+
   void Reset() override {
     theta_ = dist_(gen_);
     theta_dot_ = dist_dot_(gen_);
@@ -101,7 +117,7 @@ class PendulumEnv : public Env<PendulumEnvSpec> {
 
  private:
   void WriteState(float reward) {
-    State state = Allocate();
+    auto state = AllocateRecord();
     state["obs"_][0] = static_cast<float>(std::cos(theta_));
     state["obs"_][1] = static_cast<float>(std::sin(theta_));
     state["obs"_][2] = static_cast<float>(theta_dot_);
@@ -0,0 +1,202 @@
+/*
+ * Copyright 2022 Garena Online Private Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ENVPOOL_CORE_ALLOCATOR_H_
+#define ENVPOOL_CORE_ALLOCATOR_H_
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <string>
+
+/**
+ * How the allocator backs large buffers with huge pages.
+ * - kNone: plain aligned heap memory;
+ * - kTransparent: anonymous mmap + madvise(MADV_HUGEPAGE), the kernel
+ *   promotes the range to transparent huge pages when it can;
+ * - kExplicit: mmap with MAP_HUGETLB from the reserved hugetlbfs pool, which
+ *   falls back to kTransparent when the pool is empty.
+ */
+enum class HugePage { kNone, kTransparent, kExplicit };
+
+inline HugePage ParseHugePage(const std::string& mode) {
+  if (mode == "none") {
+    return HugePage::kNone;
+  }
+  if (mode == "transparent") {
+    return HugePage::kTransparent;
+  }
+  if (mode == "explicit") {
+    return HugePage::kExplicit;
+  }
+  throw std::invalid_argument("Unknown huge page mode " + mode +
+                              ", should be none, transparent or explicit.");
+}
+
+struct AllocatorOptions {
+  // power of two, at least alignof(std::max_align_t)
+  std::size_t alignment = 64;
+  HugePage huge_page = HugePage::kNone;
+  // zero the memory; it is free for mmap-backed memory
+  bool zero_fill = true;
+  // touch every page at allocation, so that the first step doesn't fault
+  bool prefault = false;
+};
+
+/**
+ * Allocator of the state buffers and env-owned arrays. It is shared by one
+ * env pool, and counts what it hands out for `AsyncEnvPool::Stats`.
+ */
+class Allocator {
+ public:
+  static constexpr std::size_t kHugePageSize = 2 << 20;
+
+  struct Stats {
+    uint64_t num_alloc;
+    uint64_t bytes;
+    // allocations backed by (transparent or explicit) huge pages
+    uint64_t num_huge_page;
+    // MAP_HUGETLB requests that fell back to transparent huge pages
+    uint64_t num_huge_page_fallback;
+  };
+
+ protected:
+  AllocatorOptions options_;
+  std::atomic<uint64_t> num_alloc_{0}, bytes_{0}, num_huge_page_{0},
+      num_huge_page_fallback_{0};
+
+  static void Prefault(char* data, std::size_t size) {
+    static const auto kPageSize = static_cast<std::size_t>(getpagesize());
+    for (std::size_t i = 0; i < size; i += kPageSize) {
+      // the content is either zero or unspecified, any write will do
+      static_cast<volatile char*>(data)[i] = 0;
+    }
+  }
+
+  std::shared_ptr<char> AllocateHeap(std::size_t size) {
+    std::size_t alignment = options_.alignment;
+    // operator new rejects a size that isn't a multiple of alignment on some
+    // platforms, so round it up
+    size = (std::max<std::size_t>(size, 1) + alignment - 1) / alignment *
+           alignment;
+    auto* data =
+        static_cast<char*>(::operator new[](size, std::align_val_t(alignment)));
+    if (options_.zero_fill) {
+      std::memset(data, 0, size);
+    } else if (options_.prefault) {
+      Prefault(data, size);
+    }
+    return {data, [alignment](char* p) {
+              ::operator delete[](p, std::align_val_t(alignment));
+            }};
+  }
+
+  std::shared_ptr<char> AllocateMmap(std::size_t size, bool hugetlb) {
+    size = (size + kHugePageSize - 1) / kHugePageSize * kHugePageSize;
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+    void* ptr = MAP_FAILED;
+    if (hugetlb) {
+      ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, flags | MAP_HUGETLB,
+                 -1, 0);
+      if (ptr == MAP_FAILED) {
+        ++num_huge_page_fallback_;
+      }
+    }
+    if (ptr == MAP_FAILED) {
+      ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, flags, -1, 0);
+      if (ptr == MAP_FAILED) {
+        throw std::bad_alloc();
+      }
+      // advisory only, a kernel without THP keeps the regular pages
+      madvise(ptr, size, MADV_HUGEPAGE);
+    }
+    // not MAP_POPULATE: it would fault the pages in before madvise
+    if (options_.prefault) {
+      Prefault(static_cast<char*>(ptr), size);
+    }
+    // anonymous mappings are zero-filled by the kernel
+    return {static_cast<char*>(ptr), [size](char* p) { munmap(p, size); }};
+  }
+
+ public:
+  explicit Allocator(AllocatorOptions options = {}) : options_(options) {
+    if (options_.alignment < alignof(std::max_align_t) ||
+        (options_.alignment & (options_.alignment - 1)) != 0) {
+      throw std::invalid_argument(
+          "Allocator alignment should be a power of two no less than " +
+          std::to_string(alignof(std::max_align_t)) + ", got " +
+          std::to_string(options_.alignment) + ".");
+    }
+  }
+
+  [[nodiscard]] const AllocatorOptions& Options() const { return options_; }
+
+  /**
+   * Allocate `size` bytes aligned to at least `Options().alignment`. Huge
+   * pages are only used for buffers of at least half a huge page, smaller
+   * ones would waste most of the page.
+   */
+  std::shared_ptr<char> Allocate(std::size_t size) {
+    ++num_alloc_;
+    bytes_ += size;
+    if (options_.huge_page == HugePage::kNone || size < kHugePageSize / 2) {
+      return AllocateHeap(size);
+    }
+    ++num_huge_page_;
+    return AllocateMmap(size, options_.huge_page == HugePage::kExplicit);
+  }
+
+  [[nodiscard]] Stats GetStats() const {
+    return Stats{num_alloc_.load(), bytes_.load(), num_huge_page_.load(),
+                 num_huge_page_fallback_.load()};
+  }
+
+  /**
+   * The allocator that `Array(spec, Allocator::Current())` should use on this
+   * thread. The env pool installs its own with `Scope` while constructing the
+   * envs, so that env-owned buffers go through it as well. Null means the
+   * default `new char[]()`.
+   */
+  static Allocator*& Current() {
+    static thread_local Allocator* current = nullptr;
+    return current;
+  }
+
+  /**
+   * RAII guard that installs an allocator as `Current()` on this thread.
+   */
+  class Scope {
+    Allocator* prev_;
+
+   public:
+    explicit Scope(Allocator* allocator) : prev_(Current()) {
+      Current() = allocator;
+    }
+    ~Scope() { Current() = prev_; }
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+  };
+};
+
+#endif  // ENVPOOL_CORE_ALLOCATOR_H_
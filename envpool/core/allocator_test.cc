@@ -0,0 +1,96 @@
+// Copyright 2022 Garena Online Private Limited
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "envpool/core/allocator.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+TEST(AllocatorTest, Aligned) {
+  for (std::size_t alignment : {16, 64, 4096}) {
+    AllocatorOptions options;
+    options.alignment = alignment;
+    Allocator allocator(options);
+    for (std::size_t size : {1, 100, 10000}) {
+      auto ptr = allocator.Allocate(size);
+      EXPECT_EQ(reinterpret_cast<uintptr_t>(ptr.get()) % alignment, 0);
+      for (std::size_t i = 0; i < size; ++i) {
+        EXPECT_EQ(ptr.get()[i], 0);
+      }
+    }
+  }
+  AllocatorOptions options;
+  options.alignment = 96;
+  EXPECT_THROW(Allocator{options}, std::invalid_argument);
+  EXPECT_THROW(ParseHugePage("always"), std::invalid_argument);
+}
+
+TEST(AllocatorTest, HugePage) {
+  for (auto mode : {HugePage::kTransparent, HugePage::kExplicit}) {
+    AllocatorOptions options;
+    options.huge_page = mode;
+    options.prefault = true;
+    Allocator allocator(options);
+    // small buffers stay on the heap
+    auto small = allocator.Allocate(4096);
+    EXPECT_EQ(allocator.GetStats().num_huge_page, 0);
+    std::size_t size = Allocator::kHugePageSize + 1;
+    auto large = allocator.Allocate(size);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(large.get()) % 64, 0);
+    EXPECT_EQ(large.get()[0], 0);
+    EXPECT_EQ(large.get()[size - 1], 0);
+    large.get()[size - 1] = 1;
+    auto stats = allocator.GetStats();
+    EXPECT_EQ(stats.num_alloc, 2);
+    EXPECT_EQ(stats.bytes, 4096 + size);
+    EXPECT_EQ(stats.num_huge_page, 1);
+    if (mode == HugePage::kTransparent) {
+      EXPECT_EQ(stats.num_huge_page_fallback, 0);
+    }
+  }
+}
+
+TEST(AllocatorTest, NoZeroFill) {
+  AllocatorOptions options;
+  options.zero_fill = false;
+  options.prefault = true;
+  Allocator allocator(options);
+  std::vector<std::shared_ptr<char>> ptrs;
+  for (int i = 0; i < 10; ++i) {
+    ptrs.push_back(allocator.Allocate(100000));
+    ptrs.back().get()[99999] = 1;
+  }
+  EXPECT_EQ(allocator.GetStats().num_alloc, 10);
+  EXPECT_EQ(allocator.GetStats().bytes, 1000000);
+}
+
+TEST(AllocatorTest, Scope) {
+  Allocator allocator;
+  EXPECT_EQ(Allocator::Current(), nullptr);
+  {
+    Allocator::Scope scope(&allocator);
+    EXPECT_EQ(Allocator::Current(), &allocator);
+    Allocator inner;
+    {
+      Allocator::Scope inner_scope(&inner);
+      EXPECT_EQ(Allocator::Current(), &inner);
+    }
+    EXPECT_EQ(Allocator::Current(), &allocator);
+  }
+  EXPECT_EQ(Allocator::Current(), nullptr);
+}
@@ -25,6 +25,7 @@
 #include <utility>
 #include <vector>
 
+#include "envpool/core/allocator.h"
 #include "envpool/core/spec.h"
 
 class Array {
@@ -70,6 +71,14 @@ class Array {
   Array(const ShapeSpec& spec, char* data)
       : Array(data, spec.Shape(), spec.element_size, [](char* /*unused*/) {}) {}
 
+  /**
+   * Constructor an `Array` of shape defined by `spec` on the memory of `ptr`,
+   * which is shared with (and kept alive by) the other owners of `ptr`, e.g.,
+   * an aliasing pointer into a larger arena.
+   */
+  Array(const ShapeSpec& spec, std::shared_ptr<char> ptr)
+      : Array(std::move(ptr), spec.Shape(), spec.element_size) {}
+
   /**
    * Constructor an `Array` of shape defined by `spec`. This constructor
    * allocates and owns the memory.
@@ -80,6 +89,20 @@ class Array {
                [](const char* p) { delete[] p; });
   }
 
+  /**
+   * Constructor an `Array` of shape defined by `spec` on the memory from
+   * `allocator`, or the same as `Array(spec)` if it is null.
+   */
+  Array(const ShapeSpec& spec, Allocator* allocator)
+      : Array(spec, nullptr, [](char* /*unused*/) {}) {
+    if (allocator == nullptr) {
+      ptr_.reset(new char[size * element_size](),
+                 [](const char* p) { delete[] p; });
+    } else {
+      ptr_ = allocator->Allocate(size * element_size);
+    }
+  }
+
   /**
    * Take multidimensional index into the Array.
    */
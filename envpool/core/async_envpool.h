@@ -19,17 +19,33 @@
 
 #include <algorithm>
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
 #include <thread>
+#include <tuple>
 #include <utility>
 #include <vector>
 
+#include <glog/logging.h>
+
 #include "ThreadPool.h"
 #include "envpool/core/action_buffer_queue.h"
+#include "envpool/core/allocator.h"
 #include "envpool/core/array.h"
 #include "envpool/core/envpool.h"
+#include "envpool/core/episode_stats.h"
+#include "envpool/core/normalizer.h"
+#include "envpool/core/policy.h"
+#include "envpool/core/snapshot.h"
 #include "envpool/core/spec.h"
 #include "envpool/core/state_buffer_queue.h"
+#include "envpool/core/trajectory_writer.h"
 /**
  * Async EnvPool
  *
@@ -41,18 +57,77 @@
 template <typename Env>
 class AsyncEnvPool : public EnvPool<typename Env::Spec> {
  protected:
-  std::size_t num_envs_;
+  std::size_t num_envs_, max_num_envs_;
   std::size_t batch_;
   std::size_t max_num_players_;
   std::size_t num_threads_;
-  bool is_sync_;
+  bool is_sync_, lazy_init_;
   std::atomic<int> stop_;
   std::atomic<std::size_t> stepping_env_num_;
   std::vector<std::thread> workers_;
+  // backs the state buffers and the env-owned arrays, declared before the
+  // state buffer queues since their background threads allocate from it
+  std::unique_ptr<Allocator> allocator_;
   std::unique_ptr<ActionBufferQueue> action_buffer_queue_;
   std::unique_ptr<StateBufferQueue> state_buffer_queue_;
+  // shared by the envs, null if neither norm_obs nor norm_reward is set
+  std::unique_ptr<Normalizer> normalizer_;
+  // recent finished episodes, null if episode_window is 0
+  std::unique_ptr<EpisodeStats> episode_stats_;
+  // record layout and one writer per worker, empty without trajectory_dir
+  std::unique_ptr<TrajectoryLayout> trajectory_layout_;
+  std::vector<std::unique_ptr<TrajectoryWriter>> trajectory_writers_;
   std::vector<std::unique_ptr<Env>> envs_;
   std::vector<std::atomic<int>> stepping_env_;
+  // set by each worker thread once it has left RunWorker, see StartWorker
+  std::vector<std::shared_ptr<std::atomic<bool>>> worker_returned_;
+  // a worker replaced by Restart and the env of its hung step, which may
+  // still be running: the thread can only be joined once `returned` is set
+  struct AbandonedWorker {
+    std::thread thread;
+    std::shared_ptr<std::atomic<bool>> returned;
+    std::unique_ptr<Env> env;
+  };
+  // the watchdog of step_timeout: env id, start time and id (0 if idle) of
+  // the step run by each worker, the envs that must reset after being
+  // rebuilt, and the replaced workers
+  double step_timeout_;
+  std::atomic<uint64_t> step_count_;
+  std::vector<std::atomic<int>> worker_env_;
+  std::vector<std::atomic<int64_t>> worker_start_;
+  std::vector<std::atomic<uint64_t>> worker_step_;
+  std::vector<std::atomic<int>> restart_pending_;
+  std::vector<AbandonedWorker> abandoned_;
+  std::atomic<uint64_t> restart_count_, restart_us_;
+  std::mutex watchdog_mutex_;
+  std::condition_variable watchdog_cv_;
+  std::thread watchdog_;
+  // only accessed from the caller side (Send / Reset / AddEnvs / RemoveEnvs)
+  std::vector<bool> env_alive_;
+  // written by the workers with lazy_init
+  std::vector<std::atomic<double>> env_init_time_;
+  // one spec per task, env i is built from task_specs_[i % num_tasks]
+  std::vector<typename Env::Spec> task_specs_;
+  // latest specs handed to the envs, see Reconfigure. Each spec is owned by
+  // a shared_ptr so that the envs share it instead of keeping a copy.
+  using SpecList = std::vector<std::shared_ptr<const typename Env::Spec>>;
+  std::mutex config_mutex_;
+  std::shared_ptr<const SpecList> config_specs_;
+  std::atomic<int> config_version_;
+  std::vector<int> env_config_version_;
+  // seeds set by Reseed, guarded by config_mutex_ and applied at next reset
+  std::vector<std::atomic<int>> reseed_pending_;
+  std::vector<int> reseed_value_;
+  // for Branch: scratch envs of each task, their config version, the pool
+  // that steps them and the state buffer queue that collects the children
+  std::vector<std::vector<std::unique_ptr<Env>>> scratch_envs_;
+  std::vector<int> scratch_config_version_;
+  std::unique_ptr<ThreadPool> branch_pool_;
+  std::unique_ptr<StateBufferQueue> branch_sbq_;
+  std::size_t branch_num_;
+  // the policy of the last RunPolicy from a library, and its path and arg
+  std::unique_ptr<PolicyLibrary> policy_library_;
+  std::string policy_path_, policy_arg_;
   std::chrono::duration<double> dur_send_, dur_recv_, dur_send_all_;
 
  public:
@@ -62,63 +137,111 @@ class AsyncEnvPool : public EnvPool<typename Env::Spec> {
   using ActionSlice = typename ActionBufferQueue::ActionSlice;
 
   explicit AsyncEnvPool(const Spec& spec)
-      : EnvPool<Spec>(spec),
-        num_envs_(spec.config["num_envs"_]),
-        batch_(spec.config["batch_size"_] <= 0 ? num_envs_
-                                               : spec.config["batch_size"_]),
-        max_num_players_(spec.config["max_num_players"_]),
-        num_threads_(spec.config["num_threads"_]),
+      : AsyncEnvPool(std::vector<Spec>{spec}) {}
+
+  /**
+   * Multi-task pool, env i is built from `specs[i % specs.size()]`. All the
+   * specs must share the common (pool-level) config and the shape of each
+   * state / action, so that the envs can share one worker set and one state
+   * buffer. The state `info:task_id` tells which spec an env is built from.
+   */
+  explicit AsyncEnvPool(const std::vector<Spec>& specs)
+      : EnvPool<Spec>(CheckTaskSpecs(specs)),
+        num_envs_(this->spec_.config["num_envs"_]),
+        max_num_envs_(this->spec_.config["max_num_envs"_] <= 0
+                          ? num_envs_
+                          : this->spec_.config["max_num_envs"_]),
+        batch_(this->spec_.config["batch_size"_] <= 0
+                   ? num_envs_
+                   : this->spec_.config["batch_size"_]),
+        max_num_players_(this->spec_.config["max_num_players"_]),
+        num_threads_(this->spec_.config["num_threads"_]),
         is_sync_(batch_ == num_envs_ && max_num_players_ == 1),
+        lazy_init_(this->spec_.config["lazy_init"_]),
         stop_(0),
         stepping_env_num_(0),
-        action_buffer_queue_(new ActionBufferQueue(num_envs_)),
-        state_buffer_queue_(new StateBufferQueue(
-            batch_, num_envs_, max_num_players_,
-            spec.state_spec.template AllValues<ShapeSpec>())),
-        envs_(num_envs_) {
+        allocator_(new Allocator(MakeAllocatorOptions(this->spec_))),
+        action_buffer_queue_(new ActionBufferQueue(max_num_envs_)),
+        state_buffer_queue_(MakeStateBufferQueue()),
+        normalizer_(Normalizer::Enabled(this->spec_)
+                        ? new Normalizer(this->spec_)
+                        : nullptr),
+        episode_stats_(this->spec_.config["episode_window"_] > 0
+                           ? new EpisodeStats(
+                                 this->spec_.config["episode_window"_])
+                           : nullptr),
+        envs_(max_num_envs_),
+        stepping_env_(max_num_envs_),
+        step_timeout_(this->spec_.config["step_timeout"_]),
+        step_count_(0),
+        restart_pending_(max_num_envs_),
+        restart_count_(0),
+        restart_us_(0),
+        env_alive_(max_num_envs_),
+        env_init_time_(max_num_envs_),
+        task_specs_(specs),
+        config_specs_(ShareSpecs(specs)),
+        config_version_(0),
+        env_config_version_(max_num_envs_),
+        reseed_pending_(max_num_envs_),
+        reseed_value_(max_num_envs_),
+        scratch_envs_(specs.size()),
+        scratch_config_version_(specs.size(), -1),
+        branch_num_(0) {
+    std::fill(env_alive_.begin(), env_alive_.begin() + num_envs_, true);
     std::size_t processor_count = std::thread::hardware_concurrency();
-    ThreadPool init_pool(std::min(processor_count, num_envs_));
-    std::vector<std::future<void>> result;
-    for (std::size_t i = 0; i < num_envs_; ++i) {
-      result.emplace_back(init_pool.enqueue(
-          [i, spec, this] { envs_[i].reset(new Env(spec, i)); }));
-    }
-    for (auto& f : result) {
-      f.get();
+    if (!lazy_init_) {
+      ThreadPool init_pool(std::min(processor_count, num_envs_));
+      std::vector<std::future<void>> result;
+      for (std::size_t i = 0; i < num_envs_; ++i) {
+        result.emplace_back(init_pool.enqueue([i, this] { InitEnv(i); }));
+      }
+      for (auto& f : result) {
+        f.get();
+      }
     }
     if (num_threads_ == 0) {
       num_threads_ = batch_;
     }
+    const std::string& trajectory_dir = this->spec_.config["trajectory_dir"_];
+    if (!trajectory_dir.empty()) {
+      trajectory_layout_ = std::make_unique<TrajectoryLayout>(this->spec_);
+      TrajectoryWriter::WriteMeta(*trajectory_layout_, trajectory_dir);
+      std::size_t shard_bytes =
+          static_cast<std::size_t>(this->spec_.config["trajectory_shard_mb"_])
+          << 20;
+      for (std::size_t i = 0; i < num_threads_; ++i) {
+        trajectory_writers_.push_back(std::make_unique<TrajectoryWriter>(
+            trajectory_layout_.get(), trajectory_dir, i, shard_bytes));
+      }
+    }
+    if (step_timeout_ > 0) {
+      worker_env_ = std::vector<std::atomic<int>>(num_threads_);
+      worker_start_ = std::vector<std::atomic<int64_t>>(num_threads_);
+      worker_step_ = std::vector<std::atomic<uint64_t>>(num_threads_);
+    }
+    workers_.resize(num_threads_);
+    worker_returned_.resize(num_threads_);
     for (std::size_t i = 0; i < num_threads_; ++i) {
-      workers_.emplace_back([this] {
-        for (;;) {
-          ActionSlice raw_action = action_buffer_queue_->Dequeue();
-          if (stop_ == 1) {
-            break;
-          }
-          int env_id = raw_action.env_id;
-          int order = raw_action.order;
-          bool reset = raw_action.force_reset || envs_[env_id]->IsDone();
-          envs_[env_id]->EnvStep(state_buffer_queue_.get(), order, reset);
-        }
-      });
+      StartWorker(i);
     }
-    if (spec.config["thread_affinity_offset"_] >= 0) {
-      std::size_t thread_affinity_offset =
-          spec.config["thread_affinity_offset"_];
-      for (std::size_t tid = 0; tid < num_threads_; ++tid) {
-        cpu_set_t cpuset;
-        CPU_ZERO(&cpuset);
-        std::size_t cid = (thread_affinity_offset + tid) % processor_count;
-        CPU_SET(cid, &cpuset);
-        pthread_setaffinity_np(workers_[tid].native_handle(), sizeof(cpu_set_t),
-                               &cpuset);
-      }
+    for (std::size_t i = 0; i < num_threads_; ++i) {
+      SetAffinity(i);
+    }
+    if (step_timeout_ > 0) {
+      watchdog_ = std::thread([this] { RunWatchdog(); });
     }
   }
 
   ~AsyncEnvPool() {
-    stop_ = 1;
+    {
+      std::lock_guard<std::mutex> lock(watchdog_mutex_);
+      stop_ = 1;
+    }
+    if (watchdog_.joinable()) {
+      watchdog_cv_.notify_all();
+      watchdog_.join();
+    }
     // LOG(INFO) << "envpool send: " << dur_send_.count();
     // LOG(INFO) << "envpool recv: " << dur_recv_.count();
     // send n actions to clear threadpool
@@ -127,6 +250,504 @@ class AsyncEnvPool : public EnvPool<typename Env::Spec> {
     for (auto& worker : workers_) {
       worker.join();
     }
+    // destroy envs in parallel, some of them (e.g. vizdoom) need to wait for
+    // a subprocess to exit
+    std::size_t processor_count = std::thread::hardware_concurrency();
+    ThreadPool release_pool(std::min(processor_count, max_num_envs_));
+    std::vector<std::future<void>> result;
+    for (std::size_t i = 0; i < max_num_envs_; ++i) {
+      result.emplace_back(
+          release_pool.enqueue([i, this] { envs_[i].reset(); }));
+    }
+    for (auto& f : result) {
+      f.get();
+    }
+    for (auto& worker : abandoned_) {
+      if (*worker.returned) {
+        worker.thread.join();
+        worker.env.reset();
+      } else {
+        // the hung step may never return, so leave the env to it
+        worker.thread.detach();
+        static_cast<void>(worker.env.release());
+      }
+    }
+  }
+
+  /**
+   * Construction time (in seconds) of each env, 0 if it has not been built
+   * yet (with lazy_init).
+   */
+  [[nodiscard]] std::vector<double> EnvInitTime() const {
+    return {env_init_time_.begin(), env_init_time_.end()};
+  }
+
+  /**
+   * Size in bytes of the buffer behind each batch returned by Recv with
+   * contiguous_state, see StateBufferQueue::ArenaSize. 0 without it.
+   */
+  [[nodiscard]] std::size_t StateArenaSize() const {
+    return state_buffer_queue_->ArenaSize();
+  }
+
+  /**
+   * Counters of the pool:
+   * - alloc_count / alloc_bytes: number and total size of the allocations
+   *   of the state buffers and the env-owned arrays;
+   * - alloc_huge_page: allocations backed by huge pages;
+   * - alloc_huge_page_fallback: explicit huge page requests that fell back
+   *   to transparent huge pages;
+   * - env_restart_count / env_restart_us: number of envs rebuilt by the
+   *   watchdog of step_timeout, and the total time (in microseconds) spent
+   *   rebuilding them.
+   */
+  [[nodiscard]] std::map<std::string, uint64_t> Stats() const {
+    Allocator::Stats alloc = allocator_->GetStats();
+    return {{"alloc_count", alloc.num_alloc},
+            {"alloc_bytes", alloc.bytes},
+            {"alloc_huge_page", alloc.num_huge_page},
+            {"alloc_huge_page_fallback", alloc.num_huge_page_fallback},
+            {"env_restart_count", restart_count_},
+            {"env_restart_us", restart_us_}};
+  }
+
+  /**
+   * The pool-wide normalization statistics, see Normalizer::State. Empty if
+   * the pool doesn't normalize.
+   */
+  [[nodiscard]] std::vector<double> NormalizerState() const {
+    return normalizer_ == nullptr ? std::vector<double>()
+                                  : normalizer_->State();
+  }
+
+  /**
+   * Replace the normalization statistics with `state` from NormalizerState,
+   * e.g., of a training pool. Combine with `norm_update=False` to keep them
+   * fixed during evaluation.
+   */
+  void LoadNormalizerState(const std::vector<double>& state) {
+    if (normalizer_ == nullptr) {
+      throw std::runtime_error(
+          "The pool doesn't normalize, set norm_obs or norm_reward.");
+    }
+    normalizer_->Load(state);
+  }
+
+  /**
+   * Env id, return and length of the last `episode_window` finished episodes
+   * of the pool, oldest first.
+   */
+  [[nodiscard]] EpisodeStats::Columns RecentEpisodes() const {
+    if (episode_stats_ == nullptr) {
+      throw std::runtime_error(
+          "The pool doesn't record episodes, set episode_window.");
+    }
+    return episode_stats_->Recent();
+  }
+
+  /**
+   * The last complete rollout: with `rollout_len` T, every T batches of Recv
+   * are written into one [T, batch_size, ...] array per state key, returned
+   * here once the T-th batch has been received. The next rollout is written
+   * into separate memory, so it may be collected while this one is in use.
+   *
+   * With `check_env_id`, every column must hold the steps of one env, as the
+   * return kernels of envpool/utils/returns.h assume. That holds in sync mode
+   * (batch_size == num_envs) when the actions are sent in the env id order of
+   * Recv, but not in async mode, whose rollouts have to be reordered by
+   * info:env_id first.
+   */
+  [[nodiscard]] std::vector<Array> Rollout(bool check_env_id = true) {
+    if (this->spec_.config["rollout_len"_] <= 0) {
+      throw std::runtime_error(
+          "The pool doesn't collect rollouts, set rollout_len.");
+    }
+    auto ret = state_buffer_queue_->Rollout();
+    if (ret.empty()) {
+      throw std::runtime_error(
+          "No complete rollout, recv rollout_len batches first.");
+    }
+    if (check_env_id) {
+      const Array& env_id = ret[0];
+      const auto* id = static_cast<const int*>(env_id.Data());
+      std::size_t batch = env_id.Shape(1);
+      for (std::size_t i = batch; i < env_id.size; ++i) {
+        if (id[i] != id[i % batch]) {
+          throw std::runtime_error(
+              "A column of the rollout mixes envs, use sync mode and send "
+              "the actions in the env_id order of recv, or disable "
+              "check_env_id and reorder the rollout by info:env_id.");
+        }
+      }
+    }
+    return ret;
+  }
+
+  /**
+   * Close the control loop in C++: receive a batch, let `policy` fill its
+   * actions and send them right away, until `num_steps` env steps have been
+   * received or `num_episodes` episodes have finished (0 for no limit, but
+   * at least one of them must be set). Like a loop of Recv / Send, it starts
+   * with all the alive envs stepping (e.g., after resetting all of them) and
+   * returns with all of them stepping again, so that Recv or another call
+   * picks up from there.
+   */
+  PolicyResult RunPolicy(Policy* policy, std::size_t num_steps,
+                         std::size_t num_episodes) {
+    if (num_steps == 0 && num_episodes == 0) {
+      throw std::invalid_argument("Set num_steps or num_episodes.");
+    }
+    std::vector<bool> mask = this->spec_.StateMask();
+    NamedVector<typename Spec::StateKeys, std::vector<bool>> kept(&mask);
+    if (!kept["info:episode_return"_] || !kept["info:episode_length"_]) {
+      throw std::invalid_argument(
+          "RunPolicy requires info:episode_return and info:episode_length, "
+          "keep them in the state_keys config.");
+    }
+    auto start = std::chrono::steady_clock::now();
+    PolicyResult result{0, 0.0, 0.0, {}, {}, {}};
+    auto action_shapes =
+        this->spec_.action_spec.template AllValues<ShapeSpec>();
+    do {
+      std::vector<Array> state = Recv();
+      const State s(&state);
+      std::size_t batch = state[0].Shape(0);
+      std::size_t num_players = state[1].Shape(0);
+      result.num_steps += batch;
+      const auto* reward = static_cast<const float*>(s["reward"_].Data());
+      for (std::size_t i = 0; i < s["reward"_].size; ++i) {
+        result.total_reward += reward[i];
+      }
+      for (std::size_t i = 0; i < batch; ++i) {
+        if (static_cast<bool>(s["done"_][i])) {
+          result.env_id.push_back(static_cast<int>(s["info:env_id"_][i]));
+          result.episode_return.push_back(
+              static_cast<float>(s["info:episode_return"_][i]));
+          result.episode_length.push_back(
+              static_cast<int>(s["info:episode_length"_][i]));
+        }
+      }
+      // fresh arrays for each batch, the envs of the previous ones may not
+      // have read their actions yet
+      std::vector<Array> action;
+      action.reserve(action_shapes.size());
+      for (ShapeSpec spec : action_shapes) {
+        if (!spec.shape.empty() && spec.shape[0] == -1) {
+          spec.shape[0] = static_cast<int>(num_players);
+        } else {
+          spec = spec.Batch(static_cast<int>(batch));
+        }
+        action.emplace_back(spec);
+      }
+      action[0].Assign(state[0]);
+      action[1].Assign(state[1]);
+      policy->Act(state, &action);
+      Send(action);
+    } while ((num_steps == 0 || result.num_steps < num_steps) &&
+             (num_episodes == 0 || result.env_id.size() < num_episodes));
+    std::chrono::duration<double> dur =
+        std::chrono::steady_clock::now() - start;
+    result.seconds = dur.count();
+    return result;
+  }
+
+  /**
+   * Same as above, with the policy exported by the shared library at `path`
+   * (see ENVPOOL_REGISTER_POLICY) and built with `arg`. The policy is kept
+   * for the following calls with the same path and arg.
+   */
+  PolicyResult RunPolicy(const std::string& path, const std::string& arg,
+                         std::size_t num_steps, std::size_t num_episodes) {
+    if (policy_library_ == nullptr || path != policy_path_ ||
+        arg != policy_arg_) {
+      policy_library_.reset();
+      policy_library_ = std::make_unique<PolicyLibrary>(path, arg);
+      policy_path_ = path;
+      policy_arg_ = arg;
+    }
+    return RunPolicy(policy_library_->Get(), num_steps, num_episodes);
+  }
+
+  /**
+   * Change the config of a live pool without rebuilding the envs. Only the
+   * keys whitelisted by `Env::IsHotConfig` may differ from the current
+   * config; each env picks the new config up at its next reset.
+   */
+  void Reconfigure(const Spec& spec) { Reconfigure(std::vector<Spec>{spec}); }
+
+  /**
+   * Multi-task version of Reconfigure, with one spec for each task.
+   */
+  void Reconfigure(const std::vector<Spec>& specs) {
+    if (specs.size() != task_specs_.size()) {
+      throw std::invalid_argument(
+          "Expect " + std::to_string(task_specs_.size()) +
+          " specs (one for each task), got " + std::to_string(specs.size()));
+    }
+    std::lock_guard<std::mutex> lock(config_mutex_);
+    for (std::size_t k = 0; k < specs.size(); ++k) {
+      std::apply(
+          [&](auto&&... key) {
+            (CheckHotConfig(key, specs[k].config[key],
+                            task_specs_[k].config[key]),
+             ...);
+          },
+          typename Spec::ConfigKeys());
+    }
+    task_specs_ = specs;
+    this->spec_ = specs[0];
+    config_specs_ = ShareSpecs(specs);
+    ++config_version_;
+  }
+
+  /**
+   * Set the seed of each env in `env_ids`, which takes effect at its next
+   * reset (including the auto-reset after done): the env RNG and the
+   * underlying simulator are reseeded and a new episode is started. The envs
+   * are not rebuilt, so evaluation rounds with fixed seeds can reuse a warm
+   * pool.
+   */
+  void Reseed(const std::vector<int>& env_ids, const std::vector<int>& seeds) {
+    if (env_ids.size() != seeds.size()) {
+      throw std::invalid_argument(
+          "Expect one seed for each env, got " + std::to_string(seeds.size()) +
+          " seeds for " + std::to_string(env_ids.size()) + " envs");
+    }
+    std::lock_guard<std::mutex> lock(config_mutex_);
+    for (std::size_t i = 0; i < env_ids.size(); ++i) {
+      int eid = env_ids[i];
+      if (eid < 0 || eid >= static_cast<int>(max_num_envs_) ||
+          !env_alive_[eid]) {
+        throw std::invalid_argument("Cannot reseed env " + std::to_string(eid) +
+                                    ", it is not alive.");
+      }
+    }
+    for (std::size_t i = 0; i < env_ids.size(); ++i) {
+      reseed_value_[env_ids[i]] = seeds[i];
+      reseed_pending_[env_ids[i]] = 1;
+    }
+  }
+
+  /**
+   * Ids of the envs that are currently alive, in ascending order.
+   */
+  [[nodiscard]] std::vector<int> EnvIds() const {
+    std::vector<int> env_ids;
+    for (std::size_t i = 0; i < max_num_envs_; ++i) {
+      if (env_alive_[i]) {
+        env_ids.push_back(i);
+      }
+    }
+    return env_ids;
+  }
+
+  /**
+   * Add `num` envs to a live pool and return their ids. Ids freed by
+   * RemoveEnvs are reused first, the ids of the other envs never change. The
+   * new envs need to be reset before receiving any action.
+   *
+   * In sync mode the batch size follows the number of envs, so it can only
+   * be called between batches, i.e., after all states have been received.
+   */
+  std::vector<int> AddEnvs(std::size_t num) {
+    if (num_envs_ + num > max_num_envs_) {
+      throw std::invalid_argument(
+          "Cannot grow to " + std::to_string(num_envs_ + num) +
+          " envs, max_num_envs = " + std::to_string(max_num_envs_));
+    }
+    Resize(num_envs_ + num);
+    std::vector<int> env_ids;
+    for (std::size_t i = 0; env_ids.size() < num; ++i) {
+      if (!env_alive_[i]) {
+        env_ids.push_back(i);
+      }
+    }
+    if (!lazy_init_) {
+      std::size_t processor_count = std::thread::hardware_concurrency();
+      ThreadPool init_pool(std::min(processor_count, num));
+      std::vector<std::future<void>> result;
+      for (int i : env_ids) {
+        result.emplace_back(init_pool.enqueue([i, this] { InitEnv(i); }));
+      }
+      for (auto& f : result) {
+        f.get();
+      }
+    }
+    for (int i : env_ids) {
+      env_alive_[i] = true;
+    }
+    return env_ids;
+  }
+
+  /**
+   * Remove envs from a live pool. A removed env no longer accepts actions,
+   * its in-flight step (if any) is finished and delivered as usual before
+   * the env is destroyed. Same as AddEnvs, in sync mode it can only be called
+   * between batches.
+   */
+  void RemoveEnvs(const std::vector<int>& env_ids) {
+    for (std::size_t i = 0; i < env_ids.size(); ++i) {
+      int eid = env_ids[i];
+      if (eid < 0 || eid >= static_cast<int>(max_num_envs_) ||
+          !env_alive_[eid] ||
+          std::find(env_ids.begin(), env_ids.begin() + i, eid) !=
+              env_ids.begin() + i) {
+        throw std::invalid_argument("Cannot remove env " + std::to_string(eid) +
+                                    ", it is not alive.");
+      }
+    }
+    Resize(num_envs_ - env_ids.size());
+    for (int eid : env_ids) {
+      env_alive_[eid] = false;
+      WaitEnv(eid);
+      reseed_pending_[eid] = 0;
+      {
+        // the watchdog may still look at the env of a step that just ended
+        std::lock_guard<std::mutex> lock(watchdog_mutex_);
+        envs_[eid].reset();
+      }
+      env_init_time_[eid] = 0;
+    }
+  }
+
+  /**
+   * Save the full state of all envs into a memory-mapped file at `path`,
+   * the envs are serialized in parallel. In-flight steps are waited for, but
+   * their states are not part of the snapshot, so it should be called after
+   * receiving all states.
+   */
+  void Save(const std::string& path) {
+    for (std::size_t i = 0; i < max_num_envs_; ++i) {
+      WaitEnv(i);
+    }
+    // blob 0 holds the env population, blob i + 1 holds env i
+    std::vector<SnapshotWriter> writers(max_num_envs_ + 1);
+    writers[0].Write(max_num_envs_);
+    for (std::size_t i = 0; i < max_num_envs_; ++i) {
+      writers[0].Write(static_cast<bool>(env_alive_[i]));
+    }
+    ParallelFor([&](std::size_t i) {
+      if (env_alive_[i] && envs_[i] != nullptr) {
+        envs_[i]->Save(&writers[i + 1]);
+      }
+    });
+    std::vector<std::size_t> sizes;
+    for (const auto& w : writers) {
+      sizes.push_back(w.Data().size());
+    }
+    auto file = SnapshotFile::Create(path, sizes);
+    std::memcpy(file->Blob(0), writers[0].Data().data(), sizes[0]);
+    ParallelFor([&](std::size_t i) {
+      std::memcpy(file->Blob(i + 1), writers[i + 1].Data().data(),
+                  sizes[i + 1]);
+    });
+  }
+
+  /**
+   * Restore all envs from a file written by Save, which must come from a
+   * pool with the same config. Envs that were alive but not built yet
+   * (lazy_init) need to be reset after loading.
+   */
+  void Load(const std::string& path) {
+    for (std::size_t i = 0; i < max_num_envs_; ++i) {
+      WaitEnv(i);
+    }
+    auto file = SnapshotFile::Open(path);
+    SnapshotReader meta(file->Blob(0), file->BlobSize(0));
+    std::size_t max_num_envs;
+    meta.Read(&max_num_envs);
+    if (max_num_envs != max_num_envs_ || file->Count() != max_num_envs_ + 1) {
+      throw std::invalid_argument(
+          "Snapshot " + path + " holds " + std::to_string(max_num_envs) +
+          " envs, expect " + std::to_string(max_num_envs_));
+    }
+    std::vector<bool> env_alive(max_num_envs_);
+    for (std::size_t i = 0; i < max_num_envs_; ++i) {
+      bool alive;
+      meta.Read(&alive);
+      env_alive[i] = alive;
+    }
+    std::size_t num_envs = std::count(env_alive.begin(), env_alive.end(), true);
+    if (num_envs != num_envs_) {
+      Resize(num_envs);
+    }
+    env_alive_ = env_alive;
+    // the watchdog may still look at the env of a step that just ended
+    std::lock_guard<std::mutex> lock(watchdog_mutex_);
+    ParallelFor([&](std::size_t i) {
+      if (file->BlobSize(i + 1) == 0) {
+        envs_[i].reset();
+        env_init_time_[i] = 0;
+        return;
+      }
+      if (envs_[i] == nullptr) {
+        InitEnv(i);
+      }
+      SnapshotReader reader(file->Blob(i + 1), file->BlobSize(i + 1));
+      envs_[i]->Load(&reader);
+    });
+  }
+
+  /**
+   * Step K copies of env `env_id` from its current state, one for each row of
+   * `action` (same layout as in Send), and return the K next states as one
+   * batch in the order of the rows. Env `env_id` itself is left untouched:
+   * it is snapshotted with Env::Save and the children are restored with
+   * Env::Load on scratch envs, which are built once and reused afterwards.
+   * Only single-player envs with snapshot support are accepted.
+   */
+  std::vector<Array> Branch(int env_id, const std::vector<Array>& action) {
+    if (max_num_players_ != 1) {
+      throw std::invalid_argument("Branch only supports single-player envs.");
+    }
+    if (env_id < 0 || env_id >= static_cast<int>(max_num_envs_) ||
+        !env_alive_[env_id] || envs_[env_id] == nullptr) {
+      throw std::invalid_argument(
+          "Cannot branch env " + std::to_string(env_id) +
+          ", it hasn't been reset yet or has been removed.");
+    }
+    std::size_t num = action[0].Shape(0);
+    if (num == 0) {
+      throw std::invalid_argument("Branch needs at least one action.");
+    }
+    WaitEnv(env_id);
+    SnapshotWriter writer;
+    envs_[env_id]->Save(&writer);
+    if (branch_pool_ == nullptr) {
+      branch_pool_ = std::make_unique<ThreadPool>(num_threads_);
+    }
+    auto& scratch = PrepareScratch(env_id % task_specs_.size(), num);
+    if (branch_num_ != num) {
+      branch_num_ = num;
+      branch_sbq_.reset(new StateBufferQueue(
+          num, num, 1, this->spec_.StateShapes(),
+          this->spec_.config["contiguous_state"_], allocator_.get()));
+    }
+    auto action_batch = std::make_shared<std::vector<Array>>(action);
+    const std::string& data = writer.Data();
+    std::vector<std::future<void>> result;
+    for (std::size_t k = 0; k < num; ++k) {
+      result.emplace_back(branch_pool_->enqueue([&, k] {
+        Env* env = scratch[k].get();
+        SnapshotReader reader(data.data(), data.size());
+        env->Load(&reader);
+        env->SetAction(action_batch, k);
+        env->EnvStep(branch_sbq_.get(), k, env->IsDone());
+      }));
+    }
+    for (auto& f : result) {
+      f.wait();
+    }
+    try {
+      for (auto& f : result) {
+        f.get();
+      }
+    } catch (...) {
+      // the batch is incomplete, rebuild the queue at the next call
+      branch_num_ = 0;
+      throw;
+    }
+    return branch_sbq_->Wait();
   }
 
   void Send(const std::vector<Array>& action) override {
@@ -137,7 +758,16 @@ class AsyncEnvPool : public EnvPool<typename Env::Spec> {
         std::make_shared<std::vector<Array>>(action);
     for (int i = 0; i < shared_offset; ++i) {
       int eid = env_id[i];
-      envs_[eid]->SetAction(action_batch, i);
+      if (!env_alive_[eid] ||
+          (envs_[eid] == nullptr && restart_pending_[eid] == 0)) {
+        throw std::runtime_error("env " + std::to_string(eid) +
+                                 " hasn't been reset yet or has been removed");
+      }
+      // an env restarted by the watchdog is rebuilt and reset by the worker
+      if (envs_[eid] != nullptr) {
+        envs_[eid]->SetAction(action_batch, i);
+      }
+      stepping_env_[eid] = 1;
       actions.emplace_back(ActionSlice{
           .env_id = eid,
           .order = is_sync_ ? i : -1,
@@ -171,8 +801,14 @@ class AsyncEnvPool : public EnvPool<typename Env::Spec> {
     int shared_offset = env_ids.Shape(0);
     std::vector<ActionSlice> actions(shared_offset);
     for (int i = 0; i < shared_offset; ++i) {
+      int eid = env_ids[i];
+      if (!env_alive_[eid]) {
+        throw std::runtime_error("env " + std::to_string(eid) +
+                                 " has been removed");
+      }
+      stepping_env_[eid] = 1;
       actions[i].force_reset = true;
-      actions[i].env_id = env_ids[i];
+      actions[i].env_id = eid;
       actions[i].order = is_sync_ ? i : -1;
     }
     if (is_sync_) {
@@ -180,6 +816,467 @@ class AsyncEnvPool : public EnvPool<typename Env::Spec> {
     }
     action_buffer_queue_->EnqueueBulk(actions);
   }
+
+ protected:
+  /**
+   * Body of worker thread `i`: step the envs of the actions it dequeues
+   * until the pool stops.
+   */
+  void RunWorker(std::size_t i) {
+    Env::SetTrajectoryWriter(
+        trajectory_writers_.empty() ? nullptr : trajectory_writers_[i].get());
+    for (;;) {
+      ActionSlice raw_action = action_buffer_queue_->Dequeue();
+      if (stop_ == 1) {
+        break;
+      }
+      int env_id = raw_action.env_id;
+      int order = raw_action.order;
+      if (envs_[env_id] == nullptr) {
+        if (restart_pending_[env_id] == 0) {
+          // lazy_init: the first reset of this env builds it here
+          InitEnv(env_id);
+        } else if (!Rebuild(env_id)) {
+          WriteFailedState(env_id, order);
+          continue;
+        }
+      }
+      Env* env = envs_[env_id].get();
+      bool reset = raw_action.force_reset || env->IsDone();
+      if (restart_pending_[env_id] != 0) {
+        // rebuilt by the watchdog
+        restart_pending_[env_id] = 0;
+        reset = true;
+      }
+      if (reset && env_config_version_[env_id] != config_version_) {
+        ApplyConfig(env_id);
+      }
+      if (reset && reseed_pending_[env_id] != 0) {
+        ApplySeed(env_id);
+      }
+      uint64_t step_id = 0;
+      if (step_timeout_ > 0) {
+        // published before the step id, see RunWatchdog
+        step_id = ++step_count_;
+        worker_env_[i] = env_id;
+        worker_start_[i] = Now();
+        worker_step_[i] = step_id;
+      }
+      if (!env->EnvStep(state_buffer_queue_.get(), order, reset, step_id)) {
+        // abandoned by the watchdog, which has handed this worker to a new
+        // thread, so this one must not touch the pool any more
+        return;
+      }
+      if (step_timeout_ > 0) {
+        worker_step_[i] = 0;
+      }
+      stepping_env_[env_id] = 0;
+    }
+  }
+
+  /**
+   * Check the steps of the workers every quarter of step_timeout (at most
+   * every 100 ms) and restart the envs that exceed it, see Restart. The
+   * replaced workers are joined once their hung step returns.
+   */
+  void RunWatchdog() {
+    auto timeout = static_cast<int64_t>(step_timeout_ * 1e9);
+    auto period = std::chrono::nanoseconds(
+        std::clamp<int64_t>(timeout / 4, 1000000, 100000000));
+    std::unique_lock<std::mutex> lock(watchdog_mutex_);
+    auto stopped = [this] { return stop_ == 1; };
+    while (!watchdog_cv_.wait_for(lock, period, stopped)) {
+      ReleaseAbandoned(&lock);
+      for (std::size_t i = 0; i < num_threads_; ++i) {
+        // step ids are never reused, so env_id and start belong to step_id
+        // if the worker still publishes it after they are read
+        uint64_t step_id = worker_step_[i];
+        if (step_id == 0) {
+          continue;
+        }
+        int env_id = worker_env_[i];
+        int64_t start = worker_start_[i];
+        if (worker_step_[i] != step_id || Now() - start < timeout) {
+          continue;
+        }
+        // Abandon fails if step_id has finished, even if the env is already
+        // running its next step
+        Env* env = envs_[env_id].get();
+        if (env == nullptr || !env->Abandon(step_id)) {
+          continue;
+        }
+        LOG(WARNING) << "env " << env_id << " exceeds step_timeout = "
+                     << step_timeout_ << "s, restarting it";
+        Restart(i, env_id, env->Order());
+      }
+    }
+  }
+
+  /**
+   * Replace the env `env_id`, whose step on worker `worker` has been
+   * abandoned: the hung thread keeps the old env and a new thread takes over
+   * the worker, and the slot of the step in the state buffer is filled with
+   * a terminal state flagged by `info:env_failed`. The env is rebuilt by the
+   * worker of its next action (see Rebuild), so that a slow construction
+   * doesn't hold up the watchdog.
+   */
+  void Restart(std::size_t worker, int env_id, int order) {
+    worker_step_[worker] = 0;
+    abandoned_.push_back({std::move(workers_[worker]),
+                          std::move(worker_returned_[worker]),
+                          std::move(envs_[env_id])});
+    restart_pending_[env_id] = 1;
+    ++restart_count_;
+    StartWorker(worker);
+    SetAffinity(worker);
+    WriteFailedState(env_id, order);
+  }
+
+  /**
+   * Join the replaced workers that have left their hung step and free their
+   * envs (e.g., a game process), outside of `lock`.
+   */
+  void ReleaseAbandoned(std::unique_lock<std::mutex>* lock) {
+    std::vector<AbandonedWorker> returned;
+    for (auto it = abandoned_.begin(); it != abandoned_.end();) {
+      if (*it->returned) {
+        returned.push_back(std::move(*it));
+        it = abandoned_.erase(it);
+      } else {
+        ++it;
+      }
+    }
+    if (returned.empty()) {
+      return;
+    }
+    lock->unlock();
+    for (auto& worker : returned) {
+      worker.thread.join();
+      worker.env.reset();
+    }
+    lock->lock();
+  }
+
+  /**
+   * Build env `env_id` again after Restart, it then resets. Returns false if
+   * it fails, the rebuild is then retried at the next action.
+   */
+  bool Rebuild(int env_id) {
+    auto start = std::chrono::steady_clock::now();
+    bool ok = true;
+    try {
+      InitEnv(env_id);
+    } catch (const std::exception& e) {
+      envs_[env_id].reset();
+      LOG(ERROR) << "Cannot rebuild env " << env_id << ": " << e.what();
+      ok = false;
+    }
+    restart_us_ += std::chrono::duration_cast<std::chrono::microseconds>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+    return ok;
+  }
+
+  /**
+   * Fill the slot `order` of env `env_id` in the state buffer with a
+   * terminal state flagged by `info:env_failed`, instead of a step.
+   */
+  void WriteFailedState(int env_id, int order) {
+    auto slice = state_buffer_queue_->Allocate(1, order);
+    for (auto& a : slice.arr) {
+      a.Zero();
+    }
+    State state(&slice.arr);
+    state["info:env_id"_] = env_id;
+    *static_cast<int*>(state["info:players.env_id"_].Data()) = env_id;
+    state["info:task_id"_] = static_cast<int>(env_id % task_specs_.size());
+    state["done"_] = true;
+    if (state["info:env_failed"_].size > 0) {
+      // not pruned by the state_keys config
+      state["info:env_failed"_] = true;
+    }
+    slice.done_write();
+    stepping_env_[env_id] = 0;
+  }
+
+  /**
+   * Start worker thread `i`, which sets worker_returned_[i] once it has left
+   * RunWorker, e.g., after an abandoned step (see Restart).
+   */
+  void StartWorker(std::size_t i) {
+    auto returned = std::make_shared<std::atomic<bool>>(false);
+    worker_returned_[i] = returned;
+    workers_[i] = std::thread([this, i, returned] {
+      RunWorker(i);
+      *returned = true;
+    });
+  }
+
+  static int64_t Now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+  }
+
+  void SetAffinity(std::size_t tid) {
+    if (this->spec_.config["thread_affinity_offset"_] < 0) {
+      return;
+    }
+    std::size_t thread_affinity_offset =
+        this->spec_.config["thread_affinity_offset"_];
+    std::size_t processor_count = std::thread::hardware_concurrency();
+    cpu_set_t cpuset;
+    CPU_ZERO(&cpuset);
+    std::size_t cid = (thread_affinity_offset + tid) % processor_count;
+    CPU_SET(cid, &cpuset);
+    pthread_setaffinity_np(workers_[tid].native_handle(), sizeof(cpu_set_t),
+                           &cpuset);
+  }
+
+  void InitEnv(std::size_t env_id) {
+    auto start = std::chrono::system_clock::now();
+    std::shared_ptr<const SpecList> specs;
+    {
+      std::lock_guard<std::mutex> lock(config_mutex_);
+      specs = config_specs_;
+      env_config_version_[env_id] = config_version_;
+    }
+    int task_id = env_id % specs->size();
+    {
+      Allocator::Scope scope(allocator_.get());
+      envs_[env_id].reset(new Env(*(*specs)[task_id], env_id));
+    }
+    envs_[env_id]->SetTaskId(task_id);
+    envs_[env_id]->SetNormalizer(normalizer_.get(), true);
+    envs_[env_id]->SetEpisodeStats(episode_stats_.get());
+    std::chrono::duration<double> dur =
+        std::chrono::system_clock::now() - start;
+    env_init_time_[env_id] = dur.count();
+  }
+
+  /**
+   * Wait until the in-flight step (if any) of env `env_id` finishes.
+   */
+  void WaitEnv(std::size_t env_id) {
+    while (stepping_env_[env_id] != 0) {
+      std::this_thread::yield();
+    }
+  }
+
+  /**
+   * Run `f(i)` for all env slots with a temporary thread pool.
+   */
+  template <typename F>
+  void ParallelFor(F&& f) {
+    std::size_t processor_count = std::thread::hardware_concurrency();
+    ThreadPool pool(std::min(processor_count, max_num_envs_));
+    std::vector<std::future<void>> result;
+    for (std::size_t i = 0; i < max_num_envs_; ++i) {
+      result.emplace_back(pool.enqueue([i, &f] { f(i); }));
+    }
+    for (auto& r : result) {
+      r.get();
+    }
+  }
+
+  /**
+   * Make sure there are at least `num` scratch envs of task `task_id`, built
+   * in parallel, and that all of them follow the latest config.
+   */
+  std::vector<std::unique_ptr<Env>>& PrepareScratch(std::size_t task_id,
+                                                   std::size_t num) {
+    std::shared_ptr<const SpecList> specs;
+    int version;
+    {
+      std::lock_guard<std::mutex> lock(config_mutex_);
+      specs = config_specs_;
+      version = config_version_;
+    }
+    const Spec& spec = *(*specs)[task_id];
+    auto& scratch = scratch_envs_[task_id];
+    if (scratch_config_version_[task_id] != version) {
+      for (auto& env : scratch) {
+        env->Reconfigure(spec);
+      }
+      scratch_config_version_[task_id] = version;
+    }
+    if (scratch.size() < num) {
+      std::vector<std::unique_ptr<Env>> built(num - scratch.size());
+      std::vector<std::future<void>> result;
+      for (std::size_t k = 0; k < built.size(); ++k) {
+        result.emplace_back(branch_pool_->enqueue([&, k] {
+          Allocator::Scope scope(allocator_.get());
+          built[k].reset(new Env(spec, task_id));
+          built[k]->SetTaskId(task_id);
+          // the branches normalize like the pool but don't move its stats
+          built[k]->SetNormalizer(normalizer_.get(), false);
+        }));
+      }
+      // the tasks refer to `built`, so wait for all of them before rethrowing
+      for (auto& f : result) {
+        f.wait();
+      }
+      for (auto& f : result) {
+        f.get();
+      }
+      for (auto& env : built) {
+        scratch.push_back(std::move(env));
+      }
+    }
+    return scratch;
+  }
+
+  void ApplyConfig(std::size_t env_id) {
+    std::shared_ptr<const SpecList> specs;
+    {
+      std::lock_guard<std::mutex> lock(config_mutex_);
+      specs = config_specs_;
+      env_config_version_[env_id] = config_version_;
+    }
+    envs_[env_id]->Reconfigure(*(*specs)[env_id % specs->size()]);
+  }
+
+  void ApplySeed(std::size_t env_id) {
+    int seed;
+    {
+      std::lock_guard<std::mutex> lock(config_mutex_);
+      seed = reseed_value_[env_id];
+      reseed_pending_[env_id] = 0;
+    }
+    envs_[env_id]->Reseed(seed);
+  }
+
+  /**
+   * Set the number of alive envs, in sync mode the batch size and the state
+   * buffer queue follow it.
+   */
+  void Resize(std::size_t num_envs) {
+    if (is_sync_) {
+      if (stepping_env_num_ != 0) {
+        throw std::runtime_error(
+            "Cannot add or remove envs in sync mode before receiving all "
+            "states.");
+      }
+      if (num_envs == 0) {
+        throw std::invalid_argument("Cannot remove all envs in sync mode.");
+      }
+      // the workers may still be inside EnvStep after their state is written
+      for (std::size_t i = 0; i < max_num_envs_; ++i) {
+        WaitEnv(i);
+      }
+      batch_ = num_envs;
+      state_buffer_queue_ = MakeStateBufferQueue();
+    } else if (num_envs < batch_) {
+      throw std::invalid_argument(
+          "Cannot shrink to " + std::to_string(num_envs) +
+          " envs, batch_size = " + std::to_string(batch_));
+    }
+    num_envs_ = num_envs;
+    for (auto& spec : task_specs_) {
+      spec.config["num_envs"_] = num_envs_;
+      if (is_sync_ && spec.config["batch_size"_] > 0) {
+        spec.config["batch_size"_] = batch_;
+      }
+    }
+    this->spec_ = task_specs_[0];
+  }
+
+  std::unique_ptr<StateBufferQueue> MakeStateBufferQueue() {
+    return std::make_unique<StateBufferQueue>(
+        batch_, max_num_envs_, max_num_players_, this->spec_.StateShapes(),
+        this->spec_.config["contiguous_state"_], allocator_.get(),
+        std::max(1, this->spec_.config["rollout_len"_]));
+  }
+
+  static AllocatorOptions MakeAllocatorOptions(const Spec& spec) {
+    AllocatorOptions options;
+    options.alignment = spec.config["alloc_alignment"_];
+    options.huge_page = ParseHugePage(spec.config["alloc_huge_page"_]);
+    options.zero_fill = spec.config["alloc_zero_fill"_];
+    options.prefault = spec.config["alloc_prefault"_];
+    return options;
+  }
+
+  static std::shared_ptr<const SpecList> ShareSpecs(
+      const std::vector<Spec>& specs) {
+    auto shared = std::make_shared<SpecList>();
+    for (const auto& spec : specs) {
+      shared->push_back(std::make_shared<const Spec>(spec));
+    }
+    return shared;
+  }
+
+  static const Spec& CheckTaskSpecs(const std::vector<Spec>& specs) {
+    if (specs.empty()) {
+      throw std::invalid_argument("At least one spec is required.");
+    }
+    for (std::size_t k = 1; k < specs.size(); ++k) {
+      std::apply(
+          [&](auto&&... key) {
+            (CheckPoolConfig(key, specs[k].config[key], specs[0].config[key]),
+             ...);
+          },
+          typename decltype(common_config)::Keys());
+      if (!SameShapes(specs[k].state_spec.template AllValues<ShapeSpec>(),
+                      specs[0].state_spec.template AllValues<ShapeSpec>()) ||
+          !SameShapes(specs[k].action_spec.template AllValues<ShapeSpec>(),
+                      specs[0].action_spec.template AllValues<ShapeSpec>())) {
+        throw std::invalid_argument(
+            "Task " + std::to_string(k) +
+            " has different state / action shapes from task 0.");
+      }
+      // an action valid for task 0 must be valid for every task, e.g. Atari
+      // games index their own minimal action set with it
+      std::apply(
+          [&](auto&&... key) {
+            (CheckActionBounds(key, specs[k].action_spec[key],
+                               specs[0].action_spec[key]),
+             ...);
+          },
+          typename Spec::ActionKeys());
+    }
+    return specs[0];
+  }
+
+  static bool SameShapes(const std::vector<ShapeSpec>& a,
+                         const std::vector<ShapeSpec>& b) {
+    for (std::size_t i = 0; i < a.size(); ++i) {
+      if (a[i].element_size != b[i].element_size || a[i].shape != b[i].shape) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  template <typename Key, typename ActionSpec>
+  static void CheckActionBounds(const Key& key, const ActionSpec& spec,
+                                const ActionSpec& first_spec) {
+    if (spec.bounds != first_spec.bounds ||
+        spec.elementwise_bounds != first_spec.elementwise_bounds) {
+      throw std::invalid_argument(
+          "Action \"" + key.Str() +
+          "\" must have the same bounds across tasks, e.g., set "
+          "full_action_space=True for Atari games.");
+    }
+  }
+
+  template <typename Key, typename Value>
+  static void CheckPoolConfig(const Key& key, const Value& value,
+                              const Value& first_value) {
+    if (!(value == first_value)) {
+      throw std::invalid_argument("Config \"" + key.Str() +
+                                  "\" must be the same across tasks.");
+    }
+  }
+
+  template <typename Key, typename Value>
+  static void CheckHotConfig(const Key& key, const Value& new_value,
+                             const Value& old_value) {
+    if (!(new_value == old_value) && !Env::IsHotConfig(key.Str())) {
+      throw std::invalid_argument("Config \"" + key.Str() +
+                                  "\" cannot be changed on a live envpool.");
+    }
+  }
 };
 
 #endif  // ENVPOOL_CORE_ASYNC_ENVPOOL_H_
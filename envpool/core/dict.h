@@ -21,12 +21,14 @@
 
 #include <algorithm>
 #include <functional>
+#include <memory>
 #include <string>
 #include <tuple>
 #include <type_traits>
 #include <utility>
 #include <vector>
 
+#include "envpool/core/allocator.h"
 #include "envpool/core/array.h"
 #include "envpool/core/spec.h"
 #include "envpool/core/tuple_utils.h"
@@ -294,10 +296,61 @@ std::vector<Array> MakeArray(const std::tuple<Spec...>& specs) {
 
 /**
  * Dynamic version of MakeArray.
- * Takes a vector of `ShapeSpec`.
+ * Takes a vector of `ShapeSpec`, and an optional allocator of the memory.
  */
-std::vector<Array> MakeArray(const std::vector<ShapeSpec>& specs) {
-  return std::vector<Array>(specs.begin(), specs.end());
+std::vector<Array> MakeArray(const std::vector<ShapeSpec>& specs,
+                             Allocator* allocator = nullptr) {
+  std::vector<Array> rets;
+  rets.reserve(specs.size());
+  for (const auto& spec : specs) {
+    rets.emplace_back(spec, allocator);
+  }
+  return rets;
+}
+
+/**
+ * Byte offset of each spec when they are laid out in one arena, each field
+ * starts at a multiple of `alignment`. The last element is the arena size.
+ */
+inline std::vector<std::size_t> ArenaOffsets(
+    const std::vector<ShapeSpec>& specs, std::size_t alignment = 64) {
+  std::vector<std::size_t> offsets;
+  std::size_t offset = 0;
+  for (const auto& spec : specs) {
+    offsets.push_back(offset);
+    auto shape = spec.Shape();
+    std::size_t bytes = Prod(shape.data(), shape.size()) * spec.element_size;
+    offset += (bytes + alignment - 1) / alignment * alignment;
+  }
+  offsets.push_back(offset);
+  return offsets;
+}
+
+/**
+ * Contiguous version of MakeArray.
+ * All the arrays are views of one zero-initialized arena laid out by
+ * ArenaOffsets, which is freed when the last of them is released. The arena
+ * comes from `allocator` if given, aligned to its alignment.
+ */
+inline std::vector<Array> MakeArenaArray(const std::vector<ShapeSpec>& specs,
+                                         Allocator* allocator = nullptr) {
+  std::size_t alignment =
+      allocator == nullptr ? 64 : allocator->Options().alignment;
+  auto offsets = ArenaOffsets(specs, alignment);
+  std::size_t size = std::max(offsets.back(), alignment);
+  std::shared_ptr<char> arena;
+  if (allocator == nullptr) {
+    arena = Allocator().Allocate(size);
+  } else {
+    arena = allocator->Allocate(size);
+  }
+  char* data = arena.get();
+  std::vector<Array> rets;
+  for (std::size_t i = 0; i < specs.size(); ++i) {
+    rets.emplace_back(specs[i],
+                      std::shared_ptr<char>(arena, data + offsets[i]));
+  }
+  return rets;
 }
 
 #endif  // ENVPOOL_CORE_DICT_H_
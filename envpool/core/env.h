@@ -17,13 +17,24 @@
 #ifndef ENVPOOL_CORE_ENV_H_
 #define ENVPOOL_CORE_ENV_H_
 
+#include <atomic>
+#include <cstdint>
+#include <cstring>
 #include <memory>
 #include <random>
+#include <stdexcept>
+#include <string>
+#include <tuple>
 #include <utility>
 #include <vector>
 
 #include "envpool/core/env_spec.h"
+#include "envpool/core/episode_stats.h"
+#include "envpool/core/normalizer.h"
+#include "envpool/core/snapshot.h"
+#include "envpool/core/state_record.h"
 #include "envpool/core/state_buffer_queue.h"
+#include "envpool/core/trajectory_writer.h"
 
 template <typename Dtype>
 struct InitializeHelper {
@@ -48,44 +59,129 @@ void InplaceInitialize(const Spec& spec, Array* arr) {
 /**
  * Single RL environment abstraction.
  */
-template <typename EnvSpec>
+template <typename EnvSpec, typename RandomEngine = std::mt19937>
 class Env {
  protected:
-  int max_num_players_;
-  EnvSpec spec_;
-  int env_id_, seed_;
-  std::mt19937 gen_;
+  // members are ordered to avoid padding, as some pools hold millions of envs
+  int max_num_players_, env_id_, seed_;
+  // index of the spec this env is built from in a multi-task pool
+  int task_id_;
+  // immutable and shared by all the envs built from the same spec
+  std::shared_ptr<const EnvSpec> spec_;
+  RandomEngine gen_;
 
  private:
   StateBufferQueue* sbq_;
-  int order_, current_step_;
-  bool is_single_player_;
-  StateBuffer::WritableSlice slice_;
-  // for parsing single env action from input action batch
-  std::vector<ShapeSpec> action_specs_;
-  std::vector<bool> is_player_action_;
   std::shared_ptr<std::vector<Array>> action_batch_;
-  std::vector<Array> raw_action_;
-  int env_index_;
+  int order_, current_step_, env_index_;
+  // undiscounted return and number of steps of the current episode, and the
+  // number of episodes started before it
+  int episode_length_, episode_id_;
+  float episode_return_;
+  bool is_single_player_;
+  struct StateSink {
+    std::size_t index;
+    bool is_player_state;
+    Array sink;
+    FloatDtype cast;
+    Array target;
+  };
+  // State of the optional features, only allocated if one of them is used,
+  // so that it takes one pointer in the other envs.
+  struct Features {
+    // state keys pruned by the `state_keys` config or cast by `obs_dtype`,
+    // the env writes them to these sinks instead of the state buffer, and a
+    // cast key is converted into `target` when the step is done
+    std::vector<StateSink> state_sink;
+    // pool-wide normalizer and the statistics of this env, see SetNormalizer
+    Normalizer* normalizer = nullptr;
+    std::unique_ptr<Normalizer::Local> norm_local;
+    bool norm_update = false;
+    // ring of the recent episodes of the pool, see SetEpisodeStats
+    EpisodeStats* episode_stats = nullptr;
+    // whether the pool watchdog may abandon a step (see the `step_timeout`
+    // config), and the progress of the current step: step id << 2 | phase
+    bool watched = false;
+    std::atomic<uint64_t> step_phase{0};
+  };
+  std::unique_ptr<Features> features_;
+  // Only live within one EnvStep, which never leaves its thread, so they are
+  // kept per thread instead of per env.
+  static inline thread_local StateBuffer::WritableSlice slice_{
+      {}, [] { LOG(INFO) << "Use `Allocate` to write state."; }};
+  // single env action parsed from the input action batch
+  static inline thread_local std::vector<Array> raw_action_;
+  // set while repeating an action, Allocate then reuses slice_
+  static inline thread_local bool reuse_slice_ = false;
+  // trajectory writer of the calling worker, see SetTrajectoryWriter
+  static inline thread_local TrajectoryWriter* trajectory_writer_ = nullptr;
 
  public:
   using Spec = EnvSpec;
   using State = NamedVector<typename EnvSpec::StateKeys, std::vector<Array>>;
   using Action = NamedVector<typename EnvSpec::ActionKeys, std::vector<Array>>;
+  using Record = StateRecord<typename EnvSpec::StateSpec>;
+
+  // step phases: not in a step, stepping before Allocate, writing the
+  // allocated state, abandoned by the pool watchdog before Allocate
+  static constexpr uint64_t kIdle = 0;
+  static constexpr uint64_t kStepping = 1;
+  static constexpr uint64_t kWriting = 2;
+  static constexpr uint64_t kAbandoned = 3;
+  static constexpr uint64_t kPhaseMask = 3;
 
   Env(const EnvSpec& spec, int env_id)
       : max_num_players_(spec.config["max_num_players"_]),
-        spec_(spec),
         env_id_(env_id),
         seed_(spec.config["seed"_] + env_id),
+        task_id_(0),
+        spec_(ShareSpec(spec)),
         gen_(seed_),
         current_step_(-1),
-        is_single_player_(max_num_players_ == 1),
-        action_specs_(spec.action_spec.template AllValues<ShapeSpec>()),
-        is_player_action_(Transform(action_specs_, [](const ShapeSpec& s) {
-          return (!s.shape.empty() && s.shape[0] == -1);
-        })) {
-    slice_.done_write = [] { LOG(INFO) << "Use `Allocate` to write state."; };
+        episode_length_(0),
+        episode_id_(-1),
+        episode_return_(0),
+        is_single_player_(max_num_players_ == 1) {
+    if (spec.config["action_repeat"_] > 1 && !is_single_player_) {
+      throw std::invalid_argument(
+          "action_repeat only supports single-player envs.");
+    }
+    auto mask = spec.StateMask();
+    auto cast = spec.StateCast();
+    auto shapes = spec.state_spec.template AllValues<ShapeSpec>();
+    for (std::size_t i = 0; i < mask.size(); ++i) {
+      if (!mask[i] || cast[i] != FloatDtype::kFloat64) {
+        ShapeSpec s = shapes[i];
+        bool is_player_state = IsPlayerSpec(s);
+        if (is_player_state) {
+          s.shape[0] = max_num_players_;
+        }
+        FloatDtype c = mask[i] ? cast[i] : FloatDtype::kFloat64;
+        MutableFeatures()->state_sink.push_back(
+            StateSink{i, is_player_state, Array(s), c, Array()});
+      }
+    }
+    if (spec.config["step_timeout"_] > 0) {
+      MutableFeatures()->watched = true;
+    }
+  }
+
+  void SetTaskId(int task_id) { task_id_ = task_id; }
+
+  /**
+   * Normalize the states of this env with the pool-wide `normalizer` (see the
+   * `norm_*` configs), adding them to its statistics if `update` is set.
+   */
+  void SetNormalizer(Normalizer* normalizer, bool update) {
+    if (normalizer == nullptr && features_ == nullptr) {
+      return;
+    }
+    Features* f = MutableFeatures();
+    f->normalizer = normalizer;
+    f->norm_update = update;
+    f->norm_local = normalizer == nullptr
+                        ? nullptr
+                        : normalizer->MakeLocal(max_num_players_);
   }
 
   void SetAction(std::shared_ptr<std::vector<Array>> action_batch,
@@ -96,16 +192,16 @@ class Env {
 
   void ParseAction() {
     raw_action_.clear();
-    std::size_t action_size = action_batch_->size();
     if (is_single_player_) {
-      for (std::size_t i = 0; i < action_size; ++i) {
-        if (is_player_action_[i]) {
-          raw_action_.emplace_back(
-              (*action_batch_)[i].Slice(env_index_, env_index_ + 1));
+      std::size_t i = 0;
+      ForEachActionSpec([&](const ShapeSpec& spec) {
+        const Array& batch = (*action_batch_)[i++];
+        if (IsPlayerSpec(spec)) {
+          raw_action_.emplace_back(batch.Slice(env_index_, env_index_ + 1));
         } else {
-          raw_action_.emplace_back((*action_batch_)[i][env_index_]);
+          raw_action_.emplace_back(batch[env_index_]);
         }
-      }
+      });
     } else {
       std::vector<int> env_player_index;
       int* player_env_id = static_cast<int*>((*action_batch_)[1].Data());
@@ -124,65 +220,361 @@ class Env {
         end = env_player_index[player_num - 1] + 1;
         continuous = (player_num == end - start);
       }
-      for (std::size_t i = 0; i < action_size; ++i) {
-        if (is_player_action_[i]) {
+      std::size_t i = 0;
+      ForEachActionSpec([&](const ShapeSpec& spec) {
+        const Array& batch = (*action_batch_)[i++];
+        if (IsPlayerSpec(spec)) {
           if (continuous) {
-            raw_action_.emplace_back((*action_batch_)[i].Slice(start, end));
+            raw_action_.emplace_back(batch.Slice(start, end));
           } else {
-            action_specs_[i].shape[0] = player_num;
-            Array arr(action_specs_[i]);
+            ShapeSpec player_spec = spec;
+            player_spec.shape[0] = player_num;
+            Array arr(player_spec);
             for (int j = 0; j < player_num; ++j) {
               int player_index = env_player_index[j];
-              arr[j].Assign((*action_batch_)[i][player_index]);
+              arr[j].Assign(batch[player_index]);
             }
             raw_action_.emplace_back(std::move(arr));
           }
         } else {
-          raw_action_.emplace_back((*action_batch_)[i][env_index_]);
+          raw_action_.emplace_back(batch[env_index_]);
         }
-      }
+      });
     }
   }
 
-  void EnvStep(StateBufferQueue* sbq, int order, bool reset) {
+  /**
+   * Run one reset / step and write its state into `sbq`. Returns false if
+   * the step has been abandoned (see Abandon), then nothing is written.
+   * `step_id` tells the step apart from the other steps of this env.
+   */
+  bool EnvStep(StateBufferQueue* sbq, int order, bool reset,
+               uint64_t step_id = 0) {
     PreProcess(sbq, order, reset);
+    Features* f = features_.get();
+    bool watched = f != nullptr && f->watched;
+    if (watched) {
+      // after PreProcess, so that Order() is the one of this step
+      f->step_phase = step_id << 2 | kStepping;
+    }
     if (reset) {
       Reset();
     } else {
       ParseAction();
-      Step(Action(&raw_action_));
+      Action action(&raw_action_);
+      Step(action);
+      RepeatStep(action);
+    }
+    if (watched && (f->step_phase & kPhaseMask) == kAbandoned) {
+      for (auto& s : f->state_sink) {
+        s.target = Array();
+      }
+      slice_.arr.clear();
+      return false;
     }
     PostProcess();
+    if (watched) {
+      f->step_phase = step_id << 2 | kIdle;
+    }
+    return true;
   }
 
+  /**
+   * Give up the current step, called by the pool watchdog (see the
+   * `step_timeout` config) on a step that takes too long. It only succeeds
+   * before the env has allocated its state; the step then goes on writing
+   * to scratch memory, and the pool fills the slot in the state buffer.
+   * Only the step `step_id` of EnvStep is abandoned, not a later one.
+   */
+  bool Abandon(uint64_t step_id) {
+    if (features_ == nullptr || !features_->watched) {
+      return false;
+    }
+    uint64_t phase = step_id << 2 | kStepping;
+    return features_->step_phase.compare_exchange_strong(
+        phase, step_id << 2 | kAbandoned);
+  }
+
+  /**
+   * Order of the current step in the state buffer, see EnvStep.
+   */
+  [[nodiscard]] int Order() const { return order_; }
+
   virtual void Reset() { throw std::runtime_error("reset not implemented"); }
   virtual void Step(const Action& action) {
     throw std::runtime_error("step not implemented");
   }
   virtual bool IsDone() { throw std::runtime_error("is_done not implemented"); }
 
+  /**
+   * Record the episodes of this env to the pool-wide `episode_stats` when
+   * they end, null to disable.
+   */
+  void SetEpisodeStats(EpisodeStats* episode_stats) {
+    if (episode_stats != nullptr || features_ != nullptr) {
+      MutableFeatures()->episode_stats = episode_stats;
+    }
+  }
+
+  /**
+   * Record every step that the calling thread runs to `writer` (see the
+   * `trajectory_dir` config), null to disable. Set by each pool worker.
+   */
+  static void SetTrajectoryWriter(TrajectoryWriter* writer) {
+    trajectory_writer_ = writer;
+  }
+
+  /**
+   * Whether the config `key` can be changed on a live env with `Reconfigure`.
+   * Such a key must not affect the state / action spec. Subclasses hide this
+   * function to whitelist their own keys.
+   */
+  static bool IsHotConfig(const std::string& key) { return false; }
+
+  /**
+   * Switch to a new spec, envpool calls it right before a reset. Subclasses
+   * that whitelist keys in `IsHotConfig` should refresh the members derived
+   * from them here.
+   */
+  virtual void Reconfigure(const EnvSpec& spec) { spec_ = ShareSpec(spec); }
+
+  /**
+   * Replace the seed of this env, envpool calls it right before a reset.
+   * Subclasses that own a seeded simulator should reseed it here as well and
+   * make sure the following reset starts a new episode.
+   */
+  virtual void Reseed(int seed) {
+    seed_ = seed;
+    gen_.seed(seed_);
+  }
+
+  /**
+   * Serialize the full state of this env (simulator, RNG, counters) for
+   * AsyncEnvPool::Save. Subclasses that support snapshots call `SaveEnv`
+   * first and then append their own state; `Load` reads it back in the same
+   * order.
+   */
+  virtual void Save(SnapshotWriter* writer) {
+    throw std::runtime_error("save not implemented");
+  }
+  virtual void Load(SnapshotReader* reader) {
+    throw std::runtime_error("load not implemented");
+  }
+
  protected:
   void PreProcess(StateBufferQueue* sbq, int order, bool reset) {
     sbq_ = sbq;
     order_ = order;
     if (reset) {
       current_step_ = 0;
+      episode_length_ = 0;
+      episode_return_ = 0;
+      ++episode_id_;
     } else {
       ++current_step_;
+      ++episode_length_;
     }
   }
 
+  void SaveEnv(SnapshotWriter* writer) {
+    writer->Write(env_id_);
+    writer->Write(seed_);
+    writer->Write(current_step_);
+    writer->Write(episode_length_);
+    writer->Write(episode_id_);
+    writer->Write(episode_return_);
+    writer->WriteText(gen_);
+  }
+
+  /**
+   * The env takes over the identity (env id, seed) of the saved env, so a
+   * scratch env can continue from the snapshot of another env.
+   */
+  void LoadEnv(SnapshotReader* reader) {
+    reader->Read(&env_id_);
+    reader->Read(&seed_);
+    reader->Read(&current_step_);
+    reader->Read(&episode_length_);
+    reader->Read(&episode_id_);
+    reader->Read(&episode_return_);
+    reader->ReadText(&gen_);
+  }
+
+  /**
+   * Reuse the spec if it is already owned by a shared_ptr (as the ones kept
+   * by AsyncEnvPool), otherwise make a shared copy.
+   */
+  static std::shared_ptr<const EnvSpec> ShareSpec(const EnvSpec& spec) {
+    std::shared_ptr<const EnvSpec> shared = spec.weak_from_this().lock();
+    return shared != nullptr ? shared : std::make_shared<const EnvSpec>(spec);
+  }
+
+  static bool IsPlayerSpec(const ShapeSpec& spec) {
+    return !spec.shape.empty() && spec.shape[0] == -1;
+  }
+
+  template <typename F>
+  void ForEachActionSpec(F&& f) const {
+    std::apply([&](const auto&... spec) { (f(spec), ...); },
+               spec_->action_spec.AllValues());
+  }
+
+  /**
+   * The `action_repeat` stage: step `action` again until done or until it has
+   * been applied `action_repeat` times. All the steps write the same state
+   * slot, so the last state is returned with the sum of the rewards and the
+   * state buffer queue sees one step. The episode length counts every
+   * underlying step, as elapsed_step does.
+   */
+  void RepeatStep(const Action& action) {
+    int repeat = spec_->config["action_repeat"_];
+    if (repeat <= 1) {
+      return;
+    }
+    auto* reward = static_cast<float*>(State(&slice_.arr)["reward"_].Data());
+    float total = *reward;
+    reuse_slice_ = true;
+    try {
+      for (int i = 1; i < repeat && !IsDone(); ++i) {
+        ++current_step_;
+        ++episode_length_;
+        Step(action);
+        total += *reward;
+      }
+    } catch (...) {
+      reuse_slice_ = false;
+      throw;
+    }
+    reuse_slice_ = false;
+    *reward = total;
+  }
+
   void PostProcess() {
+    WriteEpisode();
+    Features* f = features_.get();
+    if (f != nullptr) {
+      if (f->normalizer != nullptr) {
+        f->normalizer->Process(f->norm_local.get(), &slice_.arr, IsDone(),
+                               f->norm_update);
+      }
+      for (auto& s : f->state_sink) {
+        if (s.cast != FloatDtype::kFloat64) {
+          CastFloat(static_cast<const double*>(s.sink.Data()),
+                    s.target.Data(), s.target.size, s.cast);
+        }
+      }
+    }
+    if (trajectory_writer_ != nullptr) {
+      WriteTrajectory();
+    }
+    if (f != nullptr) {
+      for (auto& s : f->state_sink) {
+        // don't hold the state buffer beyond this step
+        s.target = Array();
+      }
+    }
     slice_.done_write();
     // action_batch_.reset();
   }
 
+  /**
+   * Add the (raw) reward of this step to the episode return, and write the
+   * episode return / length, which are the totals of the episode on its last
+   * step. The reward of a multi-player env is summed over the players.
+   */
+  void WriteEpisode() {
+    State state(&slice_.arr);
+    const Array& reward = state["reward"_];
+    const auto* r = static_cast<const float*>(reward.Data());
+    for (std::size_t i = 0; i < reward.size; ++i) {
+      episode_return_ += r[i];
+    }
+    state["info:episode_return"_] = episode_return_;
+    state["info:episode_length"_] = episode_length_;
+    if (features_ != nullptr && features_->episode_stats != nullptr &&
+        IsDone()) {
+      features_->episode_stats->Record(env_id_, episode_return_,
+                                       episode_length_);
+    }
+  }
+
+  /**
+   * Append this step to the trajectory writer of the thread, see
+   * TrajectoryLayout for the record.
+   */
+  void WriteTrajectory() {
+    const TrajectoryLayout& layout = trajectory_writer_->Layout();
+    char* record = trajectory_writer_->Append();
+    State state(&slice_.arr);
+    bool done = IsDone();
+    float reward = state["reward"_][0];
+    std::memcpy(record + TrajectoryLayout::kEnvIdOffset, &env_id_, 4);
+    std::memcpy(record + TrajectoryLayout::kEpisodeOffset, &episode_id_, 4);
+    std::memcpy(record + TrajectoryLayout::kElapsedStepOffset,
+                &current_step_, 4);
+    std::memcpy(record + TrajectoryLayout::kRewardOffset, &reward, 4);
+    std::memcpy(record + TrajectoryLayout::kDoneOffset, &done, 1);
+    for (const auto& f : layout.action) {
+      if (current_step_ == 0) {
+        std::memset(record + f.offset, 0, f.size);
+      } else {
+        std::memcpy(record + f.offset, raw_action_[f.source].Data(), f.size);
+      }
+    }
+    for (const auto& f : layout.obs) {
+      const Array* a = &slice_.arr[f.source];
+      if (features_ != nullptr) {
+        for (const auto& s : features_->state_sink) {
+          if (s.index == f.source && s.cast != FloatDtype::kFloat64) {
+            a = &s.target;
+          }
+        }
+      }
+      std::memcpy(record + f.offset, a->Data(), f.size);
+    }
+    if (done) {
+      trajectory_writer_->EndEpisode(env_id_, episode_id_, episode_length_,
+                                     episode_return_);
+    }
+  }
+
   State Allocate(int player_num = 1) {
-    slice_ = sbq_->Allocate(player_num, order_);
+    if (reuse_slice_) {
+      // a repeated step, see RepeatStep
+      State state(&slice_.arr);
+      state["done"_] = IsDone();
+      state["elapsed_step"_] = current_step_;
+      return state;
+    }
+    Features* f = features_.get();
+    bool abandoned = false;
+    if (f != nullptr && f->watched) {
+      uint64_t step = f->step_phase & ~kPhaseMask;
+      uint64_t phase = step | kStepping;
+      abandoned =
+          !f->step_phase.compare_exchange_strong(phase, step | kWriting) &&
+          (phase & kPhaseMask) == kAbandoned;
+    }
+    if (abandoned) {
+      slice_ = StateBuffer::WritableSlice{ScratchState(player_num), [] {}};
+    } else {
+      slice_ = sbq_->Allocate(player_num, order_);
+    }
+    if (f != nullptr) {
+      for (auto& s : f->state_sink) {
+        if (s.cast != FloatDtype::kFloat64) {
+          s.target = slice_.arr[s.index];
+        }
+        slice_.arr[s.index] =
+            s.is_player_state ? s.sink.Slice(0, player_num) : s.sink;
+      }
+    }
     State state(&slice_.arr);
     state["done"_] = IsDone();
     state["info:env_id"_] = env_id_;
     state["elapsed_step"_] = current_step_;
+    state["info:task_id"_] = task_id_;
+    state["info:env_failed"_] = false;
     int* player_env_id(static_cast<int*>(state["info:players.env_id"_].Data()));
     for (int i = 0; i < player_num; ++i) {
       player_env_id[i] = env_id_;
@@ -193,9 +585,39 @@ class Env {
         [&](auto&&... spec) {
           (InplaceInitialize(spec, &slice_.arr[i++]), ...);
         },
-        spec_.state_spec.AllValues());
+        spec_->state_spec.AllValues());
     return state;
   }
+
+  Features* MutableFeatures() {
+    if (features_ == nullptr) {
+      features_ = std::make_unique<Features>();
+    }
+    return features_.get();
+  }
+
+  /**
+   * Memory for the state of an abandoned step, which no one reads.
+   */
+  std::vector<Array> ScratchState(int player_num) const {
+    std::vector<Array> arr;
+    for (ShapeSpec s : spec_->state_spec.template AllValues<ShapeSpec>()) {
+      if (IsPlayerSpec(s)) {
+        s.shape[0] = player_num;
+      }
+      arr.emplace_back(s);
+    }
+    return arr;
+  }
+
+  /**
+   * Same as Allocate, but returns a typed record (see StateRecord), which
+   * writes the fields with plain stores instead of going through `Array`.
+   */
+  Record AllocateRecord(int player_num = 1) {
+    Allocate(player_num);
+    return Record(&slice_.arr);
+  }
 };
 
 #endif  // ENVPOOL_CORE_ENV_H_
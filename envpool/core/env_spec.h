@@ -17,32 +17,60 @@
 #ifndef ENVPOOL_CORE_ENV_SPEC_H_
 #define ENVPOOL_CORE_ENV_SPEC_H_
 
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
 #include <string>
+#include <tuple>
+#include <type_traits>
+#include <vector>
 
 #include "envpool/core/array.h"
 #include "envpool/core/dict.h"
+#include "envpool/core/float_cast.h"
 
 auto common_config =
     MakeDict("num_envs"_.Bind(1), "batch_size"_.Bind(0), "num_threads"_.Bind(0),
              "max_num_players"_.Bind(1), "thread_affinity_offset"_.Bind(-1),
              "base_path"_.Bind(std::string("envpool")), "seed"_.Bind(42),
-             "gym_reset_return_info"_.Bind(false));
+             "gym_reset_return_info"_.Bind(false), "lazy_init"_.Bind(false),
+             "max_num_envs"_.Bind(0), "contiguous_state"_.Bind(false),
+             "alloc_alignment"_.Bind(64),
+             "alloc_huge_page"_.Bind(std::string("none")),
+             "alloc_zero_fill"_.Bind(true), "alloc_prefault"_.Bind(false),
+             "action_repeat"_.Bind(1),
+             "state_keys"_.Bind(std::vector<std::string>()),
+             "obs_dtype"_.Bind(std::string("float64")),
+             "norm_obs"_.Bind(false), "norm_reward"_.Bind(false),
+             "norm_update"_.Bind(true), "norm_clip"_.Bind(10.0),
+             "norm_gamma"_.Bind(0.99), "norm_epsilon"_.Bind(1e-8),
+             "episode_window"_.Bind(0), "rollout_len"_.Bind(0),
+             "trajectory_dir"_.Bind(std::string("")),
+             "trajectory_shard_mb"_.Bind(256), "step_timeout"_.Bind(0.0));
 // Note: this action order is hardcoded in async_envpool Send function
 // and env ParseAction function for performance
 auto common_action_spec = MakeDict("env_id"_.Bind(Spec<int>({})),
                                    "players.env_id"_.Bind(Spec<int>({-1})));
-// Note: this state order is hardcoded in async_envpool Recv function
+// Note: this state order is hardcoded in async_envpool Recv function. The
+// first kNumRequiredState keys are always produced, the episode statistics
+// and env_failed can be pruned by the `state_keys` config.
 auto common_state_spec =
     MakeDict("info:env_id"_.Bind(Spec<int>({})),
              "info:players.env_id"_.Bind(Spec<int>({-1})),
              "elapsed_step"_.Bind(Spec<int>({})), "done"_.Bind(Spec<bool>({})),
-             "reward"_.Bind(Spec<float>({-1})));
+             "reward"_.Bind(Spec<float>({-1})),
+             "info:task_id"_.Bind(Spec<int>({})),
+             "info:episode_return"_.Bind(Spec<float>({})),
+             "info:episode_length"_.Bind(Spec<int>({})),
+             "info:env_failed"_.Bind(Spec<bool>({})));
 
 /**
  * EnvSpec funciton, it constructs the env spec when a Config is passed.
+ * An EnvSpec owned by a shared_ptr is shared by all the envs built from it,
+ * see Env::ShareSpec.
  */
 template <typename EnvFns>
-class EnvSpec {
+class EnvSpec : public std::enable_shared_from_this<EnvSpec<EnvFns>> {
  public:
   using Config = decltype(ConcatDict(common_config, EnvFns::DefaultConfig()));
   using ConfigKeys = typename Config::Keys;
@@ -73,6 +101,141 @@ class EnvSpec {
           std::to_string(config["num_envs"_]) +
           ", batch_size = " + std::to_string(config["batch_size"_]));
     }
+    if (config["max_num_envs"_] > 0 &&
+        config["max_num_envs"_] < config["num_envs"_]) {
+      throw std::invalid_argument(
+          "It is required that num_envs <= max_num_envs, got num_envs = " +
+          std::to_string(config["num_envs"_]) +
+          ", max_num_envs = " + std::to_string(config["max_num_envs"_]));
+    }
+    if (config["rollout_len"_] > 0 && config["max_num_players"_] != 1) {
+      throw std::invalid_argument(
+          "rollout_len only supports single-player envs, got "
+          "max_num_players = " +
+          std::to_string(config["max_num_players"_]));
+    }
+    if (!config["trajectory_dir"_].empty() &&
+        config["max_num_players"_] != 1) {
+      throw std::invalid_argument(
+          "trajectory_dir only supports single-player envs, got "
+          "max_num_players = " +
+          std::to_string(config["max_num_players"_]));
+    }
+    if (config["step_timeout"_] > 0 && config["action_repeat"_] > 1) {
+      // the repeated steps run after the state is allocated, where a step
+      // can't be abandoned any more
+      throw std::invalid_argument(
+          "step_timeout doesn't support action_repeat > 1, got "
+          "action_repeat = " +
+          std::to_string(config["action_repeat"_]));
+    }
+    CheckStateKeys();
+    ParseFloatDtype(config["obs_dtype"_]);
+  }
+
+  /**
+   * Whether each state key is produced. The first kNumRequiredState common
+   * state keys always are, the others only if the `state_keys` config is
+   * empty or lists them. A listed prefix such as "obs" or "info" keeps all
+   * the keys under it.
+   */
+  [[nodiscard]] std::vector<bool> StateMask() const {
+    const auto& wanted = config["state_keys"_];
+    auto keys = StateSpec::AllKeys();
+    std::vector<bool> mask(keys.size(), true);
+    if (wanted.empty()) {
+      return mask;
+    }
+    for (std::size_t i = kNumRequiredState; i < keys.size(); ++i) {
+      mask[i] = std::any_of(
+          wanted.begin(), wanted.end(),
+          [&](const std::string& w) { return MatchStateKey(keys[i], w); });
+    }
+    return mask;
+  }
+
+  /**
+   * Storage type of each state key. The float64 obs keys are stored as the
+   * `obs_dtype` config: the env still writes float64, and Env casts them
+   * into the state buffer when the step is done. kFloat64 means the key is
+   * stored as declared.
+   */
+  [[nodiscard]] std::vector<FloatDtype> StateCast() const {
+    FloatDtype dtype = ParseFloatDtype(config["obs_dtype"_]);
+    auto keys = StateSpec::AllKeys();
+    std::vector<FloatDtype> cast;
+    cast.reserve(keys.size());
+    std::apply(
+        [&](auto&&... spec) {
+          (
+              [&] {
+                using T = typename std::decay_t<decltype(spec)>::dtype;
+                bool is_float_obs = std::is_same_v<T, double> &&
+                                    MatchStateKey(keys[cast.size()], "obs");
+                cast.push_back(is_float_obs ? dtype : FloatDtype::kFloat64);
+              }(),
+              ...);
+        },
+        state_spec.AllValues());
+    return cast;
+  }
+
+  /**
+   * Shapes of the state buffer. A key that is not produced gets an empty
+   * shape, so that it takes no memory in the state buffer, and a cast key
+   * the element size of its storage type.
+   */
+  [[nodiscard]] std::vector<ShapeSpec> StateShapes() const {
+    auto shapes = state_spec.template AllValues<ShapeSpec>();
+    auto mask = StateMask();
+    auto cast = StateCast();
+    for (std::size_t i = 0; i < shapes.size(); ++i) {
+      if (!mask[i]) {
+        shapes[i] = ShapeSpec(shapes[i].element_size, {0});
+      } else if (cast[i] != FloatDtype::kFloat64) {
+        shapes[i].element_size = static_cast<int>(FloatDtypeSize(cast[i]));
+      }
+    }
+    return shapes;
+  }
+
+  /**
+   * Whether the state `key` is `w` or under the prefix `w`, e.g., "obs:raw"
+   * and "obs.pos" are under "obs".
+   */
+  static bool MatchStateKey(const std::string& key, const std::string& w) {
+    if (key == w) {
+      return true;
+    }
+    return key.size() > w.size() && key.compare(0, w.size(), w) == 0 &&
+           (key[w.size()] == ':' || key[w.size()] == '.');
+  }
+
+ protected:
+  // info:env_id, info:players.env_id, elapsed_step, done, reward and
+  // info:task_id, which envpool itself relies on
+  static constexpr std::size_t kNumRequiredState = 6;
+
+  void CheckStateKeys() const {
+    const auto& wanted = config["state_keys"_];
+    if (wanted.empty()) {
+      return;
+    }
+    auto keys = StateSpec::AllKeys();
+    for (const auto& w : wanted) {
+      if (std::none_of(keys.begin(), keys.end(), [&](const std::string& key) {
+            return MatchStateKey(key, w);
+          })) {
+        throw std::invalid_argument("Unknown state key \"" + w + "\".");
+      }
+    }
+    auto mask = StateMask();
+    for (std::size_t i = 0; i < keys.size(); ++i) {
+      if (mask[i] && MatchStateKey(keys[i], "obs")) {
+        return;
+      }
+    }
+    throw std::invalid_argument("state_keys should keep at least one obs key.");
   }
 };
 
@@ -0,0 +1,77 @@
+/*
+ * Copyright 2022 Garena Online Private Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ENVPOOL_CORE_EPISODE_STATS_H_
+#define ENVPOOL_CORE_EPISODE_STATS_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <tuple>
+#include <vector>
+
+/**
+ * Ring of the most recent finished episodes of a pool, see the
+ * `episode_window` config. The envs record an episode from their worker
+ * thread when it ends; the caller reads the ring with `Recent`.
+ */
+class EpisodeStats {
+ public:
+  struct Episode {
+    int env_id;
+    int length;
+    float ret;
+  };
+  // env ids, returns and lengths, oldest first
+  using Columns =
+      std::tuple<std::vector<int>, std::vector<float>, std::vector<int>>;
+
+ protected:
+  mutable std::mutex mutex_;
+  std::vector<Episode> ring_;
+  // number of episodes recorded so far, the next one goes to count_ % size
+  uint64_t count_;
+
+ public:
+  explicit EpisodeStats(std::size_t window) : ring_(window), count_(0) {}
+
+  void Record(int env_id, float ret, int length) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ring_[count_ % ring_.size()] = Episode{env_id, length, ret};
+    ++count_;
+  }
+
+  [[nodiscard]] Columns Recent() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::size_t num = count_ < ring_.size() ? count_ : ring_.size();
+    Columns columns;
+    auto& [env_id, ret, length] = columns;
+    for (uint64_t i = count_ - num; i < count_; ++i) {
+      const Episode& e = ring_[i % ring_.size()];
+      env_id.push_back(e.env_id);
+      ret.push_back(e.ret);
+      length.push_back(e.length);
+    }
+    return columns;
+  }
+
+  [[nodiscard]] uint64_t Count() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return count_;
+  }
+};
+
+#endif  // ENVPOOL_CORE_EPISODE_STATS_H_
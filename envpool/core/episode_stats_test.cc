@@ -0,0 +1,53 @@
+// Copyright 2022 Garena Online Private Limited
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "envpool/core/episode_stats.h"
+
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <tuple>
+#include <vector>
+
+TEST(EpisodeStatsTest, Ring) {
+  EpisodeStats stats(3);
+  auto [env_id, ret, length] = stats.Recent();
+  EXPECT_TRUE(env_id.empty());
+  for (int i = 0; i < 5; ++i) {
+    stats.Record(i, static_cast<float>(i) / 2, i * 10);
+  }
+  EXPECT_EQ(stats.Count(), 5);
+  std::tie(env_id, ret, length) = stats.Recent();
+  // oldest first
+  EXPECT_EQ(env_id, std::vector<int>({2, 3, 4}));
+  EXPECT_EQ(ret, std::vector<float>({1.0F, 1.5F, 2.0F}));
+  EXPECT_EQ(length, std::vector<int>({20, 30, 40}));
+}
+
+TEST(EpisodeStatsTest, Concurrent) {
+  EpisodeStats stats(100);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&stats, t] {
+      for (int i = 0; i < 1000; ++i) {
+        stats.Record(t, 1.0F, i);
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  EXPECT_EQ(stats.Count(), 4000);
+  EXPECT_EQ(std::get<0>(stats.Recent()).size(), 100);
+}
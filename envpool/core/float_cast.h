@@ -0,0 +1,81 @@
+/*
+ * Copyright 2022 Garena Online Private Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ENVPOOL_CORE_FLOAT_CAST_H_
+#define ENVPOOL_CORE_FLOAT_CAST_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include "envpool/utils/simd.h"
+
+/**
+ * Storage type of the float64 observations, see the `obs_dtype` config.
+ * Float16 and bfloat16 are stored as their uint16 bit patterns.
+ */
+enum class FloatDtype { kFloat64, kFloat32, kFloat16, kBFloat16 };
+
+inline FloatDtype ParseFloatDtype(const std::string& name) {
+  if (name == "float64") {
+    return FloatDtype::kFloat64;
+  }
+  if (name == "float32") {
+    return FloatDtype::kFloat32;
+  }
+  if (name == "float16") {
+    return FloatDtype::kFloat16;
+  }
+  if (name == "bfloat16") {
+    return FloatDtype::kBFloat16;
+  }
+  throw std::invalid_argument(
+      "Unknown obs_dtype " + name +
+      ", should be float64, float32, float16 or bfloat16.");
+}
+
+inline std::size_t FloatDtypeSize(FloatDtype dtype) {
+  static const std::size_t kSizes[] = {8, 4, 2, 2};
+  return kSizes[static_cast<int>(dtype)];
+}
+
+/**
+ * Convert `size` float64 values in `src` to `dtype` in `dst`, with the
+ * kernels of simd::Active(), see envpool/utils/simd.h. The conversions are
+ * FloatToHalf / FloatToBFloat16 of the float32 value.
+ */
+inline void CastFloat(const double* src, void* dst, std::size_t size,
+                      FloatDtype dtype) {
+  const auto& kernels = simd::Active();
+  switch (dtype) {
+    case FloatDtype::kFloat64:
+      std::memcpy(dst, src, size * sizeof(double));
+      break;
+    case FloatDtype::kFloat32:
+      kernels.to_float32(src, static_cast<float*>(dst), size);
+      break;
+    case FloatDtype::kFloat16:
+      kernels.to_float16(src, static_cast<uint16_t*>(dst), size);
+      break;
+    case FloatDtype::kBFloat16:
+      kernels.to_bfloat16(src, static_cast<uint16_t*>(dst), size);
+      break;
+  }
+}
+
+#endif  // ENVPOOL_CORE_FLOAT_CAST_H_
@@ -0,0 +1,92 @@
+// Copyright 2022 Garena Online Private Limited
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "envpool/core/float_cast.h"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+TEST(FloatCastTest, Half) {
+  float inf = std::numeric_limits<float>::infinity();
+  EXPECT_EQ(FloatToHalf(0.0F), 0x0000);
+  EXPECT_EQ(FloatToHalf(-0.0F), 0x8000);
+  EXPECT_EQ(FloatToHalf(1.0F), 0x3C00);
+  EXPECT_EQ(FloatToHalf(-2.0F), 0xC000);
+  EXPECT_EQ(FloatToHalf(0.1F), 0x2E66);
+  EXPECT_EQ(FloatToHalf(65504.0F), 0x7BFF);
+  EXPECT_EQ(FloatToHalf(65519.0F), 0x7BFF);
+  EXPECT_EQ(FloatToHalf(65520.0F), 0x7C00);
+  EXPECT_EQ(FloatToHalf(-inf), 0xFC00);
+  EXPECT_EQ(FloatToHalf(std::nanf("")), 0x7E00);
+  // subnormal halves
+  EXPECT_EQ(FloatToHalf(std::ldexp(1.0F, -14)), 0x0400);
+  EXPECT_EQ(FloatToHalf(std::ldexp(1.0F, -24)), 0x0001);
+  EXPECT_EQ(FloatToHalf(std::ldexp(1.0F, -25)), 0x0000);
+  EXPECT_EQ(FloatToHalf(std::ldexp(1.5F, -25)), 0x0001);
+  EXPECT_EQ(FloatToHalf(std::ldexp(3.0F, -25)), 0x0002);
+  // ties round to even
+  EXPECT_EQ(FloatToHalf(1.0F + std::ldexp(1.0F, -11)), 0x3C00);
+  EXPECT_EQ(FloatToHalf(1.0F + std::ldexp(3.0F, -11)), 0x3C02);
+}
+
+TEST(FloatCastTest, BFloat16) {
+  EXPECT_EQ(FloatToBFloat16(1.0F), 0x3F80);
+  EXPECT_EQ(FloatToBFloat16(-2.0F), 0xC000);
+  EXPECT_EQ(FloatToBFloat16(3.14159265F), 0x4049);
+  EXPECT_EQ(FloatToBFloat16(1.0F + std::ldexp(1.0F, -8)), 0x3F80);
+  EXPECT_EQ(FloatToBFloat16(1.0F + std::ldexp(3.0F, -8)), 0x3F82);
+  EXPECT_EQ(FloatToBFloat16(std::numeric_limits<float>::infinity()), 0x7F80);
+  EXPECT_EQ(FloatToBFloat16(std::nanf("")) & 0x7FC0, 0x7FC0);
+}
+
+TEST(FloatCastTest, Cast) {
+  std::mt19937 gen(0);
+  std::normal_distribution<double> dist(0.0, 100.0);
+  // odd size to cover the tail of the vector loops
+  std::vector<double> src(1003);
+  for (auto& x : src) {
+    x = dist(gen);
+  }
+  src[7] = 1e-7;
+  src[8] = 1e6;
+  std::vector<double> f64(src.size());
+  CastFloat(src.data(), f64.data(), src.size(), FloatDtype::kFloat64);
+  EXPECT_EQ(f64, src);
+  std::vector<float> f32(src.size());
+  CastFloat(src.data(), f32.data(), src.size(), FloatDtype::kFloat32);
+  std::vector<uint16_t> f16(src.size());
+  CastFloat(src.data(), f16.data(), src.size(), FloatDtype::kFloat16);
+  std::vector<uint16_t> bf16(src.size());
+  CastFloat(src.data(), bf16.data(), src.size(), FloatDtype::kBFloat16);
+  for (std::size_t i = 0; i < src.size(); ++i) {
+    auto f = static_cast<float>(src[i]);
+    EXPECT_EQ(f32[i], f);
+    EXPECT_EQ(f16[i], FloatToHalf(f));
+    EXPECT_EQ(bf16[i], FloatToBFloat16(f));
+  }
+}
+
+TEST(FloatCastTest, Dtype) {
+  EXPECT_EQ(ParseFloatDtype("float32"), FloatDtype::kFloat32);
+  EXPECT_EQ(ParseFloatDtype("bfloat16"), FloatDtype::kBFloat16);
+  EXPECT_EQ(FloatDtypeSize(FloatDtype::kFloat64), 8);
+  EXPECT_EQ(FloatDtypeSize(FloatDtype::kFloat16), 2);
+  EXPECT_THROW(ParseFloatDtype("int8"), std::invalid_argument);
+}
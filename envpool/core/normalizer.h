@@ -0,0 +1,361 @@
+/*
+ * Copyright 2022 Garena Online Private Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ENVPOOL_CORE_NORMALIZER_H_
+#define ENVPOOL_CORE_NORMALIZER_H_
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+#include "envpool/core/array.h"
+#include "envpool/core/dict.h"
+
+/**
+ * Running mean and variance of `size` features, with Welford's algorithm.
+ * Two estimates are merged with Chan's parallel formula.
+ */
+class RunningMeanStd {
+ protected:
+  double count_;
+  std::vector<double> mean_, m2_;
+
+ public:
+  explicit RunningMeanStd(std::size_t size = 0)
+      : count_(0), mean_(size), m2_(size) {}
+
+  template <typename T>
+  void Update(const T* x) {
+    count_ += 1;
+    for (std::size_t i = 0; i < mean_.size(); ++i) {
+      double delta = x[i] - mean_[i];
+      mean_[i] += delta / count_;
+      m2_[i] += delta * (x[i] - mean_[i]);
+    }
+  }
+
+  void Merge(const RunningMeanStd& other) {
+    if (other.count_ == 0) {
+      return;
+    }
+    double count = count_ + other.count_;
+    for (std::size_t i = 0; i < mean_.size(); ++i) {
+      double delta = other.mean_[i] - mean_[i];
+      mean_[i] += delta * other.count_ / count;
+      m2_[i] += other.m2_[i] + delta * delta * count_ * other.count_ / count;
+    }
+    count_ = count;
+  }
+
+  void Clear() {
+    count_ = 0;
+    std::fill(mean_.begin(), mean_.end(), 0.0);
+    std::fill(m2_.begin(), m2_.end(), 0.0);
+  }
+
+  /**
+   * Replace the estimate, e.g., with the one exported by another pool.
+   */
+  void Set(double count, const double* mean, const double* var) {
+    count_ = count;
+    for (std::size_t i = 0; i < mean_.size(); ++i) {
+      mean_[i] = mean[i];
+      m2_[i] = var[i] * count;
+    }
+  }
+
+  [[nodiscard]] std::size_t Size() const { return mean_.size(); }
+  [[nodiscard]] double Count() const { return count_; }
+  [[nodiscard]] double Mean(std::size_t i) const { return mean_[i]; }
+  // population variance, 1 before the first sample
+  [[nodiscard]] double Var(std::size_t i) const {
+    return count_ > 0 ? m2_[i] / count_ : 1.0;
+  }
+};
+
+/**
+ * Observation and reward normalization of a pool, see the `norm_*` configs.
+ *
+ * The float obs keys are normalized feature-wise as
+ * clip((x - mean) / sqrt(var + epsilon)), and the reward is divided by the
+ * standard deviation of the discounted return, as VecNormalize does. Each env
+ * keeps the statistics of its own steps in a `Local` (only touched by the
+ * worker thread that steps the env), and merges them into the pool-wide
+ * estimate every few steps, taking a copy of the merged estimate back to
+ * normalize with. The interval grows from 1 to kMaxSyncInterval steps, so
+ * that a fresh pool doesn't normalize with an empty estimate for long.
+ */
+class Normalizer {
+ public:
+  static constexpr int kMaxSyncInterval = 16;
+
+  /**
+   * Per-env statistics since the last merge, and the copy of the pool-wide
+   * estimate that this env normalizes with.
+   */
+  struct Local {
+    std::vector<RunningMeanStd> obs;
+    RunningMeanStd ret;
+    std::vector<std::vector<double>> obs_mean, obs_scale;
+    double ret_scale;
+    // discounted return of each player
+    std::vector<double> returns;
+    int version, num_sync, num_step;
+  };
+
+ protected:
+  // a float obs key, with `size` features per env (or player)
+  struct Key {
+    std::size_t index;
+    bool is_double;
+    std::size_t size;
+  };
+  // Note: this state order is hardcoded in env_spec common_state_spec
+  static constexpr std::size_t kElapsedStepIndex = 2;
+  static constexpr std::size_t kRewardIndex = 4;
+
+  bool norm_obs_, norm_reward_, update_;
+  double clip_, gamma_, epsilon_;
+  std::vector<Key> keys_;
+  mutable std::mutex mutex_;
+  std::vector<RunningMeanStd> obs_;
+  RunningMeanStd ret_;
+  // bumped by Load, so that the envs drop their copy of the estimate
+  std::atomic<int> version_;
+
+ public:
+  template <typename EnvSpec>
+  explicit Normalizer(const EnvSpec& spec)
+      : norm_obs_(spec.config["norm_obs"_]),
+        norm_reward_(spec.config["norm_reward"_]),
+        update_(spec.config["norm_update"_]),
+        clip_(spec.config["norm_clip"_]),
+        gamma_(spec.config["norm_gamma"_]),
+        epsilon_(spec.config["norm_epsilon"_]),
+        ret_(1),
+        version_(0) {
+    if (!norm_obs_) {
+      return;
+    }
+    auto keys = EnvSpec::StateSpec::AllKeys();
+    auto mask = spec.StateMask();
+    std::size_t index = 0;
+    std::apply(
+        [&](auto&&... s) {
+          (
+              [&] {
+                using T = typename std::decay_t<decltype(s)>::dtype;
+                if (std::is_floating_point_v<T> && mask[index] &&
+                    EnvSpec::MatchStateKey(keys[index], "obs")) {
+                  std::size_t size = 1;
+                  for (std::size_t d = 0; d < s.shape.size(); ++d) {
+                    // a player key has one sample per player
+                    if (d > 0 || s.shape[d] != -1) {
+                      size *= s.shape[d];
+                    }
+                  }
+                  keys_.push_back(Key{index, std::is_same_v<T, double>, size});
+                  obs_.emplace_back(size);
+                }
+                ++index;
+              }(),
+              ...);
+        },
+        spec.state_spec.AllValues());
+  }
+
+  template <typename EnvSpec>
+  static bool Enabled(const EnvSpec& spec) {
+    return spec.config["norm_obs"_] || spec.config["norm_reward"_];
+  }
+
+  [[nodiscard]] std::unique_ptr<Local> MakeLocal(int max_num_players) const {
+    auto local = std::make_unique<Local>();
+    for (const auto& key : keys_) {
+      local->obs.emplace_back(key.size);
+      local->obs_mean.emplace_back(key.size, 0.0);
+      local->obs_scale.emplace_back(key.size, 1.0);
+    }
+    local->ret = RunningMeanStd(1);
+    local->ret_scale = 1.0;
+    local->returns.assign(max_num_players, 0.0);
+    // force a copy of the estimate at the first step
+    local->version = -1;
+    local->num_sync = 0;
+    local->num_step = 0;
+    return local;
+  }
+
+  /**
+   * Normalize the state `arr` of one env in place, right before it is handed
+   * to the state buffer queue. With `update`, the raw values are added to the
+   * statistics first.
+   */
+  void Process(Local* local, std::vector<Array>* arr, bool done, bool update) {
+    update = update && update_;
+    if (update) {
+      Accumulate(local, arr);
+    }
+    int interval = std::min(kMaxSyncInterval, local->num_sync + 1);
+    if (local->version != version_ || (update && local->num_step >= interval)) {
+      Sync(local, update);
+    }
+    if (norm_obs_) {
+      for (std::size_t k = 0; k < keys_.size(); ++k) {
+        const Array& a = (*arr)[keys_[k].index];
+        if (keys_[k].is_double) {
+          NormalizeObs(local, k, static_cast<double*>(a.Data()), a.size);
+        } else {
+          NormalizeObs(local, k, static_cast<float*>(a.Data()), a.size);
+        }
+      }
+    }
+    if (norm_reward_) {
+      const Array& reward = (*arr)[kRewardIndex];
+      auto* r = static_cast<float*>(reward.Data());
+      for (std::size_t i = 0; i < reward.size; ++i) {
+        r[i] = static_cast<float>(
+            std::clamp(r[i] * local->ret_scale, -clip_, clip_));
+        if (done) {
+          local->returns[i] = 0;
+        }
+      }
+    }
+  }
+
+  /**
+   * The pool-wide estimate as a flat array: count, mean and var of each
+   * normalized obs key, then of the discounted return. Steps that have not
+   * been merged by their env yet are not included.
+   */
+  [[nodiscard]] std::vector<double> State() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<double> state;
+    auto append = [&](const RunningMeanStd& s) {
+      state.push_back(s.Count());
+      for (std::size_t i = 0; i < s.Size(); ++i) {
+        state.push_back(s.Mean(i));
+      }
+      for (std::size_t i = 0; i < s.Size(); ++i) {
+        state.push_back(s.Var(i));
+      }
+    };
+    for (const auto& s : obs_) {
+      append(s);
+    }
+    append(ret_);
+    return state;
+  }
+
+  /**
+   * Replace the pool-wide estimate with one exported by `State`, e.g., to
+   * evaluate with the statistics of a training pool. The envs pick it up at
+   * their next step.
+   */
+  void Load(const std::vector<double>& state) {
+    std::size_t expected = 3;
+    for (const auto& s : obs_) {
+      expected += 1 + 2 * s.Size();
+    }
+    if (state.size() != expected) {
+      throw std::invalid_argument(
+          "Normalizer state has " + std::to_string(state.size()) +
+          " values, expect " + std::to_string(expected));
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    const double* ptr = state.data();
+    for (auto& s : obs_) {
+      s.Set(ptr[0], ptr + 1, ptr + 1 + s.Size());
+      ptr += 1 + 2 * s.Size();
+    }
+    ret_.Set(ptr[0], ptr + 1, ptr + 2);
+    ++version_;
+  }
+
+ protected:
+  void Accumulate(Local* local, std::vector<Array>* arr) {
+    ++local->num_step;
+    if (norm_obs_) {
+      for (std::size_t k = 0; k < keys_.size(); ++k) {
+        const Array& a = (*arr)[keys_[k].index];
+        for (std::size_t i = 0; i < a.size; i += keys_[k].size) {
+          if (keys_[k].is_double) {
+            local->obs[k].Update(static_cast<double*>(a.Data()) + i);
+          } else {
+            local->obs[k].Update(static_cast<float*>(a.Data()) + i);
+          }
+        }
+      }
+    }
+    if (norm_reward_) {
+      const Array& reward = (*arr)[kRewardIndex];
+      auto* r = static_cast<float*>(reward.Data());
+      bool first = *static_cast<int*>((*arr)[kElapsedStepIndex].Data()) == 0;
+      for (std::size_t i = 0; i < reward.size; ++i) {
+        double& ret = local->returns[i];
+        ret = first ? 0.0 : ret * gamma_ + r[i];
+        local->ret.Update(&ret);
+      }
+    }
+  }
+
+  void Sync(Local* local, bool update) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (std::size_t k = 0; k < obs_.size(); ++k) {
+      if (update) {
+        obs_[k].Merge(local->obs[k]);
+        local->obs[k].Clear();
+      }
+      for (std::size_t i = 0; i < obs_[k].Size(); ++i) {
+        local->obs_mean[k][i] = obs_[k].Mean(i);
+        local->obs_scale[k][i] = 1.0 / std::sqrt(obs_[k].Var(i) + epsilon_);
+      }
+    }
+    if (update) {
+      ret_.Merge(local->ret);
+      local->ret.Clear();
+    }
+    local->ret_scale = 1.0 / std::sqrt(ret_.Var(0) + epsilon_);
+    local->version = version_;
+    local->num_step = 0;
+    ++local->num_sync;
+  }
+
+  template <typename T>
+  void NormalizeObs(const Local* local, std::size_t k, T* x,
+                    std::size_t size) const {
+    const double* mean = local->obs_mean[k].data();
+    const double* scale = local->obs_scale[k].data();
+    std::size_t n = keys_[k].size;
+    for (std::size_t row = 0; row < size; row += n) {
+      T* y = x + row;
+      for (std::size_t i = 0; i < n; ++i) {
+        double v = (y[i] - mean[i]) * scale[i];
+        y[i] = static_cast<T>(std::clamp(v, -clip_, clip_));
+      }
+    }
+  }
+};
+
+#endif  // ENVPOOL_CORE_NORMALIZER_H_
@@ -0,0 +1,140 @@
+// Copyright 2022 Garena Online Private Limited
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "envpool/core/normalizer.h"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include "envpool/core/env_spec.h"
+
+class NormEnvFns {
+ public:
+  static decltype(auto) DefaultConfig() { return MakeDict(); }
+  template <typename Config>
+  static decltype(auto) StateSpec(const Config& conf) {
+    return MakeDict("obs:pos"_.Bind(Spec<double>({2})),
+                    "obs:id"_.Bind(Spec<int>({})),
+                    "info:vel"_.Bind(Spec<float>({2})));
+  }
+  template <typename Config>
+  static decltype(auto) ActionSpec(const Config& conf) {
+    return MakeDict();
+  }
+};
+
+using NormEnvSpec = EnvSpec<NormEnvFns>;
+
+static std::vector<Array> MakeState(const NormEnvSpec& spec) {
+  std::vector<Array> state;
+  for (auto s : spec.state_spec.AllValues<ShapeSpec>()) {
+    if (!s.shape.empty() && s.shape[0] == -1) {
+      s.shape[0] = 1;
+    }
+    state.emplace_back(s);
+  }
+  return state;
+}
+
+TEST(NormalizerTest, RunningMeanStd) {
+  std::mt19937 gen(0);
+  std::normal_distribution<double> dist(3.0, 2.0);
+  RunningMeanStd all(2);
+  RunningMeanStd a(2);
+  RunningMeanStd b(2);
+  EXPECT_EQ(all.Var(0), 1.0);
+  for (int i = 0; i < 1000; ++i) {
+    double x[2] = {dist(gen), -dist(gen)};
+    all.Update(x);
+    (i < 300 ? a : b).Update(x);
+  }
+  a.Merge(b);
+  EXPECT_EQ(a.Count(), 1000);
+  for (std::size_t i = 0; i < 2; ++i) {
+    EXPECT_NEAR(a.Mean(i), all.Mean(i), 1e-9);
+    EXPECT_NEAR(a.Var(i), all.Var(i), 1e-9);
+  }
+  EXPECT_NEAR(all.Mean(0), 3.0, 0.2);
+  EXPECT_NEAR(all.Var(1), 4.0, 0.5);
+}
+
+TEST(NormalizerTest, Obs) {
+  auto config = NormEnvSpec::DEFAULT_CONFIG;
+  config["norm_obs"_] = true;
+  config["norm_clip"_] = 5.0;
+  NormEnvSpec spec(config);
+  Normalizer normalizer(spec);
+  // obs:pos is the only float obs key
+  auto state = normalizer.State();
+  EXPECT_EQ(state.size(), 1 + 4 + 3);
+  auto local = normalizer.MakeLocal(1);
+  auto arr = MakeState(spec);
+  for (int t = 0; t < 200; ++t) {
+    auto* pos = static_cast<double*>(arr[9].Data());
+    pos[0] = t % 2 == 0 ? 1.0 : 3.0;
+    pos[1] = 100.0;
+    arr[11][0] = 7.0F;
+    normalizer.Process(local.get(), &arr, false, true);
+    if (t > 100) {
+      EXPECT_NEAR(pos[0], t % 2 == 0 ? -1.0 : 1.0, 0.05);
+      EXPECT_EQ(pos[1], 0.0);
+    }
+    // not an obs key
+    EXPECT_EQ(static_cast<float>(arr[11][0]), 7.0F);
+  }
+  state = normalizer.State();
+  // the last steps are not merged yet
+  EXPECT_GT(state[0], 200 - Normalizer::kMaxSyncInterval);
+  EXPECT_LE(state[0], 200);
+  EXPECT_NEAR(state[1], 2.0, 0.05);
+  EXPECT_NEAR(state[3], 1.0, 0.05);
+
+  // an evaluation pool with the stats of the training pool
+  config["norm_update"_] = false;
+  Normalizer eval(NormEnvSpec{config});
+  eval.Load(state);
+  auto eval_local = eval.MakeLocal(1);
+  auto* pos = static_cast<double*>(arr[9].Data());
+  pos[0] = 100.0;
+  pos[1] = 100.0;
+  eval.Process(eval_local.get(), &arr, false, true);
+  EXPECT_EQ(pos[0], 5.0);
+  EXPECT_EQ(eval.State()[0], state[0]);
+  EXPECT_THROW(eval.Load(std::vector<double>(3)), std::invalid_argument);
+}
+
+TEST(NormalizerTest, Reward) {
+  auto config = NormEnvSpec::DEFAULT_CONFIG;
+  config["norm_reward"_] = true;
+  NormEnvSpec spec(config);
+  Normalizer normalizer(spec);
+  EXPECT_EQ(normalizer.State().size(), 3);
+  auto local = normalizer.MakeLocal(1);
+  auto arr = MakeState(spec);
+  for (int t = 0; t < 100; ++t) {
+    arr[2] = t % 10;
+    arr[4][0] = t % 10 == 0 ? 0.0F : 2.0F;
+    normalizer.Process(local.get(), &arr, t % 10 == 9, true);
+  }
+  auto state = normalizer.State();
+  EXPECT_GT(state[0], 100 - Normalizer::kMaxSyncInterval);
+  // the returns of an episode are 0, 2, 2 + 2 * 0.99, ...
+  EXPECT_GT(state[1], 2.0);
+  float reward = arr[4][0];
+  EXPECT_NEAR(reward * std::sqrt(state[2]), 2.0, 0.2);
+}
@@ -0,0 +1,118 @@
+/*
+ * Copyright 2022 Garena Online Private Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ENVPOOL_CORE_POLICY_H_
+#define ENVPOOL_CORE_POLICY_H_
+
+#include <dlfcn.h>
+
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "envpool/core/array.h"
+
+/**
+ * A policy that runs inside the pool, see AsyncEnvPool::RunPolicy, e.g., a
+ * scripted bot or a small MLP that doesn't need a Python round trip.
+ */
+class Policy {
+ public:
+  virtual ~Policy() = default;
+
+  /**
+   * Fill the actions of one batch. `state` is the batch as returned by Recv
+   * and `action` is in the layout of Send, both in the order of the keys of
+   * the env spec (e.g., `Env::State` / `Env::Action` can name them). The
+   * arrays of `action` are allocated and `env_id` / `players.env_id` are
+   * already filled; the others are zeros.
+   */
+  virtual void Act(const std::vector<Array>& state,
+                   std::vector<Array>* action) = 0;
+};
+
+/**
+ * Result of AsyncEnvPool::RunPolicy.
+ */
+struct PolicyResult {
+  // env steps received, the sum of their rewards and the wall time (seconds)
+  uint64_t num_steps;
+  double total_reward;
+  double seconds;
+  // env id, return and length of the episodes finished during the run
+  std::vector<int> env_id;
+  std::vector<float> episode_return;
+  std::vector<int> episode_length;
+};
+
+/**
+ * Export `POLICY` from a shared library for PolicyLibrary. The policy is
+ * built as `POLICY(const char* arg)`. The library must be compiled against
+ * the same envpool headers (and with the same compiler) as the pool.
+ */
+#define ENVPOOL_REGISTER_POLICY(POLICY)                      \
+  extern "C" Policy* envpool_create_policy(const char* arg) { \
+    return new POLICY(arg);                                   \
+  }
+
+/**
+ * A policy loaded with dlopen from a shared library that registers it with
+ * ENVPOOL_REGISTER_POLICY.
+ */
+class PolicyLibrary {
+ protected:
+  void* handle_;
+  std::unique_ptr<Policy> policy_;
+
+ public:
+  static constexpr const char* kCreateSymbol = "envpool_create_policy";
+
+  PolicyLibrary(const std::string& path, const std::string& arg)
+      : handle_(dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL)) {
+    if (handle_ == nullptr) {
+      throw std::runtime_error("Cannot load policy library " + path + ": " +
+                               dlerror());
+    }
+    using Create = Policy* (*)(const char*);
+    auto create = reinterpret_cast<Create>(dlsym(handle_, kCreateSymbol));
+    if (create == nullptr) {
+      dlclose(handle_);
+      throw std::runtime_error(path + " doesn't register a policy, use "
+                               "ENVPOOL_REGISTER_POLICY.");
+    }
+    try {
+      policy_.reset(create(arg.c_str()));
+    } catch (...) {
+      dlclose(handle_);
+      throw;
+    }
+  }
+
+  PolicyLibrary(const PolicyLibrary&) = delete;
+  PolicyLibrary& operator=(const PolicyLibrary&) = delete;
+
+  ~PolicyLibrary() {
+    // the policy code lives in the library
+    policy_.reset();
+    dlclose(handle_);
+  }
+
+  [[nodiscard]] Policy* Get() const { return policy_.get(); }
+};
+
+#endif  // ENVPOOL_CORE_POLICY_H_
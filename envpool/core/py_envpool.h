@@ -25,10 +25,12 @@
 #include <memory>
 #include <string>
 #include <tuple>
+#include <type_traits>
 #include <utility>
 #include <vector>
 
 #include "envpool/core/envpool.h"
+#include "envpool/core/float_cast.h"
 
 namespace py = pybind11;
 
@@ -75,6 +77,35 @@ struct ArrayToNumpyHelper<Container<dtype>> {
   }
 };
 
+/**
+ * Numpy dtype of an `obs_dtype` storage type. bfloat16 is not a numpy
+ * builtin, it comes from the ml_dtypes package.
+ */
+inline py::dtype NumpyFloatDtype(FloatDtype dtype) {
+  switch (dtype) {
+    case FloatDtype::kFloat32:
+      return py::dtype("float32");
+    case FloatDtype::kFloat16:
+      return py::dtype("float16");
+    case FloatDtype::kBFloat16:
+      return py::dtype::from_args(
+          py::module::import("ml_dtypes").attr("bfloat16"));
+    default:
+      return py::dtype("float64");
+  }
+}
+
+/**
+ * Convert a float64 Array that is stored as `dtype` to py::array.
+ */
+inline py::array CastArrayToNumpy(const Array& a, FloatDtype dtype) {
+  auto* ptr = new std::shared_ptr<char>(a.SharedPtr());
+  auto capsule = py::capsule(ptr, [](void* ptr) {
+    delete reinterpret_cast<std::shared_ptr<char>*>(ptr);
+  });
+  return py::array(NumpyFloatDtype(dtype), a.Shape(), a.Data(), capsule);
+}
+
 template <typename dtype>
 Array NumpyToArray(const py::array& arr) {
   using ArrayT = py::array_t<dtype, py::array::c_style | py::array::forcecast>;
@@ -143,6 +174,10 @@ class PyEnvSpec : public EnvSpec {
   StateSpecT py_state_spec;
   ActionSpecT py_action_spec;
   typename EnvSpec::ConfigValues py_config_values;
+  // which state keys are returned by recv, see EnvSpec::StateMask
+  std::vector<bool> py_state_mask;
+  // storage type of each state key, see EnvSpec::StateCast
+  std::vector<FloatDtype> py_state_cast;
   static std::vector<std::string> py_config_keys;
   static std::vector<std::string> py_state_keys;
   static std::vector<std::string> py_action_keys;
@@ -152,7 +187,23 @@ class PyEnvSpec : public EnvSpec {
       : EnvSpec(conf),
         py_state_spec(ExportSpecs(EnvSpec::state_spec)),
         py_action_spec(ExportSpecs(EnvSpec::action_spec)),
-        py_config_values(EnvSpec::config.AllValues()) {}
+        py_config_values(EnvSpec::config.AllValues()),
+        py_state_mask(EnvSpec::StateMask()),
+        py_state_cast(EnvSpec::StateCast()) {
+    std::size_t index = 0;
+    std::apply(
+        [&](auto&... spec) {
+          (
+              [&] {
+                if (py_state_cast[index] != FloatDtype::kFloat64) {
+                  std::get<0>(spec) = NumpyFloatDtype(py_state_cast[index]);
+                }
+                ++index;
+              }(),
+              ...);
+        },
+        py_state_spec);
+  }
 };
 template <typename EnvSpec>
 std::vector<std::string> PyEnvSpec<EnvSpec>::py_config_keys =
@@ -168,17 +219,30 @@ typename EnvSpec::ConfigValues PyEnvSpec<EnvSpec>::py_default_config_values =
     EnvSpec::DEFAULT_CONFIG.AllValues();
 
 /**
- * Bind specs to arrs, and return py::array in ret
+ * Bind specs to arrs, and return py::array in ret. The arrays that are not
+ * in `mask` (pruned by the `state_keys` config) are skipped, and the ones
+ * with a `cast` (by the `obs_dtype` config) get their storage type.
  */
 template <typename... Spec>
 void ToNumpy(const std::vector<Array>& arrs, const std::tuple<Spec...>& specs,
+             const std::vector<bool>& mask,
+             const std::vector<FloatDtype>& cast,
              std::vector<py::array>* ret) {
   std::size_t index = 0;
   std::apply(
       [&](auto&&... spec) {
-        (ret->emplace_back(
-             ArrayToNumpyHelper<typename Spec::dtype>::Convert(arrs[index++])),
-         ...);
+        (
+            [&] {
+              using dtype = typename std::decay_t<decltype(spec)>::dtype;
+              if (mask[index] && cast[index] != FloatDtype::kFloat64) {
+                ret->emplace_back(CastArrayToNumpy(arrs[index], cast[index]));
+              } else if (mask[index]) {
+                ret->emplace_back(
+                    ArrayToNumpyHelper<dtype>::Convert(arrs[index]));
+              }
+              ++index;
+            }(),
+            ...);
       },
       specs);
 }
@@ -212,6 +276,11 @@ class PyEnvPool : public EnvPool {
   explicit PyEnvPool(const PySpec& py_spec)
       : EnvPool(py_spec), py_spec(py_spec) {}
 
+  explicit PyEnvPool(const std::vector<PySpec>& py_specs)
+      : EnvPool(std::vector<typename EnvPool::Spec>(py_specs.begin(),
+                                                    py_specs.end())),
+        py_spec(py_specs[0]) {}
+
   /**
    * py api
    */
@@ -232,13 +301,78 @@ class PyEnvPool : public EnvPool {
       py::gil_scoped_release release;
       arr = EnvPool::Recv();
       DCHECK_EQ(arr.size(), std::tuple_size_v<typename EnvPool::State::Keys>);
+      std::size_t arena_size = EnvPool::StateArenaSize();
+      if (arena_size > 0) {
+        // the first state array starts at the arena
+        last_arena_ = Array(ShapeSpec(1, {static_cast<int>(arena_size)}),
+                            arr[0].SharedPtr());
+      }
+    }
+    std::vector<py::array> ret;
+    ret.reserve(EnvPool::State::SIZE);
+    ToNumpy(arr, py_spec.state_spec, py_spec.py_state_mask,
+            py_spec.py_state_cast, &ret);
+    return ret;
+  }
+
+  /**
+   * py api, a uint8 view of the whole buffer of the last PyRecv batch with
+   * contiguous_state.
+   */
+  py::array PyStateArena() {
+    if (last_arena_.size == 0) {
+      throw std::runtime_error(
+          "state_arena requires contiguous_state = True, rollout_len <= 1 "
+          "and a previous recv.");
+    }
+    return ArrayToNumpyHelper<uint8_t>::Convert(last_arena_);
+  }
+
+  /**
+   * py api
+   */
+  std::vector<py::array> PyRollout(bool check_env_id) {
+    std::vector<Array> arr = EnvPool::Rollout(check_env_id);
+    std::vector<py::array> ret;
+    ret.reserve(EnvPool::State::SIZE);
+    ToNumpy(arr, py_spec.state_spec, py_spec.py_state_mask,
+            py_spec.py_state_cast, &ret);
+    return ret;
+  }
+
+  /**
+   * py api
+   */
+  std::vector<py::array> PyBranch(int env_id,
+                                  const std::vector<py::array>& action) {
+    std::vector<Array> arr;
+    arr.reserve(action.size());
+    ToArray(action, py_spec.action_spec, &arr);
+    std::vector<Array> state;
+    {
+      py::gil_scoped_release release;
+      state = EnvPool::Branch(env_id, arr);
     }
     std::vector<py::array> ret;
     ret.reserve(EnvPool::State::SIZE);
-    ToNumpy(arr, py_spec.state_spec, &ret);
+    ToNumpy(state, py_spec.state_spec, py_spec.py_state_mask,
+            py_spec.py_state_cast, &ret);
     return ret;
   }
 
+  /**
+   * py api
+   */
+  std::tuple<uint64_t, double, double, std::vector<int>, std::vector<float>,
+             std::vector<int>>
+  PyRunPolicy(const std::string& path, const std::string& arg,
+              std::size_t num_steps, std::size_t num_episodes) {
+    py::gil_scoped_release release;
+    auto r = EnvPool::RunPolicy(path, arg, num_steps, num_episodes);
+    return {r.num_steps, r.total_reward, r.seconds, std::move(r.env_id),
+            std::move(r.episode_return), std::move(r.episode_length)};
+  }
+
   /**
    * py api
    */
@@ -248,6 +382,71 @@ class PyEnvPool : public EnvPool {
     py::gil_scoped_release release;
     EnvPool::Reset(arr);
   }
+
+  /**
+   * py api
+   */
+  void PyReconfigure(const std::vector<PySpec>& specs) {
+    EnvPool::Reconfigure(
+        std::vector<typename EnvPool::Spec>(specs.begin(), specs.end()));
+    py_spec = specs[0];
+  }
+
+  /**
+   * py api
+   */
+  std::vector<int> PyAddEnvs(std::size_t num) {
+    std::vector<int> env_ids;
+    {
+      py::gil_scoped_release release;
+      env_ids = EnvPool::AddEnvs(num);
+    }
+    SyncPySpec();
+    return env_ids;
+  }
+
+  /**
+   * py api
+   */
+  void PyRemoveEnvs(const std::vector<int>& env_ids) {
+    {
+      py::gil_scoped_release release;
+      EnvPool::RemoveEnvs(env_ids);
+    }
+    SyncPySpec();
+  }
+
+  /**
+   * py api
+   */
+  void PySave(const std::string& path) {
+    py::gil_scoped_release release;
+    EnvPool::Save(path);
+  }
+
+  /**
+   * py api
+   */
+  void PyLoad(const std::string& path) {
+    {
+      py::gil_scoped_release release;
+      EnvPool::Load(path);
+    }
+    SyncPySpec();
+  }
+
+ private:
+  // the buffer of the last PyRecv batch, see PyStateArena
+  Array last_arena_;
+
+  /**
+   * Keep the exported config in sync with num_envs / batch_size.
+   */
+  void SyncPySpec() {
+    py_spec.config["num_envs"_] = this->spec_.config["num_envs"_];
+    py_spec.config["batch_size"_] = this->spec_.config["batch_size"_];
+    py_spec.py_config_values = py_spec.config.AllValues();
+  }
 };
 
 template <typename EnvPool>
@@ -270,6 +469,7 @@ py::object abc_meta = py::module::import("abc").attr("ABCMeta");
       .def_readonly("_config_values", &SPEC::py_config_values)       \
       .def_readonly("_state_spec", &SPEC::py_state_spec)             \
       .def_readonly("_action_spec", &SPEC::py_action_spec)           \
+      .def_readonly("_state_mask", &SPEC::py_state_mask)             \
       .def_readonly_static("_state_keys", &SPEC::py_state_keys)      \
       .def_readonly_static("_action_keys", &SPEC::py_action_keys)    \
       .def_readonly_static("_config_keys", &SPEC::py_config_keys)    \
@@ -277,10 +477,27 @@ py::object abc_meta = py::module::import("abc").attr("ABCMeta");
                            &SPEC::py_default_config_values);         \
   py::class_<ENVPOOL>(MODULE, "_" #ENVPOOL, py::metaclass(abc_meta)) \
       .def(py::init<const SPEC&>())                                  \
+      .def(py::init<const std::vector<SPEC>&>())                     \
       .def_readonly("_spec", &ENVPOOL::py_spec)                      \
       .def("_recv", &ENVPOOL::PyRecv)                                \
       .def("_send", &ENVPOOL::PySend)                                \
       .def("_reset", &ENVPOOL::PyReset)                              \
+      .def("_branch", &ENVPOOL::PyBranch)                            \
+      .def("_reconfigure", &ENVPOOL::PyReconfigure)                  \
+      .def("_env_init_time", &ENVPOOL::EnvInitTime)                  \
+      .def("_stats", &ENVPOOL::Stats)                                \
+      .def("_env_ids", &ENVPOOL::EnvIds)                             \
+      .def("_add_envs", &ENVPOOL::PyAddEnvs)                         \
+      .def("_remove_envs", &ENVPOOL::PyRemoveEnvs)                   \
+      .def("_reseed", &ENVPOOL::Reseed)                              \
+      .def("_save", &ENVPOOL::PySave)                                \
+      .def("_load", &ENVPOOL::PyLoad)                                \
+      .def("_normalizer_state", &ENVPOOL::NormalizerState)           \
+      .def("_load_normalizer_state", &ENVPOOL::LoadNormalizerState)  \
+      .def("_recent_episodes", &ENVPOOL::RecentEpisodes)             \
+      .def("_rollout", &ENVPOOL::PyRollout)                          \
+      .def("_state_arena", &ENVPOOL::PyStateArena)                   \
+      .def("_run_policy", &ENVPOOL::PyRunPolicy)                     \
       .def_readonly_static("_state_keys", &ENVPOOL::py_state_keys)   \
       .def_readonly_static("_action_keys", &ENVPOOL::py_action_keys);
 
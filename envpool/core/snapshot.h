@@ -0,0 +1,240 @@
+/*
+ * Copyright 2022 Garena Online Private Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ENVPOOL_CORE_SNAPSHOT_H_
+#define ENVPOOL_CORE_SNAPSHOT_H_
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "envpool/core/array.h"
+
+/**
+ * Byte buffer that an env serializes its state into.
+ */
+class SnapshotWriter {
+ protected:
+  std::string buf_;
+
+ public:
+  void WriteBytes(const void* data, std::size_t size) {
+    buf_.append(static_cast<const char*>(data), size);
+  }
+
+  template <typename T>
+  void Write(const T& value) {
+    static_assert(std::is_trivially_copyable_v<T>,
+                  "Use WriteText for non trivially copyable types.");
+    WriteBytes(&value, sizeof(T));
+  }
+
+  void Write(const std::string& value) {
+    Write(value.size());
+    WriteBytes(value.data(), value.size());
+  }
+
+  void Write(const Array& value) {
+    WriteBytes(value.Data(), value.size * value.element_size);
+  }
+
+  /**
+   * For the types that only support `operator<<`, e.g., std::mt19937 and
+   * std::normal_distribution.
+   */
+  template <typename T>
+  void WriteText(const T& value) {
+    std::ostringstream os;
+    os << value;
+    Write(os.str());
+  }
+
+  [[nodiscard]] const std::string& Data() const { return buf_; }
+};
+
+/**
+ * Reads back what SnapshotWriter wrote, in the same order.
+ */
+class SnapshotReader {
+ protected:
+  const char* data_;
+  std::size_t size_, pos_;
+
+ public:
+  SnapshotReader(const char* data, std::size_t size)
+      : data_(data), size_(size), pos_(0) {}
+
+  void ReadBytes(void* data, std::size_t size) {
+    if (pos_ + size > size_) {
+      throw std::runtime_error("Snapshot is truncated.");
+    }
+    std::memcpy(data, data_ + pos_, size);
+    pos_ += size;
+  }
+
+  template <typename T>
+  void Read(T* value) {
+    static_assert(std::is_trivially_copyable_v<T>,
+                  "Use ReadText for non trivially copyable types.");
+    ReadBytes(value, sizeof(T));
+  }
+
+  void Read(std::string* value) {
+    std::size_t size;
+    Read(&size);
+    if (pos_ + size > size_) {
+      throw std::runtime_error("Snapshot is truncated.");
+    }
+    value->assign(data_ + pos_, size);
+    pos_ += size;
+  }
+
+  /**
+   * The array should be allocated with the same shape as the saved one.
+   */
+  void Read(Array* value) {
+    ReadBytes(value->Data(), value->size * value->element_size);
+  }
+
+  template <typename T>
+  void ReadText(T* value) {
+    std::string text;
+    Read(&text);
+    std::istringstream is(text);
+    is >> *value;
+  }
+};
+
+/**
+ * Memory-mapped snapshot file that holds a list of blobs.
+ *
+ * Layout: magic, blob count, (offset, size) of each blob, blob contents.
+ * The blobs are independent, so they can be copied in / out in parallel.
+ */
+class SnapshotFile {
+ protected:
+  static constexpr uint64_t kMagic = 0x50414e5350564e45;  // "ENVPSNAP"
+  char* data_;
+  std::size_t size_;
+  std::vector<std::pair<uint64_t, uint64_t>> blobs_;
+
+  SnapshotFile(char* data, std::size_t size) : data_(data), size_(size) {}
+
+  /**
+   * Map `path` into memory. A writable file is created with `*size` bytes,
+   * otherwise `*size` is set to the size of the existing file.
+   */
+  static char* Map(const std::string& path, std::size_t* size, bool writable) {
+    int fd = writable ? open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644)
+                      : open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      throw std::runtime_error("Cannot open snapshot " + path);
+    }
+    if (writable && ftruncate(fd, static_cast<off_t>(*size)) != 0) {
+      close(fd);
+      throw std::runtime_error("Cannot resize snapshot " + path);
+    }
+    if (!writable) {
+      off_t end = lseek(fd, 0, SEEK_END);
+      *size = end < 0 ? 0 : static_cast<std::size_t>(end);
+    }
+    int prot = writable ? PROT_READ | PROT_WRITE : PROT_READ;
+    void* ptr =
+        *size == 0 ? MAP_FAILED : mmap(nullptr, *size, prot, MAP_SHARED, fd, 0);
+    close(fd);
+    if (ptr == MAP_FAILED) {
+      throw std::runtime_error("Cannot map snapshot " + path);
+    }
+    return static_cast<char*>(ptr);
+  }
+
+ public:
+  SnapshotFile(const SnapshotFile&) = delete;
+  SnapshotFile& operator=(const SnapshotFile&) = delete;
+
+  ~SnapshotFile() { munmap(data_, size_); }
+
+  /**
+   * Create (or overwrite) a snapshot file that fits blobs of the given sizes.
+   */
+  static std::unique_ptr<SnapshotFile> Create(
+      const std::string& path, const std::vector<std::size_t>& sizes) {
+    std::size_t header = sizeof(uint64_t) * (2 + 2 * sizes.size());
+    std::size_t total = header;
+    for (auto s : sizes) {
+      total += s;
+    }
+    std::unique_ptr<SnapshotFile> file(
+        new SnapshotFile(Map(path, &total, true), total));
+    auto* head = reinterpret_cast<uint64_t*>(file->data_);
+    head[0] = kMagic;
+    head[1] = sizes.size();
+    uint64_t offset = header;
+    for (std::size_t i = 0; i < sizes.size(); ++i) {
+      head[2 + 2 * i] = offset;
+      head[3 + 2 * i] = sizes[i];
+      file->blobs_.emplace_back(offset, sizes[i]);
+      offset += sizes[i];
+    }
+    return file;
+  }
+
+  /**
+   * Open an existing snapshot file as read-only.
+   */
+  static std::unique_ptr<SnapshotFile> Open(const std::string& path) {
+    std::size_t size = 0;
+    char* data = Map(path, &size, false);
+    std::unique_ptr<SnapshotFile> file(new SnapshotFile(data, size));
+    const auto* head = reinterpret_cast<const uint64_t*>(file->data_);
+    if (file->size_ < 2 * sizeof(uint64_t) || head[0] != kMagic) {
+      throw std::runtime_error(path + " is not an envpool snapshot.");
+    }
+    std::size_t count = head[1];
+    if (file->size_ < sizeof(uint64_t) * (2 + 2 * count)) {
+      throw std::runtime_error("Snapshot " + path + " is truncated.");
+    }
+    for (std::size_t i = 0; i < count; ++i) {
+      uint64_t offset = head[2 + 2 * i];
+      uint64_t blob_size = head[3 + 2 * i];
+      if (offset + blob_size > file->size_) {
+        throw std::runtime_error("Snapshot " + path + " is truncated.");
+      }
+      file->blobs_.emplace_back(offset, blob_size);
+    }
+    return file;
+  }
+
+  [[nodiscard]] std::size_t Count() const { return blobs_.size(); }
+  [[nodiscard]] std::size_t BlobSize(std::size_t i) const {
+    return blobs_[i].second;
+  }
+  [[nodiscard]] char* Blob(std::size_t i) const {
+    return data_ + blobs_[i].first;
+  }
+};
+
+#endif  // ENVPOOL_CORE_SNAPSHOT_H_
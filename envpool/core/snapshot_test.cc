@@ -0,0 +1,82 @@
+// Copyright 2022 Garena Online Private Limited
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "envpool/core/snapshot.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+TEST(SnapshotTest, WriterReader) {
+  std::mt19937 gen(42);
+  gen();
+  std::normal_distribution<> dist;
+  dist(gen);
+  Array arr(Spec<float>({2, 3}));
+  for (int i = 0; i < 6; ++i) {
+    static_cast<float*>(arr.Data())[i] = i * 0.5F;
+  }
+  SnapshotWriter writer;
+  writer.Write(3);
+  writer.Write(true);
+  writer.Write(std::string("envpool"));
+  writer.Write(arr);
+  writer.WriteText(gen);
+  writer.WriteText(dist);
+
+  SnapshotReader reader(writer.Data().data(), writer.Data().size());
+  int i;
+  bool b;
+  std::string s;
+  Array arr2(Spec<float>({2, 3}));
+  std::mt19937 gen2;
+  std::normal_distribution<> dist2;
+  reader.Read(&i);
+  reader.Read(&b);
+  reader.Read(&s);
+  reader.Read(&arr2);
+  reader.ReadText(&gen2);
+  reader.ReadText(&dist2);
+  EXPECT_EQ(i, 3);
+  EXPECT_TRUE(b);
+  EXPECT_EQ(s, "envpool");
+  for (int j = 0; j < 6; ++j) {
+    EXPECT_EQ(static_cast<float*>(arr2.Data())[j], j * 0.5F);
+  }
+  EXPECT_EQ(gen(), gen2());
+  EXPECT_EQ(dist(gen), dist2(gen2));
+  EXPECT_THROW(reader.Read(&i), std::runtime_error);
+}
+
+TEST(SnapshotTest, File) {
+  std::string path = testing::TempDir() + "snapshot_test.bin";
+  std::vector<std::string> blobs({"abc", "", "0123456789"});
+  {
+    auto file = SnapshotFile::Create(path, {3, 0, 10});
+    for (std::size_t i = 0; i < blobs.size(); ++i) {
+      std::memcpy(file->Blob(i), blobs[i].data(), blobs[i].size());
+    }
+  }
+  auto file = SnapshotFile::Open(path);
+  EXPECT_EQ(file->Count(), blobs.size());
+  for (std::size_t i = 0; i < blobs.size(); ++i) {
+    EXPECT_EQ(std::string(file->Blob(i), file->BlobSize(i)), blobs[i]);
+  }
+  std::remove(path.c_str());
+  EXPECT_THROW(SnapshotFile::Open(path), std::runtime_error);
+}
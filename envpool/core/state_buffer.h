@@ -28,6 +28,7 @@
 #include <utility>
 #include <vector>
 
+#include "envpool/core/allocator.h"
 #include "envpool/core/array.h"
 #include "envpool/core/dict.h"
 #include "envpool/core/spec.h"
@@ -63,14 +64,29 @@ class StateBuffer {
 
   /**
    * Create a StateBuffer instance with the player_specs and shared_specs
-   * provided.
+   * provided. With `contiguous`, all the state arrays of this batch live in
+   * one aligned arena (see MakeArenaArray) instead of one allocation each.
+   * The memory comes from `allocator` if it is not null.
    */
   StateBuffer(std::size_t batch, std::size_t max_num_players,
               const std::vector<ShapeSpec>& specs,
-              std::vector<bool> is_player_state)
+              std::vector<bool> is_player_state, bool contiguous = false,
+              Allocator* allocator = nullptr)
       : batch_(batch),
         max_num_players_(max_num_players),
-        arrays_(MakeArray(specs)),
+        arrays_(contiguous ? MakeArenaArray(specs, allocator)
+                           : MakeArray(specs, allocator)),
+        is_player_state_(std::move(is_player_state)) {}
+
+  /**
+   * Create a StateBuffer over existing state arrays, e.g., the rows of one
+   * step of a rollout (see StateBufferQueue).
+   */
+  StateBuffer(std::size_t batch, std::size_t max_num_players,
+              std::vector<Array> arrays, std::vector<bool> is_player_state)
+      : batch_(batch),
+        max_num_players_(max_num_players),
+        arrays_(std::move(arrays)),
         is_player_state_(std::move(is_player_state)) {}
 
   /**
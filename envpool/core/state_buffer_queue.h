@@ -25,33 +25,62 @@
 #include <utility>
 #include <vector>
 
+#include "envpool/core/allocator.h"
 #include "envpool/core/array.h"
 #include "envpool/core/circular_buffer.h"
 #include "envpool/core/spec.h"
 #include "envpool/core/state_buffer.h"
 #include "lightweightsemaphore.h"
 
+/**
+ * Circular queue of the state buffers that the envs write into.
+ *
+ * With `rollout_len` T > 1, the buffers come in blocks of T consecutive
+ * batches whose state arrays are the rows of one [T * batch, ...] array per
+ * key, so that step t of a rollout is written directly into rows t * batch
+ * to (t + 1) * batch. Once the last batch of a block is received, the whole
+ * block is available from Rollout as [T, batch, ...] arrays, while the next
+ * block is filled in separate memory.
+ */
 class StateBufferQueue {
  protected:
+  // the state buffers of one rollout and their [T * batch, ...] arrays
+  struct Block {
+    std::vector<std::unique_ptr<StateBuffer>> steps;
+    std::vector<Array> arrays;
+  };
+
   std::size_t batch_;
   std::size_t max_num_players_;
+  std::size_t rollout_len_;
   std::vector<bool> is_player_state_;
   std::vector<ShapeSpec> specs_;
+  bool contiguous_;
+  Allocator* allocator_;
   std::size_t queue_size_;
   std::vector<std::unique_ptr<StateBuffer>> queue_;
+  // arrays of each block in the queue, only with rollout_len > 1
+  std::vector<std::vector<Array>> rollout_arrays_;
+  // the block whose buffers replace the ones consumed by Wait
+  Block next_;
+  // the last complete rollout, not taken by Rollout yet
+  std::vector<Array> rollout_;
   std::atomic<uint64_t> alloc_count_, done_ptr_, alloc_tail_;
 
   // Create stock statebuffers in a background thread
-  CircularBuffer<std::unique_ptr<StateBuffer>> stock_buffer_;
+  CircularBuffer<Block> stock_buffer_;
   std::vector<std::thread> create_buffer_thread_;
   std::atomic<bool> quit_;
 
  public:
   StateBufferQueue(std::size_t batch_env, std::size_t num_envs,
                    std::size_t max_num_players,
-                   const std::vector<ShapeSpec>& specs)
+                   const std::vector<ShapeSpec>& specs,
+                   bool contiguous = false, Allocator* allocator = nullptr,
+                   std::size_t rollout_len = 1)
       : batch_(batch_env),
         max_num_players_(max_num_players),
+        rollout_len_(rollout_len),
         is_player_state_(Transform(specs,
                                    [](const ShapeSpec& s) {
                                      return (!s.shape.empty() &&
@@ -66,20 +95,28 @@ class StateBufferQueue {
                            }
                            return s.Batch(batch_);
                          })),
-        // two times enough buffer for all the envs
-        queue_size_((num_envs / batch_env + 2) * 2),
+        contiguous_(contiguous),
+        allocator_(allocator),
+        // two times enough buffer for all the envs, in whole blocks
+        queue_size_(((num_envs / batch_env + 2) * 2 + rollout_len - 1) /
+                    rollout_len * rollout_len),
         queue_(queue_size_),  // circular buffer
         alloc_count_(0),
         done_ptr_(0),
-        stock_buffer_((num_envs / batch_env + 2) * 2),
+        stock_buffer_(queue_size_ / rollout_len),
         quit_(false) {
     // Only initialize first half of the buffer
     // At the consumption of each block, the first consumping thread
     // will allocate a new state buffer and append to the tail.
     // alloc_tail_ = num_envs / batch_env + 2;
-    for (auto& q : queue_) {
-      q = std::make_unique<StateBuffer>(batch_, max_num_players_, specs_,
-                                        is_player_state_);
+    for (std::size_t i = 0; i < queue_size_; i += rollout_len_) {
+      Block block = MakeBlock();
+      for (std::size_t t = 0; t < rollout_len_; ++t) {
+        queue_[i + t] = std::move(block.steps[t]);
+      }
+      if (rollout_len_ > 1) {
+        rollout_arrays_.push_back(std::move(block.arrays));
+      }
     }
     std::size_t processor_count = std::thread::hardware_concurrency();
     // hardcode here :(
@@ -87,8 +124,7 @@ class StateBufferQueue {
     for (std::size_t i = 0; i < create_buffer_thread_num; ++i) {
       create_buffer_thread_.emplace_back(std::thread([&]() {
         while (true) {
-          stock_buffer_.Put(std::make_unique<StateBuffer>(
-              batch_, max_num_players_, specs_, is_player_state_));
+          stock_buffer_.Put(MakeBlock());
           if (quit_) {
             break;
           }
@@ -139,17 +175,99 @@ class StateBufferQueue {
    * time of each state buffer is in the same order as the allocation time.
    */
   std::vector<Array> Wait(std::size_t additional_done_count = 0) {
-    std::unique_ptr<StateBuffer> newbuf = stock_buffer_.Get();
     std::size_t pos = done_ptr_.fetch_add(1);
+    std::size_t step = pos % rollout_len_;
+    if (step == 0) {
+      next_ = stock_buffer_.Get();
+    }
     std::size_t offset = pos % queue_size_;
     auto arr = queue_[offset]->Wait(additional_done_count);
     if (additional_done_count > 0) {
       // move pointer to the next block
       alloc_count_.fetch_add(additional_done_count);
     }
-    std::swap(queue_[offset], newbuf);
+    std::swap(queue_[offset], next_.steps[step]);
+    if (rollout_len_ > 1 && step == rollout_len_ - 1) {
+      auto& arrays = rollout_arrays_[offset / rollout_len_];
+      rollout_ = ToRollout(arrays);
+      arrays = std::move(next_.arrays);
+    }
     return arr;
   }
+
+  /**
+   * Size in bytes of the arena of each batch returned by Wait, which starts
+   * at the data of its first array and holds the arrays at ArenaOffsets of
+   * the full batch shapes. 0 if a batch is not one arena, i.e., without
+   * `contiguous` or with rollout_len > 1 (the steps of a rollout interleave).
+   */
+  [[nodiscard]] std::size_t ArenaSize() const {
+    if (!contiguous_ || rollout_len_ > 1) {
+      return 0;
+    }
+    std::size_t alignment =
+        allocator_ == nullptr ? 64 : allocator_->Options().alignment;
+    return std::max(ArenaOffsets(specs_, alignment).back(), alignment);
+  }
+
+  /**
+   * Take the last complete rollout, as one [T, batch, ...] array per key.
+   * Empty if no rollout has completed since the last call. The arrays own
+   * their memory, the queue never writes to it again.
+   */
+  std::vector<Array> Rollout() {
+    std::vector<Array> ret;
+    std::swap(ret, rollout_);
+    return ret;
+  }
+
+ protected:
+  Block MakeBlock() {
+    Block block;
+    if (rollout_len_ == 1) {
+      block.steps.push_back(std::make_unique<StateBuffer>(
+          batch_, max_num_players_, specs_, is_player_state_, contiguous_,
+          allocator_));
+      return block;
+    }
+    auto specs = Transform(specs_, [this](ShapeSpec s) {
+      s.shape[0] *= static_cast<int>(rollout_len_);
+      return s;
+    });
+    block.arrays = contiguous_ ? MakeArenaArray(specs, allocator_)
+                               : MakeArray(specs, allocator_);
+    for (std::size_t t = 0; t < rollout_len_; ++t) {
+      std::vector<Array> arrays;
+      arrays.reserve(specs_.size());
+      for (std::size_t i = 0; i < specs_.size(); ++i) {
+        std::size_t rows = specs_[i].shape[0];
+        arrays.push_back(Rows(block.arrays[i], t * rows, specs_[i]));
+      }
+      block.steps.push_back(std::make_unique<StateBuffer>(
+          batch_, max_num_players_, std::move(arrays), is_player_state_));
+    }
+    return block;
+  }
+
+  // the `spec.shape[0]` rows of `a` from `start`, sharing its memory
+  static Array Rows(const Array& a, std::size_t start, const ShapeSpec& spec) {
+    std::size_t row_size = a.Shape(0) > 0 ? a.size / a.Shape(0) : 0;
+    char* data =
+        static_cast<char*>(a.Data()) + start * row_size * a.element_size;
+    return Array(spec, std::shared_ptr<char>(a.SharedPtr(), data));
+  }
+
+  // view a [T * rows, ...] array as [T, rows, ...]
+  std::vector<Array> ToRollout(const std::vector<Array>& arrays) const {
+    std::vector<Array> ret;
+    ret.reserve(arrays.size());
+    for (std::size_t i = 0; i < arrays.size(); ++i) {
+      ShapeSpec spec = specs_[i];
+      spec.shape.insert(spec.shape.begin(), static_cast<int>(rollout_len_));
+      ret.emplace_back(spec, arrays[i].SharedPtr());
+    }
+    return ret;
+  }
 };
 
 #endif  // ENVPOOL_CORE_STATE_BUFFER_QUEUE_H_
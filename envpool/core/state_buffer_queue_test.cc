@@ -202,3 +202,70 @@ TEST(StateBufferQueueTest, ConcurrentMultiPlayer) {
     }
   }
 }
+
+TEST(StateBufferQueueTest, Rollout) {
+  std::vector<ShapeSpec> specs{ShapeSpec(4, {-1}), ShapeSpec(8, {3})};
+  std::size_t batch = 8;
+  std::size_t num_envs = 8;
+  std::size_t rollout_len = 5;
+  StateBufferQueue queue(batch, num_envs, 1, specs, false, nullptr,
+                         rollout_len);
+  std::vector<Array> last;
+  for (std::size_t r = 0; r < 3; ++r) {
+    for (std::size_t t = 0; t < rollout_len; ++t) {
+      EXPECT_TRUE(queue.Rollout().empty());
+      for (std::size_t i = 0; i < batch; ++i) {
+        auto slice = queue.Allocate(1, i);
+        slice.arr[0] = static_cast<int>(r * 100 + t * 10 + i);
+        slice.arr[1][2] = static_cast<double>(t);
+        slice.done_write();
+      }
+      auto out = queue.Wait();
+      EXPECT_EQ(out[0].Shape(0), batch);
+      EXPECT_EQ(static_cast<int>(out[0][batch - 1]), r * 100 + t * 10 + 7);
+    }
+    auto rollout = queue.Rollout();
+    ASSERT_EQ(rollout.size(), 2);
+    EXPECT_EQ(rollout[0].Shape(),
+              std::vector<std::size_t>({rollout_len, batch}));
+    EXPECT_EQ(rollout[1].Shape(),
+              std::vector<std::size_t>({rollout_len, batch, 3}));
+    auto* ptr = static_cast<int*>(rollout[0].Data());
+    auto* obs = static_cast<double*>(rollout[1].Data());
+    for (std::size_t t = 0; t < rollout_len; ++t) {
+      for (std::size_t i = 0; i < batch; ++i) {
+        EXPECT_EQ(ptr[t * batch + i], r * 100 + t * 10 + i);
+        EXPECT_EQ(obs[(t * batch + i) * 3 + 2], t);
+      }
+    }
+    if (r > 0) {
+      // the previous rollout is not overwritten by the next one
+      EXPECT_EQ(static_cast<int*>(last[0].Data())[0], (r - 1) * 100);
+      EXPECT_NE(last[0].Data(), rollout[0].Data());
+    }
+    last = rollout;
+  }
+}
+
+TEST(StateBufferQueueTest, Arena) {
+  std::vector<ShapeSpec> specs{ShapeSpec(4, {-1}), ShapeSpec(8, {3})};
+  std::size_t batch = 8;
+  std::size_t num_envs = 16;
+  StateBufferQueue queue(batch, num_envs, 2, specs, true);
+  // [batch * max_num_players] ints, then [batch, 3] doubles
+  EXPECT_EQ(queue.ArenaSize(), 64 + 192);
+  for (std::size_t i = 0; i < batch; ++i) {
+    auto slice = queue.Allocate(1);
+    slice.arr[0] = static_cast<int>(i);
+    slice.done_write();
+  }
+  auto out = queue.Wait();
+  // one player per env, the player array leaves a gap before the next one
+  EXPECT_EQ(out[0].Shape(0), batch);
+  auto* base = static_cast<char*>(out[0].Data());
+  EXPECT_EQ(static_cast<char*>(out[1].Data()), base + 64);
+  EXPECT_EQ(StateBufferQueue(batch, num_envs, 2, specs).ArenaSize(), 0);
+  EXPECT_EQ(StateBufferQueue(batch, num_envs, 1, specs, true, nullptr, 2)
+                .ArenaSize(),
+            0);
+}
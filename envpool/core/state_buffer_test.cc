@@ -18,6 +18,7 @@
 #include <gtest/gtest.h>
 
 #include <cstdint>
+#include <memory>
 
 #include "envpool/core/spec.h"
 
@@ -114,3 +115,33 @@ TEST(StateBufferTest, MultiPlayers) {
   EXPECT_EQ(bs[0].Shape(0), total);
   EXPECT_EQ(bs[1].Shape(0), batch);
 }
+
+TEST(StateBufferTest, Contiguous) {
+  int batch = 4;
+  std::vector<ShapeSpec> specs{ShapeSpec(1, {batch, 3}),
+                               ShapeSpec(4, {batch, 2, 2}),
+                               ShapeSpec(8, {batch})};
+  auto offsets = ArenaOffsets(specs);
+  EXPECT_EQ(offsets, std::vector<std::size_t>({0, 64, 128, 192}));
+  auto buffer = std::make_unique<StateBuffer>(
+      batch, 1, specs, std::vector<bool>({false, false, false}), true);
+  for (int i = 0; i < batch; ++i) {
+    auto r = buffer->Allocate(1, i);
+    r.arr[2] = static_cast<double>(i);
+    r.done_write();
+  }
+  auto bs = buffer->Wait();
+  auto* base = static_cast<char*>(bs[0].Data());
+  EXPECT_EQ(reinterpret_cast<std::uintptr_t>(base) % 64, 0);
+  for (std::size_t i = 0; i < specs.size(); ++i) {
+    EXPECT_EQ(static_cast<char*>(bs[i].Data()), base + offsets[i]);
+  }
+  for (int i = 0; i < batch; ++i) {
+    EXPECT_EQ(static_cast<double>(bs[2][i]), i);
+  }
+  // the arena outlives the buffer as long as one of the arrays is alive
+  Array tail = bs[2];
+  bs.clear();
+  buffer.reset();
+  EXPECT_EQ(static_cast<double>(tail[batch - 1]), batch - 1);
+}
@@ -0,0 +1,110 @@
+/*
+ * Copyright 2022 Garena Online Private Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ENVPOOL_CORE_STATE_RECORD_H_
+#define ENVPOOL_CORE_STATE_RECORD_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+#include "envpool/core/array.h"
+#include "envpool/core/dict.h"
+#include "envpool/core/tuple_utils.h"
+#include "envpool/core/type_utils.h"
+
+/**
+ * Typed view of one field of a state slice. Unlike `Array`, indexing it
+ * doesn't build a temporary `Array`, `field[i] = x` is a single store into
+ * the batch buffer.
+ */
+template <typename T>
+class StateField {
+ protected:
+  T* data_;
+  // number of elements between two consecutive indices of the first axis
+  std::size_t stride_;
+
+ public:
+  StateField(T* data, std::size_t stride) : data_(data), stride_(stride) {}
+
+  /**
+   * Element `i` of the flattened field.
+   */
+  inline T& operator[](std::size_t i) const { return data_[i]; }
+
+  /**
+   * Element `j` of row `i`, e.g., `(player, dim)` of a player field.
+   */
+  inline T& operator()(std::size_t i, std::size_t j) const {
+    return data_[i * stride_ + j];
+  }
+
+  /**
+   * Assign to a scalar field.
+   */
+  template <typename V>
+  inline void operator=(const V& value) const {  // NOLINT
+    *data_ = value;
+  }
+
+  /**
+   * Copy `size` elements starting at `data` into this field.
+   */
+  void Assign(const T* data, std::size_t size) const {
+    std::copy(data, data + size, data_);
+  }
+
+  [[nodiscard]] inline T* Data() const { return data_; }
+};
+
+/**
+ * Typed record writer of a state slice, built on the state spec dict
+ * `StateSpec`. The field index and dtype of `record["key"_]` are resolved at
+ * compile time, the only runtime part is the row stride which depends on the
+ * config (e.g., the image size).
+ */
+template <typename StateSpec>
+class StateRecord {
+ protected:
+  std::vector<Array>* values_;
+
+ public:
+  using Keys = typename StateSpec::Keys;
+  using Values = typename StateSpec::Values;
+
+  explicit StateRecord(std::vector<Array>* values) : values_(values) {}
+
+  template <typename Key,
+            std::enable_if_t<any_match<Key, Keys>::value, bool> = true>
+  inline auto operator[](const Key& key) const {
+    constexpr std::size_t kIndex = Index<Key, Keys>::VALUE;
+    using Dtype = typename std::tuple_element_t<kIndex, Values>::dtype;
+    const Array& arr = (*values_)[kIndex];
+    std::size_t stride = arr.ndim == 0 || arr.Shape(0) == 0
+                             ? arr.size
+                             : arr.size / arr.Shape(0);
+    return StateField<Dtype>(static_cast<Dtype*>(arr.Data()), stride);
+  }
+
+  operator std::vector<Array>&() const {  // NOLINT
+    return *values_;
+  }
+};
+
+#endif  // ENVPOOL_CORE_STATE_RECORD_H_
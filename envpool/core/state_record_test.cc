@@ -0,0 +1,52 @@
+// Copyright 2022 Garena Online Private Limited
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "envpool/core/state_record.h"
+
+#include <gtest/gtest.h>
+
+#include <type_traits>
+#include <vector>
+
+TEST(StateRecordTest, TypedWrite) {
+  auto spec = MakeDict("obs"_.Bind(Spec<float>({2, 3})),
+                       "reward"_.Bind(Spec<double>({})),
+                       "action_mask"_.Bind(Spec<bool>({3})));
+  std::vector<Array> arrays = MakeArray(spec.AllValues<ShapeSpec>());
+  StateRecord<decltype(spec)> record(&arrays);
+  static_assert(std::is_same_v<decltype(record["obs"_][0]), float&>,
+                "dtype of obs should be resolved at compile time");
+  static_assert(std::is_same_v<decltype(record["reward"_].Data()), double*>,
+                "dtype of reward should be resolved at compile time");
+  for (int i = 0; i < 2; ++i) {
+    for (int j = 0; j < 3; ++j) {
+      record["obs"_](i, j) = static_cast<float>(i * 10 + j);
+    }
+  }
+  record["reward"_] = 1;
+  record["action_mask"_][1] = true;
+  // read back through the untyped Array path
+  for (int i = 0; i < 2; ++i) {
+    for (int j = 0; j < 3; ++j) {
+      EXPECT_EQ(static_cast<float>(arrays[0](i, j)), i * 10 + j);
+    }
+  }
+  EXPECT_EQ(static_cast<double>(arrays[1]), 1.0);
+  EXPECT_FALSE(static_cast<bool>(arrays[2][0]));
+  EXPECT_TRUE(static_cast<bool>(arrays[2][1]));
+  float obs[] = {-1, -2, -3};
+  record["obs"_].Assign(obs, 3);
+  EXPECT_EQ(static_cast<float>(arrays[0](0, 2)), -3);
+  EXPECT_EQ(static_cast<float>(arrays[0](1, 0)), 10);
+}
@@ -0,0 +1,365 @@
+/*
+ * Copyright 2022 Garena Online Private Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ENVPOOL_CORE_TRAJECTORY_WRITER_H_
+#define ENVPOOL_CORE_TRAJECTORY_WRITER_H_
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+#include "envpool/core/dict.h"
+#include "envpool/core/float_cast.h"
+
+/**
+ * One field of a trajectory record, with its numpy dtype name, shape and
+ * byte offset in the record. `source` is the index of the action / state
+ * key it is copied from.
+ */
+struct TrajectoryField {
+  std::string name, dtype;
+  std::vector<int> shape;
+  std::size_t offset, size, source;
+};
+
+/**
+ * Record layout of the trajectory files of a pool, see TrajectoryWriter.
+ *
+ * Each record is one step of one env: the head fields env_id, episode,
+ * elapsed_step (int32), reward (float32) and done (bool), then the action
+ * that led to this step (zeros on the first step of an episode), then the
+ * kept obs keys as returned by recv, i.e., after `norm_obs` and `obs_dtype`
+ * if they are set. Container keys are skipped. The layout
+ * is only defined for single-player envs, whose player axis is dropped.
+ */
+class TrajectoryLayout {
+ public:
+  static constexpr std::size_t kEnvIdOffset = 0;
+  static constexpr std::size_t kEpisodeOffset = 4;
+  static constexpr std::size_t kElapsedStepOffset = 8;
+  static constexpr std::size_t kRewardOffset = 12;
+  static constexpr std::size_t kDoneOffset = 16;
+  static constexpr int kVersion = 1;
+
+  std::vector<TrajectoryField> head, action, obs;
+  std::size_t record_size;
+
+  template <typename EnvSpec>
+  explicit TrajectoryLayout(const EnvSpec& spec)
+      : head({{"env_id", "int32", {}, kEnvIdOffset, 4, 0},
+              {"episode", "int32", {}, kEpisodeOffset, 4, 0},
+              {"elapsed_step", "int32", {}, kElapsedStepOffset, 4, 0},
+              {"reward", "float32", {}, kRewardOffset, 4, 0},
+              {"done", "bool", {}, kDoneOffset, 1, 0}}),
+        record_size(kDoneOffset + 1) {
+    // skip env_id and players.env_id
+    auto action_keys = EnvSpec::ActionSpec::AllKeys();
+    std::size_t index = 0;
+    std::apply(
+        [&](auto&&... s) {
+          (
+              [&] {
+                using T = typename std::decay_t<decltype(s)>::dtype;
+                if (index >= 2) {
+                  Add(&action, "action:" + action_keys[index], DtypeName<T>(),
+                      s, index);
+                }
+                ++index;
+              }(),
+              ...);
+        },
+        spec.action_spec.AllValues());
+    auto state_keys = EnvSpec::StateSpec::AllKeys();
+    auto mask = spec.StateMask();
+    auto cast = spec.StateCast();
+    std::string cast_name = spec.config["obs_dtype"_];
+    index = 0;
+    std::apply(
+        [&](auto&&... s) {
+          (
+              [&] {
+                using T = typename std::decay_t<decltype(s)>::dtype;
+                if (std::is_arithmetic_v<T> && mask[index] &&
+                    EnvSpec::MatchStateKey(state_keys[index], "obs")) {
+                  bool is_cast = cast[index] != FloatDtype::kFloat64;
+                  Add(&obs, state_keys[index],
+                      is_cast ? cast_name : DtypeName<T>(), s, index,
+                      is_cast ? FloatDtypeSize(cast[index]) : sizeof(T));
+                }
+                ++index;
+              }(),
+              ...);
+        },
+        spec.state_spec.AllValues());
+    record_size = Align(record_size, 8);
+  }
+
+  /**
+   * The layout as JSON, written to `meta.json` next to the shards.
+   */
+  [[nodiscard]] std::string Json() const {
+    std::ostringstream os;
+    os << "{\n  \"version\": " << kVersion
+       << ",\n  \"record_size\": " << record_size << ",\n  \"fields\": [";
+    bool first = true;
+    for (const auto* fields : {&head, &action, &obs}) {
+      for (const auto& f : *fields) {
+        os << (first ? "\n" : ",\n") << "    {\"name\": \"" << f.name
+           << "\", \"dtype\": \"" << f.dtype << "\", \"shape\": [";
+        for (std::size_t d = 0; d < f.shape.size(); ++d) {
+          os << (d > 0 ? ", " : "") << f.shape[d];
+        }
+        os << "], \"offset\": " << f.offset << "}";
+        first = false;
+      }
+    }
+    os << "\n  ]\n}\n";
+    return os.str();
+  }
+
+ protected:
+  template <typename T>
+  static std::string DtypeName() {
+    if constexpr (std::is_same_v<T, bool>) {
+      return "bool";
+    } else if constexpr (std::is_floating_point_v<T>) {
+      return "float" + std::to_string(sizeof(T) * 8);
+    } else if constexpr (std::is_integral_v<T>) {
+      return std::string(std::is_signed_v<T> ? "int" : "uint") +
+             std::to_string(sizeof(T) * 8);
+    } else {
+      return "";
+    }
+  }
+
+  static std::size_t Align(std::size_t offset, std::size_t alignment) {
+    return (offset + alignment - 1) / alignment * alignment;
+  }
+
+  void Add(std::vector<TrajectoryField>* fields, const std::string& name,
+           const std::string& dtype, const ShapeSpec& spec, std::size_t index,
+           std::size_t element_size = 0) {
+    if (element_size == 0) {
+      element_size = spec.element_size;
+    }
+    std::vector<int> shape = spec.shape;
+    if (!shape.empty() && shape[0] == -1) {
+      // single player
+      shape.erase(shape.begin());
+    }
+    std::size_t size = element_size;
+    for (int d : shape) {
+      size *= d;
+    }
+    std::size_t offset = Align(record_size, element_size);
+    fields->push_back(TrajectoryField{name, dtype, shape, offset, size, index});
+    record_size = offset + size;
+  }
+};
+
+/**
+ * Appends the records of one worker thread to its own memory-mapped shard
+ * files, so that the workers never contend. The files of worker w are
+ * `<dir>/w<w>-<seq>.traj` and `.index`, seq counting from 0; a shard is
+ * closed and the next one started when it holds `shard_bytes`.
+ *
+ * A `.traj` file is a 64-byte header (uint64: magic "ENVPTRAJ", version,
+ * header size, record size, number of records) followed by the records, see
+ * TrajectoryLayout. The `.index` file lists the episodes that end in the
+ * shard, as Episode entries.
+ */
+class TrajectoryWriter {
+ public:
+  static constexpr uint64_t kMagic = 0x4a41525450564e45;  // "ENVPTRAJ"
+  static constexpr std::size_t kHeaderSize = 64;
+
+  struct Episode {
+    int32_t env_id, episode, length;
+    float ret;
+    // index of the last record of the episode in the shard
+    uint64_t last_record;
+  };
+
+ protected:
+  const TrajectoryLayout* layout_;
+  std::string prefix_;
+  std::size_t capacity_;
+  int seq_;
+  char* data_;
+  std::size_t num_record_;
+  std::vector<Episode> episodes_;
+
+ public:
+  TrajectoryWriter(const TrajectoryLayout* layout, const std::string& dir,
+                   int worker, std::size_t shard_bytes)
+      : layout_(layout),
+        prefix_(dir + "/w" + std::to_string(worker) + "-"),
+        capacity_(std::max<std::size_t>(
+            1, (shard_bytes - kHeaderSize) / layout->record_size)),
+        seq_(-1),
+        data_(nullptr),
+        num_record_(0) {}
+
+  TrajectoryWriter(const TrajectoryWriter&) = delete;
+  TrajectoryWriter& operator=(const TrajectoryWriter&) = delete;
+
+  ~TrajectoryWriter() { Close(); }
+
+  /**
+   * Create `dir` if needed and write the layout of the records into it. A
+   * dir that already holds shards is rejected: the new shards would only
+   * overwrite the first ones of an earlier run and leave the others mixed
+   * in.
+   */
+  static void WriteMeta(const TrajectoryLayout& layout,
+                        const std::string& dir) {
+    if (mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST) {
+      throw std::runtime_error("Cannot create trajectory dir " + dir);
+    }
+    if (HasShards(dir)) {
+      throw std::invalid_argument(
+          "Trajectory dir " + dir +
+          " already holds the shards of an earlier run, remove them or use "
+          "another dir.");
+    }
+    std::ofstream meta(dir + "/meta.json");
+    meta << layout.Json();
+    if (!meta) {
+      throw std::runtime_error("Cannot write " + dir + "/meta.json");
+    }
+  }
+
+  [[nodiscard]] const TrajectoryLayout& Layout() const { return *layout_; }
+
+  /**
+   * Whether `dir` holds any `.traj` or `.index` file.
+   */
+  static bool HasShards(const std::string& dir) {
+    DIR* d = opendir(dir.c_str());
+    if (d == nullptr) {
+      throw std::runtime_error("Cannot open trajectory dir " + dir);
+    }
+    bool found = false;
+    while (dirent* entry = readdir(d)) {
+      std::string name = entry->d_name;
+      for (std::string_view ext : {".traj", ".index"}) {
+        if (name.size() > ext.size() &&
+            name.compare(name.size() - ext.size(), ext.size(), ext) == 0) {
+          found = true;
+        }
+      }
+    }
+    closedir(d);
+    return found;
+  }
+
+  /**
+   * The next record of the shard, to be filled by the caller. The first
+   * call opens the shard lazily, so that an idle worker leaves no file.
+   */
+  char* Append() {
+    if (data_ == nullptr || num_record_ == capacity_) {
+      Close();
+      Open();
+    }
+    char* record = data_ + kHeaderSize + num_record_ * layout_->record_size;
+    ++num_record_;
+    reinterpret_cast<uint64_t*>(data_)[4] = num_record_;
+    return record;
+  }
+
+  /**
+   * Index the last appended record as the end of an episode.
+   */
+  void EndEpisode(int env_id, int episode, int length, float ret) {
+    episodes_.push_back(
+        Episode{env_id, episode, length, ret, num_record_ - 1});
+  }
+
+ protected:
+  [[nodiscard]] std::string Path(const char* ext) const {
+    char seq[16];
+    std::snprintf(seq, sizeof(seq), "%05d", seq_);
+    return prefix_ + seq + ext;
+  }
+
+  void Open() {
+    ++seq_;
+    std::string path = Path(".traj");
+    std::size_t size = kHeaderSize + capacity_ * layout_->record_size;
+    int fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0 || ftruncate(fd, static_cast<off_t>(size)) != 0) {
+      if (fd >= 0) {
+        close(fd);
+      }
+      throw std::runtime_error("Cannot create trajectory shard " + path);
+    }
+    void* ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (ptr == MAP_FAILED) {
+      throw std::runtime_error("Cannot map trajectory shard " + path);
+    }
+    data_ = static_cast<char*>(ptr);
+    num_record_ = 0;
+    auto* head = reinterpret_cast<uint64_t*>(data_);
+    head[0] = kMagic;
+    head[1] = TrajectoryLayout::kVersion;
+    head[2] = kHeaderSize;
+    head[3] = layout_->record_size;
+    head[4] = 0;
+  }
+
+  /**
+   * Unmap the shard, cut it to the records written and write its index.
+   */
+  void Close() {
+    if (data_ == nullptr) {
+      return;
+    }
+    std::size_t used = kHeaderSize + num_record_ * layout_->record_size;
+    munmap(data_, kHeaderSize + capacity_ * layout_->record_size);
+    data_ = nullptr;
+    std::string path = Path(".traj");
+    if (truncate(path.c_str(), static_cast<off_t>(used)) != 0) {
+      // also called by the destructor, so only warn
+      LOG(WARNING) << "Cannot resize trajectory shard " << path;
+    }
+    std::ofstream index(Path(".index"), std::ios::binary);
+    index.write(reinterpret_cast<const char*>(episodes_.data()),
+                static_cast<std::streamsize>(episodes_.size() *
+                                             sizeof(Episode)));
+    episodes_.clear();
+  }
+};
+
+#endif  // ENVPOOL_CORE_TRAJECTORY_WRITER_H_
@@ -0,0 +1,135 @@
+// Copyright 2022 Garena Online Private Limited
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "envpool/core/trajectory_writer.h"
+
+#include <gtest/gtest.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "envpool/core/env_spec.h"
+
+class TrajEnvFns {
+ public:
+  static decltype(auto) DefaultConfig() { return MakeDict(); }
+  template <typename Config>
+  static decltype(auto) StateSpec(const Config& conf) {
+    return MakeDict("obs:pos"_.Bind(Spec<double>({2})),
+                    "obs:id"_.Bind(Spec<uint8_t>({-1})),
+                    "info:vel"_.Bind(Spec<float>({2})));
+  }
+  template <typename Config>
+  static decltype(auto) ActionSpec(const Config& conf) {
+    return MakeDict("action"_.Bind(Spec<int>({-1, 3})));
+  }
+};
+
+using TrajEnvSpec = EnvSpec<TrajEnvFns>;
+
+static std::string ReadFile(const std::string& path) {
+  std::ifstream in(path, std::ios::binary);
+  return {std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+}
+
+TEST(TrajectoryWriterTest, Layout) {
+  auto config = TrajEnvSpec::DEFAULT_CONFIG;
+  config["obs_dtype"_] = "float32";
+  TrajectoryLayout layout{TrajEnvSpec(config)};
+  ASSERT_EQ(layout.action.size(), 1);
+  EXPECT_EQ(layout.action[0].name, "action:action");
+  EXPECT_EQ(layout.action[0].shape, std::vector<int>({3}));
+  // aligned after done
+  EXPECT_EQ(layout.action[0].offset, 20);
+  ASSERT_EQ(layout.obs.size(), 2);
+  EXPECT_EQ(layout.obs[0].dtype, "float32");
+  EXPECT_EQ(layout.obs[0].offset, 32);
+  EXPECT_EQ(layout.obs[0].size, 8);
+  EXPECT_EQ(layout.obs[1].dtype, "uint8");
+  EXPECT_EQ(layout.obs[1].shape, std::vector<int>());
+  EXPECT_EQ(layout.obs[1].offset, 40);
+  EXPECT_EQ(layout.record_size, 48);
+  std::string json = layout.Json();
+  EXPECT_NE(json.find("{\"name\": \"obs:id\", \"dtype\": \"uint8\", "
+                      "\"shape\": [], \"offset\": 40}"),
+            std::string::npos);
+}
+
+TEST(TrajectoryWriterTest, Shards) {
+  TrajectoryLayout layout{TrajEnvSpec()};
+  std::size_t record_size = layout.record_size;
+  char dir[] = "/tmp/envpool_traj_XXXXXX";
+  ASSERT_NE(mkdtemp(dir), nullptr);
+  TrajectoryWriter::WriteMeta(layout, dir);
+  {
+    // 3 records per shard
+    TrajectoryWriter writer(&layout, dir, 2,
+                            TrajectoryWriter::kHeaderSize + 3 * record_size);
+    for (int i = 0; i < 7; ++i) {
+      char* record = writer.Append();
+      std::memcpy(record, &i, sizeof(i));
+      if (i == 1 || i == 5) {
+        writer.EndEpisode(i, 0, i + 1, 1.5F);
+      }
+    }
+  }
+  // a dir with the shards of an earlier run is rejected
+  EXPECT_THROW(TrajectoryWriter::WriteMeta(layout, dir), std::invalid_argument);
+  std::string prefix = std::string(dir) + "/w2-";
+  std::vector<std::size_t> num_record = {3, 3, 1};
+  int value = 0;
+  for (std::size_t k = 0; k < num_record.size(); ++k) {
+    std::string name = prefix + "0000" + std::to_string(k);
+    std::string data = ReadFile(name + ".traj");
+    ASSERT_EQ(data.size(),
+              TrajectoryWriter::kHeaderSize + num_record[k] * record_size);
+    const auto* head = reinterpret_cast<const uint64_t*>(data.data());
+    EXPECT_EQ(head[0], TrajectoryWriter::kMagic);
+    EXPECT_EQ(head[3], record_size);
+    EXPECT_EQ(head[4], num_record[k]);
+    for (std::size_t r = 0; r < num_record[k]; ++r) {
+      int env_id;
+      std::memcpy(&env_id,
+                  data.data() + TrajectoryWriter::kHeaderSize + r * record_size,
+                  sizeof(env_id));
+      EXPECT_EQ(env_id, value++);
+    }
+    std::string index = ReadFile(name + ".index");
+    // episode 1 ends in shard 0 at record 1, episode 5 in shard 1 at record 2
+    if (k == 2) {
+      EXPECT_TRUE(index.empty());
+    } else {
+      ASSERT_EQ(index.size(), sizeof(TrajectoryWriter::Episode));
+      TrajectoryWriter::Episode e;
+      std::memcpy(&e, index.data(), sizeof(e));
+      EXPECT_EQ(e.env_id, k == 0 ? 1 : 5);
+      EXPECT_EQ(e.last_record, k == 0 ? 1 : 2);
+      EXPECT_EQ(e.ret, 1.5F);
+    }
+    std::remove((name + ".traj").c_str());
+    std::remove((name + ".index").c_str());
+  }
+  EXPECT_FALSE(ReadFile(std::string(dir) + "/meta.json").empty());
+  // reusable once the shards are gone
+  TrajectoryWriter::WriteMeta(layout, dir);
+  std::remove((std::string(dir) + "/meta.json").c_str());
+  rmdir(dir);
+}
@@ -0,0 +1,125 @@
+/*
+ * Copyright 2022 Garena Online Private Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ENVPOOL_CORE_WORKLOAD_H_
+#define ENVPOOL_CORE_WORKLOAD_H_
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+#include "envpool/core/array.h"
+#include "envpool/core/dict.h"
+#include "envpool/core/spec.h"
+
+/**
+ * Fixed, seeded workloads that drive an env pool with random actions. They
+ * are the training runs of the PGO build (see docs/pages/build.rst) and
+ * double as throughput benchmarks of the C++ side without Python.
+ */
+
+/**
+ * Uniformly random array of `num` actions of `spec` within its bounds. A
+ * leading -1 (per-player) dimension becomes `num`, otherwise `num` is
+ * prepended, the same as the action batch of a single-player pool.
+ */
+template <typename D, typename RandomEngine>
+Array RandomAction(const Spec<D>& spec, int num, RandomEngine* gen) {
+  std::vector<int> shape = spec.shape;
+  if (!shape.empty() && shape[0] == -1) {
+    shape[0] = num;
+  } else {
+    shape.insert(shape.begin(), num);
+  }
+  Array arr(Spec<D>(std::move(shape)));
+  auto* data = static_cast<D*>(arr.Data());
+  const auto& [low, high] = spec.elementwise_bounds;
+  std::size_t per_action = arr.size / num;
+  for (std::size_t i = 0; i < arr.size; ++i) {
+    D lo = low.empty() ? std::get<0>(spec.bounds) : low[i % per_action];
+    D hi = high.empty() ? std::get<1>(spec.bounds) : high[i % per_action];
+    if constexpr (std::is_floating_point_v<D>) {
+      data[i] = std::uniform_real_distribution<D>(lo, hi)(*gen);
+    } else if constexpr (std::is_integral_v<D> && !std::is_same_v<D, bool>) {
+      data[i] = static_cast<D>(
+          std::uniform_int_distribution<int64_t>(lo, hi)(*gen));
+    }
+  }
+  return arr;
+}
+
+/**
+ * Default config of `EnvPool` with `num_envs` envs and as many threads.
+ */
+template <typename EnvPool>
+typename EnvPool::Spec::Config WorkloadConfig(int num_envs) {
+  auto config = EnvPool::Spec::DEFAULT_CONFIG;
+  config["num_envs"_] = num_envs;
+  config["num_threads"_] = num_envs;
+  return config;
+}
+
+/**
+ * Build a single-player pool with `config`, step all its envs `num_steps`
+ * times in sync mode with seeded random actions, and print the throughput.
+ * Returns the number of env steps per second.
+ */
+template <typename EnvPool>
+double RunWorkload(const std::string& name,
+                   const typename EnvPool::Spec::Config& config, int num_steps,
+                   uint32_t seed = 0) {
+  typename EnvPool::Spec spec(config);
+  int num_envs = spec.config["num_envs"_];
+  EnvPool pool(spec);
+  std::mt19937 gen(seed);
+  Array env_ids(Spec<int>({num_envs}));
+  for (int i = 0; i < num_envs; ++i) {
+    env_ids[i] = i;
+  }
+  pool.Reset(env_ids);
+  auto state = pool.Recv();
+  auto start = std::chrono::steady_clock::now();
+  for (int t = 0; t < num_steps; ++t) {
+    // "info:env_id" is the first state, "env_id" and "players.env_id" are
+    // the first two actions
+    const Array& ids = state[0];
+    int num = static_cast<int>(ids.Shape(0));
+    std::vector<Array> action;
+    std::size_t index = 0;
+    std::apply(
+        [&](const auto&... s) {
+          ((index++ < 2 ? action.emplace_back(ids)
+                        : action.emplace_back(RandomAction(s, num, &gen))),
+           ...);
+        },
+        spec.action_spec.AllValues());
+    pool.Send(action);
+    state = pool.Recv();
+  }
+  std::chrono::duration<double> dur =
+      std::chrono::steady_clock::now() - start;
+  double fps = num_steps * num_envs / dur.count();
+  std::printf("%s: %d envs x %d steps, %.0f steps/s\n", name.c_str(),
+              num_envs, num_steps, fps);
+  return fps;
+}
+
+#endif  // ENVPOOL_CORE_WORKLOAD_H_
@@ -16,6 +16,7 @@
 #define ENVPOOL_DUMMY_DUMMY_ENVPOOL_H_
 
 #include <memory>
+#include <string>
 
 #include "envpool/core/async_envpool.h"
 #include "envpool/core/env.h"
@@ -128,6 +129,17 @@ class DummyEnv : public Env<DummyEnvSpec> {
     }
   }
 
+  /**
+   * The seed is also the episode length, so it is clamped the same way as in
+   * the constructor.
+   */
+  void Reseed(int seed) override {
+    Env<DummyEnvSpec>::Reseed(seed);
+    if (seed_ < 1) {
+      seed_ = 1;
+    }
+  }
+
   /**
    * Reset this single env, this has the same meaning as the openai gym's reset
    * The reset function usually returns the state after reset, here, we first
@@ -153,7 +165,7 @@ class DummyEnv : public Env<DummyEnvSpec> {
       // dynamic array
       Container<int>& dyn = state["obs:dyn"_][i];
       // new spec
-      auto dyn_spec = ::Spec<int>({env_id_ + 1, spec_.config["state_num"_]});
+      auto dyn_spec = ::Spec<int>({env_id_ + 1, spec_->config["state_num"_]});
       // use this spec to create an array
       auto* array = new TArray<int>(dyn_spec);
       // perform some normal array writing
@@ -195,7 +207,7 @@ class DummyEnv : public Env<DummyEnvSpec> {
       state["obs:raw"_](i, 1) = action_num;
       state["reward"_][i] = -i;
       Container<int>& dyn = state["obs:dyn"_][i];
-      auto dyn_spec = ::Spec<int>({env_id_ + 1, spec_.config["state_num"_]});
+      auto dyn_spec = ::Spec<int>({env_id_ + 1, spec_->config["state_num"_]});
       dyn = std::make_unique<TArray<int>>(dyn_spec);
       dyn->Fill(env_id_);
     }
@@ -205,6 +217,29 @@ class DummyEnv : public Env<DummyEnvSpec> {
    * Whether the single env has ended the current episode.
    */
   bool IsDone() override { return state_ >= seed_; }
+
+  /**
+   * The config keys that can be changed by `AsyncEnvPool::Reconfigure`
+   * without rebuilding this env. Since they are applied right before a reset,
+   * they must not affect the state / action spec.
+   */
+  static bool IsHotConfig(const std::string& key) {
+    return key == "action_num";
+  }
+
+  /**
+   * Serialize the state of this env for `AsyncEnvPool::Save`, `SaveEnv`
+   * takes care of the fields in the base class (e.g., the RNG).
+   */
+  void Save(SnapshotWriter* writer) override {
+    SaveEnv(writer);
+    writer->Write(state_);
+  }
+
+  void Load(SnapshotReader* reader) override {
+    LoadEnv(reader);
+    reader->Read(&state_);
+  }
 };
 
 /**
@@ -16,8 +16,17 @@
 
 #include <glog/logging.h>
 #include <gtest/gtest.h>
+#include <unistd.h>
 
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
 #include <random>
+#include <string>
+#include <thread>
 #include <vector>
 
 using DummyAction = typename dummy::DummyEnv::Action;
@@ -229,3 +238,865 @@ TEST(DummyEnvPoolTest, MultiPlayers) {
   Runner(9, 4, 30, 100000, 9, 6);
   Runner(10, 10, 25, 100000, 0, 9);
 }
+
+TEST(DummyEnvPoolTest, LazyInit) {
+  auto config = dummy::DummyEnvSpec::DEFAULT_CONFIG;
+  int num_envs = 4;
+  config["num_envs"_] = num_envs;
+  config["batch_size"_] = num_envs;
+  config["num_threads"_] = 2;
+  config["lazy_init"_] = true;
+  dummy::DummyEnvSpec spec(config);
+  dummy::DummyEnvPool envpool(spec);
+  for (double t : envpool.EnvInitTime()) {
+    EXPECT_EQ(t, 0.0);
+  }
+  // env 3 is never reset, so it cannot receive any action
+  std::vector<Array> raw_action({Array(Spec<int>({1})), Array(Spec<int>({1})),
+                                 Array(Spec<int>({1})), Array(Spec<int>({1}))});
+  DummyAction action(&raw_action);
+  action["env_id"_][0] = 3;
+  action["players.env_id"_][0] = 3;
+  EXPECT_THROW(envpool.Send(action), std::runtime_error);
+  Array all_env_ids(Spec<int>({num_envs}));
+  for (int i = 0; i < num_envs; ++i) {
+    all_env_ids[i] = i;
+  }
+  envpool.Reset(all_env_ids);
+  auto state_vec = envpool.Recv();
+  DummyState state(&state_vec);
+  for (int i = 0; i < num_envs; ++i) {
+    EXPECT_EQ(static_cast<int>(state["info:env_id"_][i]), i);
+    EXPECT_EQ(static_cast<int>(state["elapsed_step"_][i]), 0);
+  }
+  for (double t : envpool.EnvInitTime()) {
+    EXPECT_GE(t, 0.0);
+  }
+  envpool.Send(action);
+}
+
+// records the hot config `action_num` that each env resets with
+class ConfigEnv : public dummy::DummyEnv {
+ public:
+  static inline std::atomic<int> action_num[4];
+  using dummy::DummyEnv::DummyEnv;
+
+  void Reset() override {
+    action_num[env_id_] = spec_->config["action_num"_];
+    dummy::DummyEnv::Reset();
+  }
+};
+
+TEST(DummyEnvPoolTest, Reconfigure) {
+  auto config = dummy::DummyEnvSpec::DEFAULT_CONFIG;
+  int num_envs = 4;
+  config["num_envs"_] = num_envs;
+  config["batch_size"_] = num_envs;
+  config["num_threads"_] = 2;
+  dummy::DummyEnvSpec spec(config);
+  AsyncEnvPool<ConfigEnv> envpool(spec);
+  Array all_env_ids(Spec<int>({num_envs}));
+  for (int i = 0; i < num_envs; ++i) {
+    all_env_ids[i] = i;
+  }
+  envpool.Reset(all_env_ids);
+  auto state_vec = envpool.Recv();
+  DummyState state(&state_vec);
+  for (int i = 0; i < num_envs; ++i) {
+    EXPECT_EQ(ConfigEnv::action_num[i], 6);
+  }
+  // keys that change the spec or the pool layout are rejected
+  auto bad_config = config;
+  bad_config["state_num"_] = 20;
+  EXPECT_THROW(envpool.Reconfigure(dummy::DummyEnvSpec(bad_config)),
+               std::invalid_argument);
+  bad_config = config;
+  bad_config["num_threads"_] = 1;
+  EXPECT_THROW(envpool.Reconfigure(dummy::DummyEnvSpec(bad_config)),
+               std::invalid_argument);
+  // whitelisted keys are applied at the next reset
+  auto new_config = config;
+  new_config["action_num"_] = 10;
+  envpool.Reconfigure(dummy::DummyEnvSpec(new_config));
+  envpool.Reset(all_env_ids);
+  state_vec = envpool.Recv();
+  state = DummyState(&state_vec);
+  for (int i = 0; i < num_envs; ++i) {
+    EXPECT_EQ(static_cast<int>(state["info:env_id"_][i]), i);
+    EXPECT_EQ(static_cast<int>(state["elapsed_step"_][i]), 0);
+    EXPECT_EQ(ConfigEnv::action_num[i], 10);
+  }
+}
+
+TEST(DummyEnvPoolTest, AddRemoveEnvs) {
+  auto config = dummy::DummyEnvSpec::DEFAULT_CONFIG;
+  config["num_envs"_] = 3;
+  config["max_num_envs"_] = 5;
+  config["num_threads"_] = 2;
+  dummy::DummyEnvSpec spec(config);
+  dummy::DummyEnvPool envpool(spec);
+  auto reset = [&](const std::vector<int>& env_ids) {
+    Array arr(Spec<int>({static_cast<int>(env_ids.size())}));
+    for (std::size_t i = 0; i < env_ids.size(); ++i) {
+      arr[i] = env_ids[i];
+    }
+    envpool.Reset(arr);
+    auto state_vec = envpool.Recv();
+    DummyState state(&state_vec);
+    EXPECT_EQ(state["info:env_id"_].Shape(0), env_ids.size());
+    for (std::size_t i = 0; i < env_ids.size(); ++i) {
+      EXPECT_EQ(static_cast<int>(state["info:env_id"_][i]), env_ids[i]);
+    }
+  };
+  reset({0, 1, 2});
+  envpool.RemoveEnvs({1});
+  EXPECT_EQ(envpool.EnvIds(), std::vector<int>({0, 2}));
+  EXPECT_THROW(envpool.RemoveEnvs({1}), std::invalid_argument);
+  reset({0, 2});
+  // the freed id is reused first
+  EXPECT_EQ(envpool.AddEnvs(2), std::vector<int>({1, 3}));
+  EXPECT_EQ(envpool.EnvIds(), std::vector<int>({0, 1, 2, 3}));
+  EXPECT_THROW(envpool.AddEnvs(2), std::invalid_argument);
+  reset({0, 1, 2, 3});
+}
+
+TEST(DummyEnvPoolTest, MultiTask) {
+  auto config = dummy::DummyEnvSpec::DEFAULT_CONFIG;
+  int num_envs = 6;
+  config["num_envs"_] = num_envs;
+  config["num_threads"_] = 2;
+  auto config1 = config;
+  config1["action_num"_] = 3;
+  std::vector<dummy::DummyEnvSpec> specs(
+      {dummy::DummyEnvSpec(config), dummy::DummyEnvSpec(config1),
+       dummy::DummyEnvSpec(config)});
+  dummy::DummyEnvPool envpool(specs);
+  Array all_env_ids(Spec<int>({num_envs}));
+  for (int i = 0; i < num_envs; ++i) {
+    all_env_ids[i] = i;
+  }
+  envpool.Reset(all_env_ids);
+  auto state_vec = envpool.Recv();
+  DummyState state(&state_vec);
+  for (int i = 0; i < num_envs; ++i) {
+    EXPECT_EQ(static_cast<int>(state["info:env_id"_][i]), i);
+    EXPECT_EQ(static_cast<int>(state["info:task_id"_][i]), i % 3);
+  }
+  // one spec for each task is required
+  EXPECT_THROW(envpool.Reconfigure(specs[0]), std::invalid_argument);
+  // pool-level config and state / action shapes must be the same
+  auto bad_config = config;
+  bad_config["state_num"_] = 20;
+  EXPECT_THROW(dummy::DummyEnvPool(std::vector<dummy::DummyEnvSpec>(
+                   {specs[0], dummy::DummyEnvSpec(bad_config)})),
+               std::invalid_argument);
+  bad_config = config;
+  bad_config["num_threads"_] = 1;
+  EXPECT_THROW(dummy::DummyEnvPool(std::vector<dummy::DummyEnvSpec>(
+                   {specs[0], dummy::DummyEnvSpec(bad_config)})),
+               std::invalid_argument);
+}
+
+TEST(DummyEnvPoolTest, SaveLoad) {
+  auto config = dummy::DummyEnvSpec::DEFAULT_CONFIG;
+  int num_envs = 4;
+  config["num_envs"_] = num_envs;
+  config["num_threads"_] = 2;
+  config["seed"_] = 10;
+  dummy::DummyEnvSpec spec(config);
+  dummy::DummyEnvPool envpool(spec);
+  Array all_env_ids(Spec<int>({num_envs}));
+  for (int i = 0; i < num_envs; ++i) {
+    all_env_ids[i] = i;
+  }
+  std::vector<Array> raw_action(
+      {Array(Spec<int>({num_envs})), Array(Spec<int>({num_envs})),
+       Array(Spec<int>({num_envs})), Array(Spec<int>({num_envs}))});
+  DummyAction action(&raw_action);
+  for (int i = 0; i < num_envs; ++i) {
+    action["env_id"_][i] = i;
+    action["players.env_id"_][i] = i;
+  }
+  auto step = [&] {
+    envpool.Send(action);
+    auto state_vec = envpool.Recv();
+    DummyState state(&state_vec);
+    std::vector<int> obs;
+    for (int i = 0; i < num_envs; ++i) {
+      obs.push_back(state["obs:raw"_](i, 0));
+      obs.push_back(state["elapsed_step"_][i]);
+    }
+    return obs;
+  };
+  envpool.Reset(all_env_ids);
+  envpool.Recv();
+  step();
+  step();
+  std::string path = testing::TempDir() + "dummy_snapshot.bin";
+  envpool.Save(path);
+  auto obs0 = step();
+  auto obs1 = step();
+  // a fresh pool continues from the snapshot
+  dummy::DummyEnvPool envpool2(spec);
+  envpool2.Load(path);
+  envpool2.Send(action);
+  auto state_vec = envpool2.Recv();
+  DummyState state(&state_vec);
+  for (int i = 0; i < num_envs; ++i) {
+    EXPECT_EQ(static_cast<int>(state["obs:raw"_](i, 0)), obs0[2 * i]);
+    EXPECT_EQ(static_cast<int>(state["elapsed_step"_][i]), obs0[2 * i + 1]);
+  }
+  // and so does the original one
+  envpool.Load(path);
+  EXPECT_EQ(step(), obs0);
+  EXPECT_EQ(step(), obs1);
+  std::remove(path.c_str());
+}
+
+TEST(DummyEnvPoolTest, Reseed) {
+  auto config = dummy::DummyEnvSpec::DEFAULT_CONFIG;
+  int num_envs = 2;
+  config["num_envs"_] = num_envs;
+  config["num_threads"_] = 2;
+  config["seed"_] = 10;
+  dummy::DummyEnvSpec spec(config);
+  dummy::DummyEnvPool envpool(spec);
+  Array all_env_ids(Spec<int>({num_envs}));
+  for (int i = 0; i < num_envs; ++i) {
+    all_env_ids[i] = i;
+  }
+  std::vector<Array> raw_action(
+      {Array(Spec<int>({num_envs})), Array(Spec<int>({num_envs})),
+       Array(Spec<int>({num_envs})), Array(Spec<int>({num_envs}))});
+  DummyAction action(&raw_action);
+  for (int i = 0; i < num_envs; ++i) {
+    action["env_id"_][i] = i;
+    action["players.env_id"_][i] = i;
+  }
+  EXPECT_THROW(envpool.Reseed({0, 1}, {2}), std::invalid_argument);
+  EXPECT_THROW(envpool.Reseed({2}, {2}), std::invalid_argument);
+  envpool.Reset(all_env_ids);
+  envpool.Recv();
+  // the dummy env ends its episode after `seed` steps, the new seeds are
+  // picked up by the next reset
+  envpool.Reseed({0, 1}, {2, 3});
+  envpool.Send(action);
+  auto state_vec = envpool.Recv();
+  EXPECT_FALSE(static_cast<bool>(DummyState(&state_vec)["done"_][0]));
+  envpool.Reset(all_env_ids);
+  envpool.Recv();
+  for (int t = 1; t <= 3; ++t) {
+    envpool.Send(action);
+    state_vec = envpool.Recv();
+    DummyState state(&state_vec);
+    EXPECT_EQ(static_cast<bool>(state["done"_][0]), t == 2);
+    EXPECT_EQ(static_cast<bool>(state["done"_][1]), t == 3);
+  }
+}
+
+TEST(DummyEnvPoolTest, Branch) {
+  auto config = dummy::DummyEnvSpec::DEFAULT_CONFIG;
+  int num_envs = 2;
+  int num_children = 3;
+  config["num_envs"_] = num_envs;
+  config["num_threads"_] = 2;
+  config["seed"_] = 10;
+  dummy::DummyEnvSpec spec(config);
+  dummy::DummyEnvPool envpool(spec);
+  Array all_env_ids(Spec<int>({num_envs}));
+  for (int i = 0; i < num_envs; ++i) {
+    all_env_ids[i] = i;
+  }
+  std::vector<Array> raw_action(
+      {Array(Spec<int>({num_envs})), Array(Spec<int>({num_envs})),
+       Array(Spec<int>({num_envs})), Array(Spec<int>({num_envs}))});
+  DummyAction action(&raw_action);
+  for (int i = 0; i < num_envs; ++i) {
+    action["env_id"_][i] = i;
+    action["players.env_id"_][i] = i;
+  }
+  std::vector<Array> raw_branch(
+      {Array(Spec<int>({num_children})), Array(Spec<int>({num_children})),
+       Array(Spec<int>({num_children})), Array(Spec<int>({num_children}))});
+  DummyAction branch(&raw_branch);
+  for (int k = 0; k < num_children; ++k) {
+    branch["env_id"_][k] = 1;
+    branch["players.env_id"_][k] = 1;
+  }
+  EXPECT_THROW(envpool.Branch(num_envs, raw_branch), std::invalid_argument);
+  envpool.Reset(all_env_ids);
+  envpool.Recv();
+  envpool.Send(action);
+  envpool.Recv();
+  for (int round = 0; round < 2; ++round) {
+    auto children_vec = envpool.Branch(1, raw_branch);
+    DummyState children(&children_vec);
+    EXPECT_EQ(children["info:env_id"_].Shape(0), num_children);
+    for (int k = 0; k < num_children; ++k) {
+      EXPECT_EQ(static_cast<int>(children["info:env_id"_][k]), 1);
+      EXPECT_EQ(static_cast<int>(children["elapsed_step"_][k]), 2);
+      EXPECT_EQ(static_cast<int>(children["obs:raw"_](k, 0)), 2);
+    }
+  }
+  // the branched env itself has not moved
+  envpool.Send(action);
+  auto state_vec = envpool.Recv();
+  DummyState state(&state_vec);
+  EXPECT_EQ(static_cast<int>(state["elapsed_step"_][1]), 2);
+  EXPECT_EQ(static_cast<int>(state["obs:raw"_](1, 0)), 2);
+}
+
+TEST(DummyEnvPoolTest, Allocator) {
+  auto config = dummy::DummyEnvSpec::DEFAULT_CONFIG;
+  int num_envs = 4;
+  config["num_envs"_] = num_envs;
+  config["num_threads"_] = 2;
+  config["alloc_alignment"_] = 4096;
+  config["alloc_huge_page"_] = std::string("transparent");
+  config["alloc_prefault"_] = true;
+  dummy::DummyEnvSpec spec(config);
+  dummy::DummyEnvPool envpool(spec);
+  auto stats = envpool.Stats();
+  EXPECT_GT(stats["alloc_count"], 0);
+  EXPECT_GT(stats["alloc_bytes"], 0);
+  Array all_env_ids(Spec<int>({num_envs}));
+  for (int i = 0; i < num_envs; ++i) {
+    all_env_ids[i] = i;
+  }
+  envpool.Reset(all_env_ids);
+  auto state_vec = envpool.Recv();
+  for (const auto& arr : state_vec) {
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(arr.Data()) % 4096, 0);
+  }
+  config["alloc_huge_page"_] = std::string("always");
+  EXPECT_THROW(dummy::DummyEnvPool{dummy::DummyEnvSpec(config)},
+               std::invalid_argument);
+}
+
+TEST(DummyEnvPoolTest, ActionRepeat) {
+  auto config = dummy::DummyEnvSpec::DEFAULT_CONFIG;
+  int num_envs = 2;
+  config["num_envs"_] = num_envs;
+  config["num_threads"_] = 2;
+  config["seed"_] = 10;
+  config["action_repeat"_] = 3;
+  dummy::DummyEnvSpec spec(config);
+  dummy::DummyEnvPool envpool(spec);
+  Array all_env_ids(Spec<int>({num_envs}));
+  for (int i = 0; i < num_envs; ++i) {
+    all_env_ids[i] = i;
+  }
+  std::vector<Array> raw_action(
+      {Array(Spec<int>({num_envs})), Array(Spec<int>({num_envs})),
+       Array(Spec<int>({num_envs})), Array(Spec<int>({num_envs}))});
+  DummyAction action(&raw_action);
+  for (int i = 0; i < num_envs; ++i) {
+    action["env_id"_][i] = i;
+    action["players.env_id"_][i] = i;
+  }
+  envpool.Reset(all_env_ids);
+  envpool.Recv();
+  // env i ends its episode after 10 + i steps, each send runs 3 of them
+  std::vector<int> expect[2] = {{3, 6, 9, 10}, {3, 6, 9, 11}};
+  for (int t = 0; t < 4; ++t) {
+    envpool.Send(action);
+    auto state_vec = envpool.Recv();
+    DummyState state(&state_vec);
+    for (int i = 0; i < num_envs; ++i) {
+      EXPECT_EQ(static_cast<int>(state["obs:raw"_](i, 0)), expect[i][t]);
+      EXPECT_EQ(static_cast<int>(state["elapsed_step"_][i]), expect[i][t]);
+      EXPECT_EQ(static_cast<int>(state["info:episode_length"_][i]),
+                expect[i][t]);
+      EXPECT_EQ(static_cast<bool>(state["done"_][i]), t == 3);
+      Container<int>& dyn = state["obs:dyn"_][i];
+      EXPECT_EQ(dyn->Shape(0), i + 1);
+    }
+  }
+  config["max_num_players"_] = 2;
+  EXPECT_THROW(dummy::DummyEnvPool{dummy::DummyEnvSpec(config)},
+               std::invalid_argument);
+}
+
+TEST(DummyEnvPoolTest, StateKeys) {
+  auto config = dummy::DummyEnvSpec::DEFAULT_CONFIG;
+  int num_envs = 4;
+  config["num_envs"_] = num_envs;
+  config["num_threads"_] = 2;
+  config["max_num_players"_] = 3;
+  config["state_keys"_] = std::vector<std::string>({"obs:raw"});
+  dummy::DummyEnvSpec spec(config);
+  EXPECT_EQ(spec.StateMask(),
+            std::vector<bool>({true, true, true, true, true, true, false,
+                               false, false, true, false, false, false}));
+  dummy::DummyEnvPool envpool(spec);
+  Array all_env_ids(Spec<int>({num_envs}));
+  for (int i = 0; i < num_envs; ++i) {
+    all_env_ids[i] = i;
+  }
+  envpool.Reset(all_env_ids);
+  auto state_vec = envpool.Recv();
+  DummyState state(&state_vec);
+  int total_players = state["info:players.env_id"_].Shape(0);
+  EXPECT_GT(total_players, 0);
+  EXPECT_EQ(state["obs:raw"_].Shape(0), total_players);
+  for (int i = 0; i < total_players; ++i) {
+    EXPECT_EQ(static_cast<int>(state["obs:raw"_](i, 0)), 0);
+  }
+  // the pruned keys take no memory
+  EXPECT_EQ(state["obs:dyn"_].size, 0);
+  EXPECT_EQ(state["info:players.done"_].size, 0);
+  EXPECT_EQ(state["info:players.id"_].size, 0);
+  EXPECT_EQ(state["info:episode_return"_].size, 0);
+  EXPECT_EQ(state["info:episode_length"_].size, 0);
+  EXPECT_EQ(state["info:env_failed"_].size, 0);
+
+  config["state_keys"_] = std::vector<std::string>({"obs", "info"});
+  EXPECT_EQ(dummy::DummyEnvSpec(config).StateMask(),
+            std::vector<bool>(13, true));
+  config["state_keys"_] = std::vector<std::string>({"obs:unknown"});
+  EXPECT_THROW(dummy::DummyEnvSpec{config}, std::invalid_argument);
+  config["state_keys"_] = std::vector<std::string>({"info"});
+  EXPECT_THROW(dummy::DummyEnvSpec{config}, std::invalid_argument);
+}
+
+TEST(DummyEnvPoolTest, ObsDtype) {
+  auto config = dummy::DummyEnvSpec::DEFAULT_CONFIG;
+  config["obs_dtype"_] = "float16";
+  dummy::DummyEnvSpec spec(config);
+  // the dummy obs are int, which are kept as is
+  EXPECT_EQ(spec.StateCast(),
+            std::vector<FloatDtype>(13, FloatDtype::kFloat64));
+  auto shapes = spec.StateShapes();
+  EXPECT_EQ(shapes[9].element_size, sizeof(int));
+  config["obs_dtype"_] = "int8";
+  EXPECT_THROW(dummy::DummyEnvSpec{config}, std::invalid_argument);
+}
+
+TEST(DummyEnvPoolTest, NormReward) {
+  auto config = dummy::DummyEnvSpec::DEFAULT_CONFIG;
+  int num_envs = 4;
+  config["num_envs"_] = num_envs;
+  config["num_threads"_] = 2;
+  config["norm_reward"_] = true;
+  dummy::DummyEnvSpec spec(config);
+  dummy::DummyEnvPool envpool(spec);
+  Array all_env_ids(Spec<int>({num_envs}));
+  for (int i = 0; i < num_envs; ++i) {
+    all_env_ids[i] = i;
+  }
+  std::vector<Array> raw_action(
+      {Array(Spec<int>({num_envs})), Array(Spec<int>({num_envs})),
+       Array(Spec<int>({num_envs})), Array(Spec<int>({num_envs}))});
+  DummyAction action(&raw_action);
+  for (int i = 0; i < num_envs; ++i) {
+    action["env_id"_][i] = i;
+    action["players.env_id"_][i] = i;
+  }
+  envpool.Reset(all_env_ids);
+  envpool.Recv();
+  for (int t = 0; t < 50; ++t) {
+    envpool.Send(action);
+    auto state_vec = envpool.Recv();
+    DummyState state(&state_vec);
+    for (int i = 0; i < num_envs; ++i) {
+      float reward = state["reward"_][i];
+      EXPECT_LE(std::abs(reward), 10.0F);
+    }
+  }
+  // the dummy obs are int, only the return is tracked
+  auto stats = envpool.NormalizerState();
+  ASSERT_EQ(stats.size(), 3);
+  EXPECT_GT(stats[0], 0);
+  EXPECT_GE(stats[2], 0);
+  EXPECT_THROW(envpool.LoadNormalizerState({1.0}), std::invalid_argument);
+  envpool.LoadNormalizerState({10, 0, 4});
+  EXPECT_EQ(envpool.NormalizerState()[0], 10);
+
+  config["norm_reward"_] = false;
+  dummy::DummyEnvPool plain(dummy::DummyEnvSpec{config});
+  EXPECT_TRUE(plain.NormalizerState().empty());
+  EXPECT_THROW(plain.LoadNormalizerState({10, 0, 4}), std::runtime_error);
+}
+
+TEST(DummyEnvPoolTest, EpisodeStats) {
+  auto config = dummy::DummyEnvSpec::DEFAULT_CONFIG;
+  int num_envs = 2;
+  config["num_envs"_] = num_envs;
+  config["num_threads"_] = 2;
+  config["seed"_] = 10;
+  config["episode_window"_] = 4;
+  dummy::DummyEnvSpec spec(config);
+  dummy::DummyEnvPool envpool(spec);
+  Array all_env_ids(Spec<int>({num_envs}));
+  for (int i = 0; i < num_envs; ++i) {
+    all_env_ids[i] = i;
+  }
+  std::vector<Array> raw_action(
+      {Array(Spec<int>({num_envs})), Array(Spec<int>({num_envs})),
+       Array(Spec<int>({num_envs})), Array(Spec<int>({num_envs}))});
+  DummyAction action(&raw_action);
+  for (int i = 0; i < num_envs; ++i) {
+    action["env_id"_][i] = i;
+    action["players.env_id"_][i] = i;
+  }
+  envpool.Reset(all_env_ids);
+  envpool.Recv();
+  // env i ends its episode after 10 + i steps, and is reset at the next send
+  for (int t = 1; t <= 13; ++t) {
+    envpool.Send(action);
+    auto state_vec = envpool.Recv();
+    DummyState state(&state_vec);
+    for (int i = 0; i < num_envs; ++i) {
+      int end = 10 + i;
+      int length = t <= end ? t : t - end - 1;
+      EXPECT_EQ(static_cast<int>(state["info:episode_length"_][i]), length);
+      EXPECT_EQ(static_cast<float>(state["info:episode_return"_][i]), 0.0F);
+    }
+  }
+  auto [env_id, ret, length] = envpool.RecentEpisodes();
+  EXPECT_EQ(env_id, std::vector<int>({0, 1}));
+  EXPECT_EQ(ret, std::vector<float>({0.0F, 0.0F}));
+  EXPECT_EQ(length, std::vector<int>({10, 11}));
+
+  config["episode_window"_] = 0;
+  dummy::DummyEnvPool plain(dummy::DummyEnvSpec{config});
+  EXPECT_THROW(plain.RecentEpisodes(), std::runtime_error);
+}
+
+TEST(DummyEnvPoolTest, Rollout) {
+  auto config = dummy::DummyEnvSpec::DEFAULT_CONFIG;
+  int num_envs = 4;
+  int rollout_len = 3;
+  config["num_envs"_] = num_envs;
+  config["num_threads"_] = 2;
+  config["rollout_len"_] = rollout_len;
+  dummy::DummyEnvSpec spec(config);
+  dummy::DummyEnvPool envpool(spec);
+  EXPECT_THROW(envpool.Rollout(), std::runtime_error);
+  Array all_env_ids(Spec<int>({num_envs}));
+  for (int i = 0; i < num_envs; ++i) {
+    all_env_ids[i] = i;
+  }
+  std::vector<Array> raw_action(
+      {Array(Spec<int>({num_envs})), Array(Spec<int>({num_envs})),
+       Array(Spec<int>({num_envs})), Array(Spec<int>({num_envs}))});
+  DummyAction action(&raw_action);
+  for (int i = 0; i < num_envs; ++i) {
+    action["env_id"_][i] = i;
+    action["players.env_id"_][i] = i;
+  }
+  envpool.Reset(all_env_ids);
+  std::vector<std::vector<Array>> steps{envpool.Recv()};
+  for (int t = 1; t < 2 * rollout_len; ++t) {
+    if (t == rollout_len) {
+      auto rollout = envpool.Rollout();
+      EXPECT_EQ(rollout[2].Shape(0), rollout_len);
+      EXPECT_EQ(rollout[2].Shape(1), num_envs);
+      // the batches of Recv are the rows of the rollout, no copy
+      for (int k = 0; k < rollout_len; ++k) {
+        DummyState state(&steps[k]);
+        int* elapsed = static_cast<int*>(rollout[2].Data()) + k * num_envs;
+        EXPECT_EQ(state["elapsed_step"_].Data(), elapsed);
+        for (int i = 0; i < num_envs; ++i) {
+          EXPECT_EQ(elapsed[i], k);
+        }
+      }
+      EXPECT_THROW(envpool.Rollout(), std::runtime_error);
+    }
+    envpool.Send(action);
+    steps.push_back(envpool.Recv());
+  }
+  auto rollout = envpool.Rollout();
+  auto* elapsed = static_cast<int*>(rollout[2].Data());
+  EXPECT_EQ(elapsed[0], rollout_len);
+  EXPECT_EQ(elapsed[(rollout_len - 1) * num_envs], 2 * rollout_len - 1);
+  // the first rollout is still valid
+  DummyState first(&steps[0]);
+  EXPECT_EQ(static_cast<int>(first["elapsed_step"_][0]), 0);
+
+  // sending the actions in another env id order mixes the envs of a column
+  dummy::DummyEnvPool shuffled(spec);
+  shuffled.Reset(all_env_ids);
+  shuffled.Recv();
+  for (int t = 1; t < 2 * rollout_len; ++t) {
+    if (t == rollout_len) {
+      EXPECT_THROW(shuffled.Rollout(), std::runtime_error);
+    }
+    // every other step in the reverse order
+    for (int i = 0; i < num_envs; ++i) {
+      int env_id = t % 2 == 1 ? num_envs - 1 - i : i;
+      action["env_id"_][i] = env_id;
+      action["players.env_id"_][i] = env_id;
+    }
+    shuffled.Send(action);
+    shuffled.Recv();
+  }
+  rollout = shuffled.Rollout(false);
+  const auto* env_id = static_cast<const int*>(rollout[0].Data());
+  EXPECT_EQ(env_id[0], num_envs - 1);
+  EXPECT_EQ(env_id[num_envs], 0);
+
+  config["max_num_players"_] = 2;
+  EXPECT_THROW(dummy::DummyEnvSpec{config}, std::invalid_argument);
+}
+
+TEST(DummyEnvPoolTest, Trajectory) {
+  auto config = dummy::DummyEnvSpec::DEFAULT_CONFIG;
+  int num_envs = 2;
+  char dir[] = "/tmp/envpool_traj_XXXXXX";
+  ASSERT_NE(mkdtemp(dir), nullptr);
+  config["num_envs"_] = num_envs;
+  config["num_threads"_] = 1;
+  config["seed"_] = 3;
+  config["trajectory_dir"_] = std::string(dir);
+  dummy::DummyEnvSpec spec(config);
+  {
+    dummy::DummyEnvPool envpool(spec);
+    Array all_env_ids(Spec<int>({num_envs}));
+    for (int i = 0; i < num_envs; ++i) {
+      all_env_ids[i] = i;
+    }
+    std::vector<Array> raw_action(
+        {Array(Spec<int>({num_envs})), Array(Spec<int>({num_envs})),
+         Array(Spec<int>({num_envs})), Array(Spec<int>({num_envs}))});
+    DummyAction action(&raw_action);
+    for (int i = 0; i < num_envs; ++i) {
+      action["env_id"_][i] = i;
+      action["players.env_id"_][i] = i;
+      action["players.action"_][i] = 7;
+    }
+    envpool.Reset(all_env_ids);
+    envpool.Recv();
+    for (int t = 0; t < 6; ++t) {
+      envpool.Send(action);
+      envpool.Recv();
+    }
+  }
+  // one worker, so one shard with the steps in order
+  std::string shard = std::string(dir) + "/w0-00000";
+  FILE* f = std::fopen((shard + ".traj").c_str(), "rb");
+  ASSERT_NE(f, nullptr);
+  std::vector<char> data(1 << 16);
+  data.resize(std::fread(data.data(), 1, data.size(), f));
+  std::fclose(f);
+  TrajectoryLayout layout(spec);
+  ASSERT_EQ(layout.obs.size(), 1);
+  std::size_t num_record = (data.size() - TrajectoryWriter::kHeaderSize) /
+                           layout.record_size;
+  EXPECT_EQ(num_record, 7 * num_envs);
+  auto field = [&](std::size_t r, std::size_t offset) {
+    int value;
+    std::memcpy(&value,
+                data.data() + TrajectoryWriter::kHeaderSize +
+                    r * layout.record_size + offset,
+                sizeof(value));
+    return value;
+  };
+  for (std::size_t r = 0; r < num_record; ++r) {
+    int elapsed = field(r, TrajectoryLayout::kElapsedStepOffset);
+    // the action that led to this step, none after a reset
+    EXPECT_EQ(field(r, layout.action[0].offset), elapsed == 0 ? 0 : 7);
+    // obs:raw[0] is the step count of the dummy env
+    EXPECT_EQ(field(r, layout.obs[0].offset), elapsed);
+  }
+  f = std::fopen((shard + ".index").c_str(), "rb");
+  ASSERT_NE(f, nullptr);
+  std::vector<TrajectoryWriter::Episode> episodes(4);
+  episodes.resize(std::fread(episodes.data(), sizeof(episodes[0]),
+                             episodes.size(), f));
+  std::fclose(f);
+  // env 0 ends after 3 steps, env 1 after 4
+  ASSERT_EQ(episodes.size(), 2);
+  EXPECT_EQ(episodes[0].env_id, 0);
+  EXPECT_EQ(episodes[0].episode, 0);
+  EXPECT_EQ(episodes[0].length, 3);
+  EXPECT_EQ(episodes[1].env_id, 1);
+  EXPECT_EQ(episodes[1].length, 4);
+  EXPECT_EQ(field(episodes[1].last_record, TrajectoryLayout::kEnvIdOffset),
+            1);
+  std::remove((shard + ".traj").c_str());
+  std::remove((shard + ".index").c_str());
+  std::remove((std::string(dir) + "/meta.json").c_str());
+  rmdir(dir);
+
+  config["max_num_players"_] = 2;
+  EXPECT_THROW(dummy::DummyEnvSpec{config}, std::invalid_argument);
+}
+
+// the next step of env `hang_env` hangs for half a second
+class HangingEnv : public dummy::DummyEnv {
+ public:
+  static inline std::atomic<int> hang_env{-1};
+  static inline std::atomic<int> num_destroyed{0};
+  using dummy::DummyEnv::DummyEnv;
+  ~HangingEnv() { ++num_destroyed; }
+
+  void Step(const Action& action) override {
+    int env_id = env_id_;
+    if (hang_env.compare_exchange_strong(env_id, -1)) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    }
+    dummy::DummyEnv::Step(action);
+  }
+};
+
+TEST(DummyEnvPoolTest, Watchdog) {
+  auto config = dummy::DummyEnvSpec::DEFAULT_CONFIG;
+  int num_envs = 4;
+  config["num_envs"_] = num_envs;
+  config["num_threads"_] = 2;
+  config["seed"_] = 100;
+  config["step_timeout"_] = 0.1;
+  HangingEnv::num_destroyed = 0;
+  auto envpool_ptr =
+      std::make_unique<AsyncEnvPool<HangingEnv>>(dummy::DummyEnvSpec{config});
+  auto& envpool = *envpool_ptr;
+  Array all_env_ids(Spec<int>({num_envs}));
+  for (int i = 0; i < num_envs; ++i) {
+    all_env_ids[i] = i;
+  }
+  std::vector<Array> raw_action(
+      {Array(Spec<int>({num_envs})), Array(Spec<int>({num_envs})),
+       Array(Spec<int>({num_envs})), Array(Spec<int>({num_envs}))});
+  DummyAction action(&raw_action);
+  for (int i = 0; i < num_envs; ++i) {
+    action["env_id"_][i] = i;
+    action["players.env_id"_][i] = i;
+  }
+  envpool.Reset(all_env_ids);
+  envpool.Recv();
+  EXPECT_EQ(envpool.Stats()["env_restart_count"], 0);
+  HangingEnv::hang_env = 1;
+  for (int t = 1; t <= 3; ++t) {
+    envpool.Send(action);
+    auto state_vec = envpool.Recv();
+    DummyState state(&state_vec);
+    ASSERT_EQ(state["info:env_id"_].Shape(0), num_envs);
+    for (int i = 0; i < num_envs; ++i) {
+      int env_id = state["info:env_id"_][i];
+      bool failed = state["info:env_failed"_][i];
+      int elapsed_step = state["elapsed_step"_][i];
+      EXPECT_EQ(failed, t == 1 && env_id == 1);
+      EXPECT_EQ(static_cast<bool>(state["done"_][i]), failed);
+      // the rebuilt env 1 resets at its next action
+      EXPECT_EQ(elapsed_step, env_id == 1 ? (t == 1 ? 0 : t - 2) : t);
+    }
+  }
+  auto stats = envpool.Stats();
+  EXPECT_EQ(stats["env_restart_count"], 1);
+  EXPECT_EQ(stats.count("env_restart_us"), 1);
+  // let the abandoned step finish on its scratch state
+  std::this_thread::sleep_for(std::chrono::milliseconds(500));
+  envpool.Send(action);
+  envpool.Recv();
+  // the watchdog has joined the returned worker and freed the old env
+  EXPECT_EQ(HangingEnv::num_destroyed, 1);
+  envpool_ptr.reset();
+  EXPECT_EQ(HangingEnv::num_destroyed, num_envs + 1);
+
+  // a step that still hangs when the pool is destroyed keeps its env
+  HangingEnv::num_destroyed = 0;
+  envpool_ptr =
+      std::make_unique<AsyncEnvPool<HangingEnv>>(dummy::DummyEnvSpec{config});
+  envpool_ptr->Reset(all_env_ids);
+  envpool_ptr->Recv();
+  HangingEnv::hang_env = 1;
+  envpool_ptr->Send(action);
+  envpool_ptr->Recv();
+  envpool_ptr.reset();
+  // env 1 is only rebuilt at its next action
+  EXPECT_EQ(HangingEnv::num_destroyed, num_envs - 1);
+  // let the detached worker return before the test ends
+  std::this_thread::sleep_for(std::chrono::milliseconds(500));
+
+  // the repeated steps of action_repeat can't be abandoned
+  config["action_repeat"_] = 2;
+  EXPECT_THROW(dummy::DummyEnvSpec{config}, std::invalid_argument);
+}
+
+// checks that the pool has filled the env ids of the actions
+class CheckingPolicy : public Policy {
+ public:
+  int num_batch = 0;
+
+  void Act(const std::vector<Array>& state,
+           std::vector<Array>* action) override {
+    NamedVector<dummy::DummyEnvSpec::StateKeys, const std::vector<Array>> s(
+        &state);
+    DummyAction a(action);
+    ++num_batch;
+    for (std::size_t i = 0; i < a["env_id"_].Shape(0); ++i) {
+      int env_id = s["info:env_id"_][i];
+      EXPECT_EQ(static_cast<int>(a["env_id"_][i]), env_id);
+      EXPECT_EQ(static_cast<int>(a["players.env_id"_][i]), env_id);
+      EXPECT_EQ(static_cast<int>(a["players.action"_][i]), 0);
+      if (static_cast<int>(s["elapsed_step"_][i]) > 0) {
+        // the dummy env counts the actions of its players
+        EXPECT_EQ(static_cast<int>(s["obs:raw"_](i, 1)), 1);
+      }
+    }
+  }
+};
+
+TEST(DummyEnvPoolTest, RunPolicy) {
+  auto config = dummy::DummyEnvSpec::DEFAULT_CONFIG;
+  int num_envs = 4;
+  config["num_envs"_] = num_envs;
+  config["batch_size"_] = 2;
+  config["num_threads"_] = 2;
+  // env i ends after i + 1 steps
+  config["seed"_] = 1;
+  dummy::DummyEnvPool envpool(dummy::DummyEnvSpec{config});
+  Array all_env_ids(Spec<int>({num_envs}));
+  for (int i = 0; i < num_envs; ++i) {
+    all_env_ids[i] = i;
+  }
+  envpool.Reset(all_env_ids);
+  CheckingPolicy policy;
+  PolicyResult result = envpool.RunPolicy(&policy, 40, 0);
+  EXPECT_EQ(result.num_steps, 40);
+  EXPECT_EQ(policy.num_batch, 20);
+  EXPECT_EQ(result.total_reward, 0.0);
+  EXPECT_FALSE(result.env_id.empty());
+  for (std::size_t k = 0; k < result.env_id.size(); ++k) {
+    EXPECT_EQ(result.episode_length[k], result.env_id[k] + 1);
+    EXPECT_EQ(result.episode_return[k], 0.0F);
+  }
+  result = envpool.RunPolicy(&policy, 0, 5);
+  EXPECT_GE(result.env_id.size(), 5);
+  // all the envs are stepping again
+  for (int t = 0; t < 2; ++t) {
+    EXPECT_EQ(envpool.Recv()[0].Shape(0), 2);
+  }
+  EXPECT_THROW(envpool.RunPolicy(&policy, 0, 0), std::invalid_argument);
+  // the episode statistics are pruned
+  config["state_keys"_] = std::vector<std::string>({"obs"});
+  dummy::DummyEnvPool pruned(dummy::DummyEnvSpec{config});
+  EXPECT_THROW(pruned.RunPolicy(&policy, 1, 0), std::invalid_argument);
+}
+
+TEST(DummyEnvPoolTest, RunPolicyLibrary) {
+  auto config = dummy::DummyEnvSpec::DEFAULT_CONFIG;
+  int num_envs = 4;
+  config["num_envs"_] = num_envs;
+  config["num_threads"_] = 2;
+  config["seed"_] = 1;
+  dummy::DummyEnvPool envpool(dummy::DummyEnvSpec{config});
+  Array all_env_ids(Spec<int>({num_envs}));
+  for (int i = 0; i < num_envs; ++i) {
+    all_env_ids[i] = i;
+  }
+  envpool.Reset(all_env_ids);
+  std::string path = "envpool/dummy/libdummy_policy.so";
+  PolicyResult result = envpool.RunPolicy(path, "3", 0, 10);
+  EXPECT_EQ(result.num_steps % num_envs, 0);
+  EXPECT_GE(result.env_id.size(), 10);
+  for (std::size_t k = 0; k < result.env_id.size(); ++k) {
+    EXPECT_EQ(result.episode_length[k], result.env_id[k] + 1);
+  }
+  // the policy is reused
+  result = envpool.RunPolicy(path, "3", 8, 0);
+  EXPECT_EQ(result.num_steps, 8);
+  EXPECT_THROW(envpool.RunPolicy("envpool/dummy/missing.so", "", 1, 0),
+               std::runtime_error);
+}
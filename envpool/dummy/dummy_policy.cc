@@ -0,0 +1,52 @@
+/*
+ * Copyright 2022 Garena Online Private Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cstdlib>
+#include <vector>
+
+#include "envpool/core/policy.h"
+#include "envpool/dummy/dummy_envpool.h"
+
+namespace dummy {
+
+/**
+ * A scripted policy of the dummy env, built as a shared library to show how
+ * to write a policy plugin for `AsyncEnvPool::RunPolicy`. Every player takes
+ * the action given by `arg`.
+ */
+class DummyPolicy : public Policy {
+ protected:
+  int action_;
+
+ public:
+  explicit DummyPolicy(const char* arg) : action_(std::atoi(arg)) {}
+
+  void Act(const std::vector<Array>& state,
+           std::vector<Array>* action) override {
+    // name the arrays with the keys of the env spec
+    NamedVector<DummyEnvSpec::StateKeys, const std::vector<Array>> s(&state);
+    DummyEnv::Action a(action);
+    int num_players = a["players.env_id"_].Shape(0);
+    for (int i = 0; i < num_players; ++i) {
+      a["players.action"_][i] = action_;
+      a["players.id"_][i] = static_cast<int>(s["info:players.id"_][i]);
+    }
+  }
+};
+
+}  // namespace dummy
+
+ENVPOOL_REGISTER_POLICY(dummy::DummyPolicy)
@@ -35,6 +35,27 @@ class _DummyEnvPoolTest(absltest.TestCase):
       "base_path",
       "seed",
       "gym_reset_return_info",
+      "lazy_init",
+      "max_num_envs",
+      "contiguous_state",
+      "alloc_alignment",
+      "alloc_huge_page",
+      "alloc_zero_fill",
+      "alloc_prefault",
+      "action_repeat",
+      "state_keys",
+      "obs_dtype",
+      "norm_obs",
+      "norm_reward",
+      "norm_update",
+      "norm_clip",
+      "norm_gamma",
+      "norm_epsilon",
+      "episode_window",
+      "rollout_len",
+      "trajectory_dir",
+      "trajectory_shard_mb",
+      "step_timeout",
       "state_num",
       "action_num",
     ]
@@ -67,6 +88,54 @@ class _DummyEnvPoolTest(absltest.TestCase):
     state_spec = dict(zip(state_keys, env_spec._state_spec))
     self.assertEqual(state_spec["obs:raw"][1][-1], 666)
 
+  def test_state_keys(self) -> None:
+    conf = dict(
+      zip(_DummyEnvSpec._config_keys, _DummyEnvSpec._default_config_values)
+    )
+    conf["num_envs"] = num_envs = 4
+    conf["state_keys"] = ["obs:raw"]
+    env_spec = _DummyEnvSpec(tuple(conf.values()))
+    mask = env_spec._state_mask
+    kept = [k for k, m in zip(env_spec._state_keys, mask) if m]
+    self.assertEqual(
+      kept, [
+        "info:env_id", "info:players.env_id", "elapsed_step", "done",
+        "reward", "info:task_id", "obs:raw"
+      ]
+    )
+    env = _DummyEnvPool(env_spec)
+    env._reset(np.arange(num_envs, dtype=np.int32))
+    state = dict(zip(kept, env._recv()))
+    self.assertEqual(len(state), len(kept))
+    self.assertEqual(state["obs:raw"].shape, (num_envs, 10))
+    self.assertNotIn("info:episode_return", state)
+
+  def test_state_arena(self) -> None:
+    conf = dict(
+      zip(_DummyEnvSpec._config_keys, _DummyEnvSpec._default_config_values)
+    )
+    conf["num_envs"] = num_envs = 4
+    conf["contiguous_state"] = True
+    env = _DummyEnvPool(_DummyEnvSpec(tuple(conf.values())))
+    self.assertRaises(RuntimeError, env._state_arena)
+    env._reset(np.arange(num_envs, dtype=np.int32))
+    state = dict(zip(env._state_keys, env._recv()))
+    arena = env._state_arena()
+    self.assertEqual(arena.dtype, np.uint8)
+    begin = arena.__array_interface__["data"][0]
+    end = begin + arena.nbytes
+    for value in state.values():
+      if value.dtype != object:
+        ptr = value.__array_interface__["data"][0]
+        self.assertTrue(begin <= ptr and ptr + value.nbytes <= end)
+    # the buffer keeps the batch alive
+    obs = state["obs:raw"].copy()
+    offset = state["obs:raw"].__array_interface__["data"][0] - begin
+    del state
+    np.testing.assert_array_equal(
+      arena[offset:offset + obs.nbytes].view(obs.dtype).reshape(obs.shape), obs
+    )
+
   def test_envpool(self) -> None:
     conf = dict(
       zip(_DummyEnvSpec._config_keys, _DummyEnvSpec._default_config_values)
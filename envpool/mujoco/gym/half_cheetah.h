@@ -96,6 +96,18 @@ class HalfCheetahEnv : public Env<HalfCheetahEnvSpec>, public MujocoEnv {
 
   bool IsDone() override { return done_; }
 
+  void Save(SnapshotWriter* writer) override {
+    SaveEnv(writer);
+    MujocoSave(writer);
+    writer->WriteText(dist_qvel_);
+  }
+
+  void Load(SnapshotReader* reader) override {
+    LoadEnv(reader);
+    MujocoLoad(reader);
+    reader->ReadText(&dist_qvel_);
+  }
+
   void Reset() override {
     done_ = false;
     elapsed_step_ = 0;
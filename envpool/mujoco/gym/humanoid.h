@@ -113,6 +113,20 @@ class HumanoidEnv : public Env<HumanoidEnvSpec>, public MujocoEnv {
 
   bool IsDone() override { return done_; }
 
+  void Save(SnapshotWriter* writer) override {
+    SaveEnv(writer);
+    MujocoSave(writer);
+    writer->Write(mass_x_);
+    writer->Write(mass_y_);
+  }
+
+  void Load(SnapshotReader* reader) override {
+    LoadEnv(reader);
+    MujocoLoad(reader);
+    reader->Read(&mass_x_);
+    reader->Read(&mass_y_);
+  }
+
   void Reset() override {
     done_ = false;
     elapsed_step_ = 0;
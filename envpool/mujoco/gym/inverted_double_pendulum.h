@@ -95,6 +95,18 @@ class InvertedDoublePendulumEnv : public Env<InvertedDoublePendulumEnvSpec>,
 
   bool IsDone() override { return done_; }
 
+  void Save(SnapshotWriter* writer) override {
+    SaveEnv(writer);
+    MujocoSave(writer);
+    writer->WriteText(dist_qvel_);
+  }
+
+  void Load(SnapshotReader* reader) override {
+    LoadEnv(reader);
+    MujocoLoad(reader);
+    reader->ReadText(&dist_qvel_);
+  }
+
   void Reset() override {
     done_ = false;
     elapsed_step_ = 0;
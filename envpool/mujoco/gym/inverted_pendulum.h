@@ -90,6 +90,16 @@ class InvertedPendulumEnv : public Env<InvertedPendulumEnvSpec>,
 
   bool IsDone() override { return done_; }
 
+  void Save(SnapshotWriter* writer) override {
+    SaveEnv(writer);
+    MujocoSave(writer);
+  }
+
+  void Load(SnapshotReader* reader) override {
+    LoadEnv(reader);
+    MujocoLoad(reader);
+  }
+
   void Reset() override {
     done_ = false;
     elapsed_step_ = 0;
@@ -22,6 +22,8 @@
 
 #include <string>
 
+#include "envpool/core/snapshot.h"
+
 namespace mujoco_gym {
 
 class MujocoEnv {
@@ -81,6 +83,36 @@ class MujocoEnv {
     throw std::runtime_error("reset_model not implemented");
   }
 
+  /**
+   * Serialize the simulator state, derived quantities are recomputed by
+   * mj_forward when loading.
+   */
+  void MujocoSave(SnapshotWriter* writer) {
+    writer->Write(elapsed_step_);
+    writer->Write(done_);
+    writer->Write(data_->time);
+    writer->WriteBytes(data_->qpos, sizeof(mjtNum) * model_->nq);
+    writer->WriteBytes(data_->qvel, sizeof(mjtNum) * model_->nv);
+    writer->WriteBytes(data_->act, sizeof(mjtNum) * model_->na);
+    writer->WriteBytes(data_->ctrl, sizeof(mjtNum) * model_->nu);
+    writer->WriteBytes(data_->qacc_warmstart, sizeof(mjtNum) * model_->nv);
+  }
+
+  void MujocoLoad(SnapshotReader* reader) {
+    reader->Read(&elapsed_step_);
+    reader->Read(&done_);
+    reader->Read(&data_->time);
+    reader->ReadBytes(data_->qpos, sizeof(mjtNum) * model_->nq);
+    reader->ReadBytes(data_->qvel, sizeof(mjtNum) * model_->nv);
+    reader->ReadBytes(data_->act, sizeof(mjtNum) * model_->na);
+    reader->ReadBytes(data_->ctrl, sizeof(mjtNum) * model_->nu);
+    reader->ReadBytes(data_->qacc_warmstart, sizeof(mjtNum) * model_->nv);
+    mj_forward(model_, data_);
+    if (post_constraint_) {
+      mj_rnePostConstraint(model_, data_);
+    }
+  }
+
   void MujocoStep(const mjtNum* action) {
     for (int i = 0; i < model_->nu; ++i) {
       data_->ctrl[i] = action[i];
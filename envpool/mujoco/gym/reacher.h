@@ -104,6 +104,16 @@ class ReacherEnv : public Env<ReacherEnvSpec>, public MujocoEnv {
 
   bool IsDone() override { return done_; }
 
+  void Save(SnapshotWriter* writer) override {
+    SaveEnv(writer);
+    MujocoSave(writer);
+  }
+
+  void Load(SnapshotReader* reader) override {
+    LoadEnv(reader);
+    MujocoLoad(reader);
+  }
+
   void Reset() override {
     done_ = false;
     elapsed_step_ = 0;
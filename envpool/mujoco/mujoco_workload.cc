@@ -0,0 +1,39 @@
+// Copyright 2022 Garena Online Private Limited
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <string>
+
+#include "envpool/core/workload.h"
+#include "envpool/mujoco/dmc/hopper.h"
+#include "envpool/mujoco/gym/ant.h"
+#include "envpool/mujoco/gym/half_cheetah.h"
+#include "envpool/mujoco/gym/humanoid.h"
+
+using mujoco_gym::AntEnvPool;
+using mujoco_gym::HalfCheetahEnvPool;
+using mujoco_gym::HumanoidEnvPool;
+using DmcHopperEnvPool = mujoco_dmc::HopperEnvPool;
+
+int main(int argc, char** argv) {
+  int num_steps = argc > 1 ? std::stoi(argv[1]) : 20000;
+  RunWorkload<AntEnvPool>("Ant-v4", WorkloadConfig<AntEnvPool>(8),
+                          num_steps);
+  RunWorkload<HalfCheetahEnvPool>(
+      "HalfCheetah-v4", WorkloadConfig<HalfCheetahEnvPool>(8), num_steps);
+  RunWorkload<HumanoidEnvPool>(
+      "Humanoid-v4", WorkloadConfig<HumanoidEnvPool>(8), num_steps);
+  RunWorkload<DmcHopperEnvPool>(
+      "HopperStand-v1", WorkloadConfig<DmcHopperEnvPool>(8), num_steps);
+  return 0;
+}
@@ -50,8 +50,6 @@ class DMEnvPoolMeta(ABCMeta):
     check_key_duplication(name, "state", state_keys)
     check_key_duplication(name, "action", action_keys)
 
-    state_structure, state_idx = dm_structure("State", state_keys)
-
     def _to_dm(
       self: Any,
       state_values: List[np.ndarray],
@@ -59,7 +57,7 @@ class DMEnvPoolMeta(ABCMeta):
       return_info: bool,
     ) -> TimeStep:
       state = tree.unflatten_as(
-        state_structure, [state_values[i] for i in state_idx]
+        self._state_structure, [state_values[i] for i in self._state_idx]
       )
       done = state.done
       elapse = state.elapsed_step
@@ -80,9 +78,14 @@ class DMEnvPoolMeta(ABCMeta):
 
     @no_type_check
     def init(self: Any, spec: Any) -> None:
-      """Set self.spec to EnvSpecMeta."""
+      """Set self.spec to EnvSpecMeta, or the first one in a multi-task pool."""
       super(subcls, self).__init__(spec)
-      self.spec = spec
+      self.task_specs = list(spec) if isinstance(spec, list) else [spec]
+      self.spec = self.task_specs[0]
+      # recv only returns the state keys kept by the state_keys config
+      self._state_structure, self._state_idx = dm_structure(
+        "State", list(self.spec.state_array_spec)
+      )
 
     setattr(subcls, "__init__", init)  # noqa: B010
     return subcls
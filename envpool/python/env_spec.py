@@ -58,7 +58,11 @@ class EnvSpecMixin(ABC):
         its values is a tuple of (dtype, shape).
     """
     state_spec = [ArraySpec(*s) for s in self._state_spec]
-    return dict(zip(self._state_keys, state_spec))
+    return {
+      k: s
+      for k, s, m in zip(self._state_keys, state_spec, self._state_mask)
+      if m
+    }
 
   @property
   def action_array_spec(self: EnvSpec) -> Dict[str, Any]:
@@ -80,8 +80,114 @@ class EnvPoolMixin(ABC):
 
   @property
   def all_env_ids(self: EnvPool) -> np.ndarray:
-    """All env_id in numpy ndarray with dtype=np.int32."""
-    return np.arange(self.config["num_envs"], dtype=np.int32)
+    """All alive env_id in numpy ndarray with dtype=np.int32."""
+    if not hasattr(self, "_all_env_ids"):
+      self._all_env_ids = np.array(self._env_ids(), dtype=np.int32)
+    return self._all_env_ids.copy()
+
+  def add_envs(self: EnvPool, num: int) -> np.ndarray:
+    """Add ``num`` envs to the EnvPool and return their env_id.
+
+    The new envs need to be reset before stepping. In sync mode it can only
+    be called after all states have been received.
+    """
+    env_ids = np.array(self._add_envs(num), dtype=np.int32)
+    self._sync_env_ids()
+    return env_ids
+
+  def remove_envs(self: EnvPool, env_id: np.ndarray) -> None:
+    """Remove envs in env_id from the EnvPool, other env_id keep unchanged.
+
+    In sync mode it can only be called after all states have been received.
+    """
+    self._remove_envs(np.asarray(env_id, dtype=np.int32).tolist())
+    self._sync_env_ids()
+
+  def reseed(
+    self: EnvPool,
+    seed: Union[int, np.ndarray],
+    env_id: Optional[np.ndarray] = None,
+  ) -> None:
+    """Set the seed of envs in env_id, applied at their next reset.
+
+    An int ``seed`` gives env i the seed ``seed + i``, the same as the
+    ``seed`` config at construction; otherwise one seed per env is expected.
+    The envs are not rebuilt, so a warm EnvPool can be reused across
+    evaluation rounds.
+    """
+    if env_id is None:
+      env_id = self.all_env_ids
+    env_id = np.asarray(env_id, dtype=np.int32)
+    if np.ndim(seed) == 0:
+      seed = int(seed) + env_id
+    self._reseed(env_id.tolist(), np.asarray(seed, dtype=np.int32).tolist())
+
+  def save(self: EnvPool, path: str) -> None:
+    """Save the full state of all envs into a memory-mapped file.
+
+    It should be called after receiving all states, in-flight steps are
+    waited for but not recorded.
+    """
+    self._save(path)
+
+  def load(self: EnvPool, path: str) -> None:
+    """Restore all envs from a file written by ``save``.
+
+    The file must come from an EnvPool with the same config.
+    """
+    self._load(path)
+    self._sync_env_ids()
+
+  def normalizer_state(self: EnvPool) -> np.ndarray:
+    """Export the running statistics of ``norm_obs`` / ``norm_reward``.
+
+    It is a flat array of count, mean and var of each normalized obs key,
+    then of the discounted return; empty if the pool doesn't normalize.
+    """
+    return np.array(self._normalizer_state(), dtype=np.float64)
+
+  def load_normalizer_state(self: EnvPool, state: np.ndarray) -> None:
+    """Load the statistics exported by ``normalizer_state``.
+
+    Create the pool with ``norm_update=False`` to keep them fixed, e.g., to
+    evaluate with the statistics of a training pool.
+    """
+    self._load_normalizer_state(np.asarray(state, dtype=np.float64).tolist())
+
+  def recent_episodes(self: EnvPool) -> Dict[str, np.ndarray]:
+    """The last ``episode_window`` finished episodes, oldest first.
+
+    It returns the ``env_id``, ``episode_return`` and ``episode_length`` of
+    each episode, the same as ``info`` at the last step of the episode.
+    """
+    env_id, ret, length = self._recent_episodes()
+    return {
+      "env_id": np.array(env_id, dtype=np.int32),
+      "episode_return": np.array(ret, dtype=np.float32),
+      "episode_length": np.array(length, dtype=np.int32),
+    }
+
+  def _sync_env_ids(self: EnvPool) -> None:
+    """Refresh the cached env ids and spec after resizing."""
+    self._all_env_ids = np.array(self._env_ids(), dtype=np.int32)
+    config = self.config
+    self.task_specs = [
+      s.__class__(
+        s.config._replace(
+          num_envs=config["num_envs"], batch_size=config["batch_size"]
+        )
+      ) for s in self.task_specs
+    ]
+    self.spec = self.task_specs[0]
+
+  @property
+  def env_init_time(self: EnvPool) -> np.ndarray:
+    """Construction time of each env in seconds, 0 if not built yet."""
+    return np.array(self._env_init_time())
+
+  def stats(self: EnvPool) -> Dict[str, int]:
+    """Counters of the pool, e.g., memory handed out by its allocator."""
+    return dict(self._stats())
 
   @property
   def is_async(self: EnvPool) -> bool:
@@ -117,6 +223,81 @@ class EnvPoolMixin(ABC):
     state_list = self._recv()
     return self._to(state_list, reset, return_info)
 
+  def rollout(
+    self: EnvPool,
+    check_env_id: bool = True,
+  ) -> Union[TimeStep, Tuple]:
+    """The last complete rollout of ``rollout_len`` recv batches.
+
+    Every field has shape ``[rollout_len, batch_size, ...]``, step ``t`` is
+    the ``t``-th recv of the rollout. The envs write each step into it in
+    place, so it costs no copy; the next rollout goes to separate memory.
+
+    With ``check_env_id``, it raises a ``RuntimeError`` unless every column
+    holds the steps of one env, as ``compute_gae`` and
+    ``compute_nstep_return`` assume: use sync mode and send the actions in
+    the ``env_id`` order of ``recv``. Async rollouts need
+    ``check_env_id=False`` and a reorder by ``info["env_id"]``.
+    """
+    return self._to(self._rollout(check_env_id), False, True)
+
+  def state_arena(self: EnvPool) -> np.ndarray:
+    """The buffer of the last recv batch with ``contiguous_state=True``.
+
+    A 1-D uint8 array over the whole batch: every state array of the last
+    recv is a view into it. The arrays keep their full batch layout, so a
+    smaller batch (e.g., fewer players than ``batch_size * max_num_players``)
+    leaves unused bytes between them. Not available with ``rollout_len > 1``.
+    """
+    return self._state_arena()
+
+  def run_policy(
+    self: EnvPool,
+    path: str,
+    num_steps: int = 0,
+    num_episodes: int = 0,
+    arg: str = "",
+  ) -> Dict[str, Any]:
+    """Run the C++ policy of a shared library on the envpool.
+
+    The library at ``path`` registers the policy with
+    ``ENVPOOL_REGISTER_POLICY`` (see ``envpool/core/policy.h``), it is built
+    with ``arg``. The policy acts on every received batch and the actions are
+    sent back without going through Python, until ``num_steps`` env steps
+    have been received or ``num_episodes`` episodes have finished. Call it
+    after ``async_reset()``; on return all the envs are stepping again.
+    It returns the number of steps, their total reward, the time taken
+    (``seconds``) and the ``env_id``, ``episode_return`` and
+    ``episode_length`` of the finished episodes.
+    """
+    steps, reward, seconds, env_id, ret, length = self._run_policy(
+      path, arg, num_steps, num_episodes
+    )
+    return {
+      "num_steps": steps,
+      "total_reward": reward,
+      "seconds": seconds,
+      "env_id": np.array(env_id, dtype=np.int32),
+      "episode_return": np.array(ret, dtype=np.float32),
+      "episode_length": np.array(length, dtype=np.int32),
+    }
+
+  def branch(
+    self: EnvPool,
+    env_id: int,
+    action: Union[Dict[str, Any], np.ndarray],
+  ) -> Union[TimeStep, Tuple]:
+    """Step one copy of env ``env_id`` for each row of ``action``.
+
+    Env ``env_id`` itself is not changed. The children are restored from a
+    snapshot of it on scratch envs and returned as one batch, in the order of
+    the action rows.
+    """
+    num = len(tree.flatten(action)[0])
+    action = self._from(action, np.full(num, env_id, dtype=np.int32))
+    self._check_action(action)
+    return self._to(self._branch(env_id, action), False, True)
+
   def async_reset(self: EnvPool) -> None:
     """Follows the async semantics, reset the envs in env_ids."""
     self._reset(self.all_env_ids)
@@ -145,6 +326,18 @@ class EnvPoolMixin(ABC):
       reset=True, return_info=self.config["gym_reset_return_info"]
     )
 
+  def reconfigure(self: EnvPool, **kwargs: Any) -> None:
+    """Change the config of a live EnvPool without rebuilding the envs.
+
+    Only the keys that don't change the specs are accepted (e.g.
+    ``max_episode_steps`` or ``episodic_life`` in Atari), each env picks the
+    new config up at its next reset.
+    """
+    specs = [s.__class__(s.config._replace(**kwargs)) for s in self.task_specs]
+    self._reconfigure(specs)
+    self.task_specs = specs
+    self.spec = specs[0]
+
   @property
   def config(self: EnvPool) -> Dict[str, Any]:
     """Config dict of this class."""
@@ -51,13 +51,11 @@ class GymEnvPoolMeta(ABCMeta):
     check_key_duplication(name, "state", state_keys)
     check_key_duplication(name, "action", action_keys)
 
-    state_structure, state_idx = gym_structure(state_keys)
-
     def _to_gym(
       self: Any, state_values: List[np.ndarray], reset: bool, return_info: bool
     ) -> Union[Any, Tuple[Any, Any], Tuple[Any, np.ndarray, np.ndarray, Any]]:
       state = tree.unflatten_as(
-        state_structure, [state_values[i] for i in state_idx]
+        self._state_structure, [state_values[i] for i in self._state_idx]
       )
       if reset and not return_info:
         return state["obs"]
@@ -75,9 +73,14 @@ class GymEnvPoolMeta(ABCMeta):
 
     @no_type_check
     def init(self: Any, spec: Any) -> None:
-      """Set self.spec to EnvSpecMeta."""
+      """Set self.spec to EnvSpecMeta, or the first one in a multi-task pool."""
       super(subcls, self).__init__(spec)
-      self.spec = spec
+      self.task_specs = list(spec) if isinstance(spec, list) else [spec]
+      self.spec = self.task_specs[0]
+      # recv only returns the state keys kept by the state_keys config
+      self._state_structure, self._state_idx = gym_structure(
+        list(self.spec.state_array_spec)
+      )
 
     setattr(subcls, "__init__", init)  # noqa: B010
     return subcls
@@ -52,6 +52,10 @@ class EnvSpec(Protocol):
   def _action_keys(self) -> List:
     """Cpp private _action_keys."""
 
+  @property
+  def _state_mask(self) -> List[bool]:
+    """Cpp private _state_mask."""
+
   @property
   def _config_values(self) -> Tuple:
     """Cpp private _config_values."""
@@ -120,8 +124,9 @@ class EnvPool(Protocol):
   _state_keys: List[str]
   _action_keys: List[str]
   spec: Any
+  task_specs: List[Any]
 
-  def __init__(self, spec: EnvSpec):
+  def __init__(self, spec: Union[EnvSpec, List[EnvSpec]]):
     """Constructor of EnvPool."""
 
   def __len__(self) -> int:
@@ -147,6 +152,57 @@ class EnvPool(Protocol):
   def _reset(self, env_id: np.ndarray) -> None:
     """Cpp private _reset method."""
 
+  def _env_init_time(self) -> List[float]:
+    """Cpp private _env_init_time method."""
+
+  def _stats(self) -> Dict[str, int]:
+    """Cpp private _stats method."""
+
+  def _reconfigure(self, specs: List[EnvSpec]) -> None:
+    """Cpp private _reconfigure method."""
+
+  def _env_ids(self) -> List[int]:
+    """Cpp private _env_ids method."""
+
+  def _add_envs(self, num: int) -> List[int]:
+    """Cpp private _add_envs method."""
+
+  def _remove_envs(self, env_id: List[int]) -> None:
+    """Cpp private _remove_envs method."""
+
+  def _branch(self, env_id: int,
+              action: List[np.ndarray]) -> List[np.ndarray]:
+    """Cpp private _branch method."""
+
+  def _reseed(self, env_id: List[int], seed: List[int]) -> None:
+    """Cpp private _reseed method."""
+
+  def _save(self, path: str) -> None:
+    """Cpp private _save method."""
+
+  def _load(self, path: str) -> None:
+    """Cpp private _load method."""
+
+  def _normalizer_state(self) -> List[float]:
+    """Cpp private _normalizer_state method."""
+
+  def _load_normalizer_state(self, state: List[float]) -> None:
+    """Cpp private _load_normalizer_state method."""
+
+  def _recent_episodes(self) -> Tuple[List[int], List[float], List[int]]:
+    """Cpp private _recent_episodes method."""
+
+  def _rollout(self, check_env_id: bool) -> List[np.ndarray]:
+    """Cpp private _rollout method."""
+
+  def _state_arena(self) -> np.ndarray:
+    """Cpp private _state_arena method."""
+
+  def _run_policy(
+    self, path: str, arg: str, num_steps: int, num_episodes: int
+  ) -> Tuple[int, float, float, List[int], List[float], List[int]]:
+    """Cpp private _run_policy method."""
+
   def _from(
     self,
     action: Union[Dict[str, Any], np.ndarray],
@@ -166,6 +222,13 @@ class EnvPool(Protocol):
   def all_env_ids(self) -> np.ndarray:
     """All env_id in numpy ndarray with dtype=np.int32."""
 
+  @property
+  def env_init_time(self) -> np.ndarray:
+    """Construction time of each env in seconds."""
+
+  def stats(self) -> Dict[str, int]:
+    """Counters of the pool, e.g., memory handed out by its allocator."""
+
   @property
   def is_async(self) -> bool:
     """Return if this env is in sync mode or async mode."""
@@ -187,6 +250,35 @@ class EnvPool(Protocol):
   def seed(self, seed: Optional[Union[int, List[int]]] = None) -> None:
     """Set the seed for all environments."""
 
+  def reconfigure(self, **kwargs: Any) -> None:
+    """Change the config of a live EnvPool."""
+
+  def add_envs(self, num: int) -> np.ndarray:
+    """Add envs to a live EnvPool."""
+
+  def remove_envs(self, env_id: np.ndarray) -> None:
+    """Remove envs from a live EnvPool."""
+
+  def branch(
+    self,
+    env_id: int,
+    action: Union[Dict[str, Any], np.ndarray],
+  ) -> Union[TimeStep, Tuple]:
+    """Step copies of one env with several actions, env is unchanged."""
+
+  def reseed(
+    self,
+    seed: Union[int, np.ndarray],
+    env_id: Optional[np.ndarray] = None,
+  ) -> None:
+    """Set the seed of envs, applied at their next reset."""
+
+  def save(self, path: str) -> None:
+    """Save the state of all envs into a file."""
+
+  def load(self, path: str) -> None:
+    """Restore the state of all envs from a file."""
+
   @property
   def config(self) -> Dict[str, Any]:
     """Envpool config."""
@@ -205,6 +297,21 @@ class EnvPool(Protocol):
   ) -> Union[TimeStep, Tuple]:
     """Envpool recv wrapper."""
 
+  def rollout(self, check_env_id: bool = True) -> Union[TimeStep, Tuple]:
+    """The last complete rollout of ``rollout_len`` recv batches."""
+
+  def state_arena(self) -> np.ndarray:
+    """The buffer of the last recv batch with ``contiguous_state``."""
+
+  def run_policy(
+    self,
+    path: str,
+    num_steps: int = 0,
+    num_episodes: int = 0,
+    arg: str = "",
+  ) -> Dict[str, Any]:
+    """Run the C++ policy of a shared library on the envpool."""
+
   def async_reset(self) -> None:
     """Envpool async reset interface."""
 
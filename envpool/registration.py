@@ -14,7 +14,7 @@
 """Global env registry."""
 
 import importlib
-from typing import Any, Dict, List, Tuple
+from typing import Any, Dict, List, Tuple, Union
 
 
 class EnvRegistry:
@@ -37,20 +37,33 @@ class EnvRegistry:
       "gym": (import_path, gym_cls)
     }
 
-  def make(self, task_id: str, env_type: str, **kwargs: Any) -> Any:
-    """Make envpool."""
-    assert task_id in self.specs, \
-      f"{task_id} is not supported, `envpool.list_all_envs()` may help."
+  def make(
+    self, task_id: Union[str, List[str]], env_type: str, **kwargs: Any
+  ) -> Any:
+    """Make envpool.
+
+    A list of task_id makes a multi-task envpool, whose i-th env runs the
+    task ``task_id[i % len(task_id)]``. All the tasks must come from the same
+    family and share the observation / action shape.
+    """
+    task_ids = task_id if isinstance(task_id, list) else [task_id]
+    for t in task_ids:
+      assert t in self.specs, \
+        f"{t} is not supported, `envpool.list_all_envs()` may help."
     assert env_type in ["dm", "gym"]
-    spec = self.make_spec(task_id, **kwargs)
-    import_path, envpool_cls = self.envpools[task_id][env_type]
-    return getattr(importlib.import_module(import_path), envpool_cls)(spec)
+    envpools = {self.envpools[t][env_type] for t in task_ids}
+    assert len(envpools) == 1, \
+      f"Cannot make a multi-task envpool across families: {envpools}."
+    specs = [self.make_spec(t, **kwargs) for t in task_ids]
+    import_path, envpool_cls = self.envpools[task_ids[0]][env_type]
+    envpool_cls = getattr(importlib.import_module(import_path), envpool_cls)
+    return envpool_cls(specs if isinstance(task_id, list) else specs[0])
 
-  def make_dm(self, task_id: str, **kwargs: Any) -> Any:
+  def make_dm(self, task_id: Union[str, List[str]], **kwargs: Any) -> Any:
     """Make dm_env compatible envpool."""
     return self.make(task_id, "dm", **kwargs)
 
-  def make_gym(self, task_id: str, **kwargs: Any) -> Any:
+  def make_gym(self, task_id: Union[str, List[str]], **kwargs: Any) -> Any:
     """Make gym.Env compatible envpool."""
     return self.make(task_id, "gym", **kwargs)
 
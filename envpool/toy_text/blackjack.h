@@ -26,6 +26,7 @@
 
 #include "envpool/core/async_envpool.h"
 #include "envpool/core/env.h"
+#include "envpool/utils/random.h"
 
 namespace toy_text {
 
@@ -46,7 +47,17 @@ class BlackjackEnvFns {
 
 using BlackjackEnvSpec = EnvSpec<BlackjackEnvFns>;
 
-class BlackjackEnv : public Env<BlackjackEnvSpec> {
+template <typename RandomEngine>
+class BasicBlackjackEnv : public Env<BlackjackEnvSpec, RandomEngine> {
+  using Base = Env<BlackjackEnvSpec, RandomEngine>;
+  using Base::Allocate;
+  using Base::gen_;
+
+ public:
+  using typename Base::Action;
+  using typename Base::Spec;
+  using typename Base::State;
+
  protected:
   bool natural_, sab_;
   std::vector<int> player_, dealer_;
@@ -54,8 +65,8 @@ class BlackjackEnv : public Env<BlackjackEnvSpec> {
   bool done_;
 
  public:
-  BlackjackEnv(const Spec& spec, int env_id)
-      : Env<BlackjackEnvSpec>(spec, env_id),
+  BasicBlackjackEnv(const Spec& spec, int env_id)
+      : Base(spec, env_id),
         natural_(spec.config["natural"_]),
         sab_(spec.config["sab"_]),
         dist_(1, 13),
@@ -147,7 +158,9 @@ class BlackjackEnv : public Env<BlackjackEnvSpec> {
   }
 };
 
+using BlackjackEnv = BasicBlackjackEnv<std::mt19937>;
 using BlackjackEnvPool = AsyncEnvPool<BlackjackEnv>;
+using BlackjackPcg32EnvPool = AsyncEnvPool<BasicBlackjackEnv<Pcg32>>;
 
 }  // namespace toy_text
 
@@ -23,6 +23,7 @@
 
 #include "envpool/core/async_envpool.h"
 #include "envpool/core/env.h"
+#include "envpool/utils/random.h"
 
 namespace toy_text {
 
@@ -44,15 +45,25 @@ class CatchEnvFns {
 
 using CatchEnvSpec = EnvSpec<CatchEnvFns>;
 
-class CatchEnv : public Env<CatchEnvSpec> {
+template <typename RandomEngine>
+class BasicCatchEnv : public Env<CatchEnvSpec, RandomEngine> {
+  using Base = Env<CatchEnvSpec, RandomEngine>;
+  using Base::Allocate;
+  using Base::gen_;
+
+ public:
+  using typename Base::Action;
+  using typename Base::Spec;
+  using typename Base::State;
+
  protected:
   int x_, y_, height_, width_, paddle_;
   std::uniform_int_distribution<> dist_;
   bool done_;
 
  public:
-  CatchEnv(const Spec& spec, int env_id)
-      : Env<CatchEnvSpec>(spec, env_id),
+  BasicCatchEnv(const Spec& spec, int env_id)
+      : Base(spec, env_id),
         height_(spec.config["height"_]),
         width_(spec.config["width"_]),
         dist_(0, width_ - 1),
@@ -94,7 +105,9 @@ class CatchEnv : public Env<CatchEnvSpec> {
   }
 };
 
+using CatchEnv = BasicCatchEnv<std::mt19937>;
 using CatchEnvPool = AsyncEnvPool<CatchEnv>;
+using CatchPcg32EnvPool = AsyncEnvPool<BasicCatchEnv<Pcg32>>;
 
 }  // namespace toy_text
 
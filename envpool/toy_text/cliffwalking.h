@@ -26,6 +26,7 @@
 
 #include "envpool/core/async_envpool.h"
 #include "envpool/core/env.h"
+#include "envpool/utils/random.h"
 
 namespace toy_text {
 
@@ -44,14 +45,23 @@ class CliffWalkingEnvFns {
 
 using CliffWalkingEnvSpec = EnvSpec<CliffWalkingEnvFns>;
 
-class CliffWalkingEnv : public Env<CliffWalkingEnvSpec> {
+template <typename RandomEngine>
+class BasicCliffWalkingEnv : public Env<CliffWalkingEnvSpec, RandomEngine> {
+  using Base = Env<CliffWalkingEnvSpec, RandomEngine>;
+  using Base::Allocate;
+
+ public:
+  using typename Base::Action;
+  using typename Base::Spec;
+  using typename Base::State;
+
  protected:
   int x_, y_;
   bool done_;
 
  public:
-  CliffWalkingEnv(const Spec& spec, int env_id)
-      : Env<CliffWalkingEnvSpec>(spec, env_id), done_(true) {}
+  BasicCliffWalkingEnv(const Spec& spec, int env_id)
+      : Base(spec, env_id), done_(true) {}
 
   bool IsDone() override { return done_; }
 
@@ -95,7 +105,9 @@ class CliffWalkingEnv : public Env<CliffWalkingEnvSpec> {
   }
 };
 
+using CliffWalkingEnv = BasicCliffWalkingEnv<std::mt19937>;
 using CliffWalkingEnvPool = AsyncEnvPool<CliffWalkingEnv>;
+using CliffWalkingPcg32EnvPool = AsyncEnvPool<BasicCliffWalkingEnv<Pcg32>>;
 
 }  // namespace toy_text
 
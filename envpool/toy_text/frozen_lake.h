@@ -26,6 +26,7 @@
 
 #include "envpool/core/async_envpool.h"
 #include "envpool/core/env.h"
+#include "envpool/utils/random.h"
 
 namespace toy_text {
 
@@ -48,28 +49,35 @@ class FrozenLakeEnvFns {
 
 using FrozenLakeEnvSpec = EnvSpec<FrozenLakeEnvFns>;
 
-class FrozenLakeEnv : public Env<FrozenLakeEnvSpec> {
+template <typename RandomEngine>
+class BasicFrozenLakeEnv : public Env<FrozenLakeEnvSpec, RandomEngine> {
+  using Base = Env<FrozenLakeEnvSpec, RandomEngine>;
+  using Base::Allocate;
+  using Base::gen_;
+
+ public:
+  using typename Base::Action;
+  using typename Base::Spec;
+  using typename Base::State;
+
  protected:
   int x_, y_, size_, max_episode_steps_, elapsed_step_;
   std::uniform_int_distribution<> dist_;
   bool done_;
-  std::vector<std::string> map_;
+  static constexpr const char* kMap4[4] = {"SFFF", "FHFH", "FFFH", "HFFG"};
+  static constexpr const char* kMap8[8] = {
+      "SFFFFFFF", "FFFFFFFF", "FFFHFFFF", "FFFFFHFF",
+      "FFFHFFFF", "FHHFFFHF", "FHFFHFHF", "FFFHFFFG"};
+  const char* const* map_;
 
  public:
-  FrozenLakeEnv(const Spec& spec, int env_id)
-      : Env<FrozenLakeEnvSpec>(spec, env_id),
+  BasicFrozenLakeEnv(const Spec& spec, int env_id)
+      : Base(spec, env_id),
         size_(spec.config["size"_]),
         max_episode_steps_(spec.config["max_episode_steps"_]),
         dist_(-1, 1),
-        done_(true) {
-    if (size_ != 8) {
-      map_ = std::vector<std::string>({"SFFF", "FHFH", "FFFH", "HFFG"});
-    } else {
-      map_ = std::vector<std::string>({"SFFFFFFF", "FFFFFFFF", "FFFHFFFF",
-                                       "FFFFFHFF", "FFFHFFFF", "FHHFFFHF",
-                                       "FHFFHFHF", "FFFHFFFG"});
-    }
-  }
+        done_(true),
+        map_(size_ != 8 ? kMap4 : kMap8) {}
 
   bool IsDone() override { return done_; }
 
@@ -111,7 +119,9 @@ class FrozenLakeEnv : public Env<FrozenLakeEnvSpec> {
   }
 };
 
+using FrozenLakeEnv = BasicFrozenLakeEnv<std::mt19937>;
 using FrozenLakeEnvPool = AsyncEnvPool<FrozenLakeEnv>;
+using FrozenLakePcg32EnvPool = AsyncEnvPool<BasicFrozenLakeEnv<Pcg32>>;
 
 }  // namespace toy_text
 
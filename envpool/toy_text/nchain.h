@@ -26,6 +26,7 @@
 
 #include "envpool/core/async_envpool.h"
 #include "envpool/core/env.h"
+#include "envpool/utils/random.h"
 
 namespace toy_text {
 
@@ -46,15 +47,25 @@ class NChainEnvFns {
 
 using NChainEnvSpec = EnvSpec<NChainEnvFns>;
 
-class NChainEnv : public Env<NChainEnvSpec> {
+template <typename RandomEngine>
+class BasicNChainEnv : public Env<NChainEnvSpec, RandomEngine> {
+  using Base = Env<NChainEnvSpec, RandomEngine>;
+  using Base::Allocate;
+  using Base::gen_;
+
+ public:
+  using typename Base::Action;
+  using typename Base::Spec;
+  using typename Base::State;
+
  protected:
   int s_, max_episode_steps_, elapsed_step_;
   std::uniform_real_distribution<> dist_;
   bool done_;
 
  public:
-  NChainEnv(const Spec& spec, int env_id)
-      : Env<NChainEnvSpec>(spec, env_id),
+  BasicNChainEnv(const Spec& spec, int env_id)
+      : Base(spec, env_id),
         max_episode_steps_(spec.config["max_episode_steps"_]),
         dist_(0, 1),
         done_(true) {}
@@ -94,7 +105,9 @@ class NChainEnv : public Env<NChainEnvSpec> {
   }
 };
 
+using NChainEnv = BasicNChainEnv<std::mt19937>;
 using NChainEnvPool = AsyncEnvPool<NChainEnv>;
+using NChainPcg32EnvPool = AsyncEnvPool<BasicNChainEnv<Pcg32>>;
 
 }  // namespace toy_text
 
@@ -26,6 +26,7 @@
 
 #include "envpool/core/async_envpool.h"
 #include "envpool/core/env.h"
+#include "envpool/utils/random.h"
 
 namespace toy_text {
 
@@ -47,24 +48,34 @@ class TaxiEnvFns {
 
 using TaxiEnvSpec = EnvSpec<TaxiEnvFns>;
 
-class TaxiEnv : public Env<TaxiEnvSpec> {
+template <typename RandomEngine>
+class BasicTaxiEnv : public Env<TaxiEnvSpec, RandomEngine> {
+  using Base = Env<TaxiEnvSpec, RandomEngine>;
+  using Base::Allocate;
+  using Base::gen_;
+
+ public:
+  using typename Base::Action;
+  using typename Base::Spec;
+  using typename Base::State;
+
  protected:
   int x_, y_, s_, t_, max_episode_steps_, elapsed_step_;
   std::uniform_int_distribution<> dist_car_, dist_loc_;
   bool done_;
-  std::vector<std::vector<int>> loc_;
-  std::vector<std::string> map_, loc_map_;
+  static constexpr int kLoc[4][2] = {{0, 0}, {0, 4}, {4, 0}, {4, 3}};
+  static constexpr const char* kMap[5] = {"|:|::|", "|:|::|", "|::::|",
+                                          "||:|:|", "||:|:|"};
+  static constexpr const char* kLocMap[5] = {"0   1", "     ", "     ",
+                                             "     ", "2  3 "};
 
  public:
-  TaxiEnv(const Spec& spec, int env_id)
-      : Env<TaxiEnvSpec>(spec, env_id),
+  BasicTaxiEnv(const Spec& spec, int env_id)
+      : Base(spec, env_id),
         max_episode_steps_(spec.config["max_episode_steps"_]),
         dist_car_(0, 3),
         dist_loc_(0, 4),
-        done_(true),
-        loc_({{0, 0}, {0, 4}, {4, 0}, {4, 3}}),
-        map_({"|:|::|", "|:|::|", "|::::|", "||:|:|", "||:|:|"}),
-        loc_map_({"0   1", "     ", "     ", "     ", "2  3 "}) {}
+        done_(true) {}
 
   bool IsDone() override { return done_; }
 
@@ -91,28 +102,28 @@ class TaxiEnv : public Env<TaxiEnvSpec> {
         --x_;
       }
     } else if (act == 2) {
-      if (map_[x_][y_ + 1] == ':') {
+      if (kMap[x_][y_ + 1] == ':') {
         ++y_;
       }
     } else if (act == 3) {
-      if (map_[x_][y_] == ':') {
+      if (kMap[x_][y_] == ':') {
         --y_;
       }
     } else if (act == 4) {
       // pick up
-      if (s_ < 4 && x_ == loc_[s_][0] && y_ == loc_[s_][1]) {
+      if (s_ < 4 && x_ == kLoc[s_][0] && y_ == kLoc[s_][1]) {
         s_ = 4;
       } else {
         reward = -10.0;
       }
     } else {
       // drop off
-      if (s_ == 4 && x_ == loc_[t_][0] && y_ == loc_[t_][1]) {
+      if (s_ == 4 && x_ == kLoc[t_][0] && y_ == kLoc[t_][1]) {
         s_ = t_;
         done_ = true;
         reward = 20.0;
-      } else if (s_ == 4 && loc_map_[x_][y_] != ' ') {
-        s_ = loc_map_[x_][y_] - '0';
+      } else if (s_ == 4 && kLocMap[x_][y_] != ' ') {
+        s_ = kLocMap[x_][y_] - '0';
       } else {
         reward = -10.0;
       }
@@ -128,7 +139,9 @@ class TaxiEnv : public Env<TaxiEnvSpec> {
   }
 };
 
+using TaxiEnv = BasicTaxiEnv<std::mt19937>;
 using TaxiEnvPool = AsyncEnvPool<TaxiEnv>;
+using TaxiPcg32EnvPool = AsyncEnvPool<BasicTaxiEnv<Pcg32>>;
 
 }  // namespace toy_text
 
@@ -0,0 +1,35 @@
+// Copyright 2022 Garena Online Private Limited
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <string>
+
+#include "envpool/core/workload.h"
+#include "envpool/toy_text/blackjack.h"
+#include "envpool/toy_text/frozen_lake.h"
+#include "envpool/toy_text/taxi.h"
+
+using toy_text::BlackjackEnvPool;
+using toy_text::FrozenLakeEnvPool;
+using toy_text::TaxiEnvPool;
+
+int main(int argc, char** argv) {
+  int num_steps = argc > 1 ? std::stoi(argv[1]) : 100000;
+  RunWorkload<TaxiEnvPool>("Taxi-v3", WorkloadConfig<TaxiEnvPool>(8),
+                           num_steps);
+  RunWorkload<FrozenLakeEnvPool>(
+      "FrozenLake-v1", WorkloadConfig<FrozenLakeEnvPool>(8), num_steps);
+  RunWorkload<BlackjackEnvPool>(
+      "Blackjack-v1", WorkloadConfig<BlackjackEnvPool>(8), num_steps);
+  return 0;
+}
@@ -0,0 +1,34 @@
+# Copyright 2022 Garena Online Private Limited
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+"""Advantage / return kernels over [T, B] rollouts, in C++.
+
+``compute_gae(value, reward, done, gamma, gae_lambda)`` returns
+``(advantage, target)`` and ``compute_nstep_return(value, reward, done,
+gamma, n)`` the n-step returns, all of shape ``[T, B]``. ``reward`` and
+``done`` are ``[T, B]``, ``value`` is ``[T + 1, B]`` with the value of the
+obs after the last step as its last row. They run on float32 (or float64)
+arrays without the GIL.
+
+``load_shard(path)`` maps a shard written with the ``trajectory_dir``
+config.
+"""
+
+from .returns_py import compute_gae, compute_nstep_return
+from .trajectory import load_shard
+
+__all__ = [
+  "compute_gae",
+  "compute_nstep_return",
+  "load_shard",
+]
@@ -0,0 +1,305 @@
+/*
+ * Copyright 2022 Garena Online Private Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ENVPOOL_UTILS_IMAGE_PIPELINE_H_
+#define ENVPOOL_UTILS_IMAGE_PIPELINE_H_
+
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+#include "envpool/core/allocator.h"
+#include "envpool/core/array.h"
+#include "envpool/utils/image_process.h"
+#include "envpool/utils/simd.h"
+
+/**
+ * Observation transform pipeline of a pixel env, which runs on the worker
+ * thread right before the state is written. It is declared once in the env
+ * constructor, e.g.,
+ *
+ *   ImagePipeline pipeline(210, 160, 3);
+ *   pipeline.GrayScale().Resize(84, 84).ChannelFirst().Stack(4);
+ *
+ * then each raw frame goes through `Push`, and `Write` copies the frame stack
+ * into the obs of the state. The scratch buffers of the stages are allocated
+ * when the pipeline is declared (from `Allocator::Current()`), and the last
+ * stage writes straight into the frame stack, so pushing a frame doesn't
+ * allocate or copy more than the transforms need.
+ *
+ * Frames are uint8, either interleaved (HWC) or planar (CHW, e.g., the
+ * ViZDoom screen buffer). Crop and resize work on both layouts, gray scale
+ * needs an HWC RGB frame.
+ */
+class ImagePipeline {
+ public:
+  enum class Layout { kHWC, kCHW };
+
+ protected:
+  enum class Op { kCrop, kGrayScale, kResize, kChannelFirst };
+  struct Stage {
+    Op op;
+    // input frame of this stage
+    int height, width, channel;
+    Layout layout;
+    // output frame size
+    int out_height, out_width;
+    // crop offset
+    int top, left;
+    // output buffer, empty for the last stage which writes to the stack
+    Array out;
+  };
+  std::vector<Stage> stages_;
+  // shape of the frame after the stages declared so far
+  int height_, width_, channel_;
+  Layout layout_;
+  bool use_inter_area_;
+  std::deque<Array> stack_;
+
+  static Array View(uint8_t* data, int height, int width, int channel) {
+    return {Spec<uint8_t>({height, width, channel}),
+            reinterpret_cast<char*>(data)};
+  }
+
+  void AddStage(Op op, int height, int width, int channel, int top = 0,
+                int left = 0) {
+    if (!stack_.empty()) {
+      throw std::logic_error("Stack should be the last stage of a pipeline.");
+    }
+    // the previous stage is no longer the last one, give it a buffer
+    if (!stages_.empty()) {
+      stages_.back().out = Array(Spec<uint8_t>({height_, width_, channel_}),
+                                 Allocator::Current());
+    }
+    stages_.push_back(Stage{op, height_, width_, channel_, layout_, height,
+                            width, top, left, Array()});
+    height_ = height;
+    width_ = width;
+    channel_ = channel;
+  }
+
+  static void Run(const Stage& stage, uint8_t* src, uint8_t* dst,
+                  bool use_inter_area) {
+    int h = stage.height;
+    int w = stage.width;
+    int c = stage.channel;
+    // a planar frame is processed as `c` single-channel images
+    bool planar = stage.layout == Layout::kCHW;
+    int planes = planar ? c : 1;
+    int plane_channel = planar ? 1 : c;
+    std::size_t src_plane = static_cast<std::size_t>(h) * w * plane_channel;
+    std::size_t dst_plane = static_cast<std::size_t>(stage.out_height) *
+                            stage.out_width * plane_channel;
+    switch (stage.op) {
+      case Op::kCrop:
+        for (int i = 0; i < planes; ++i) {
+          cv::Mat src_img(h, w, CV_8UC(plane_channel), src + i * src_plane);
+          cv::Mat dst_img(stage.out_height, stage.out_width,
+                          CV_8UC(plane_channel), dst + i * dst_plane);
+          src_img(cv::Rect(stage.left, stage.top, stage.out_width,
+                           stage.out_height))
+              .copyTo(dst_img);
+        }
+        break;
+      case Op::kGrayScale: {
+        Array tgt = View(dst, h, w, 1);
+        ::GrayScale(View(src, h, w, 3), &tgt);
+        break;
+      }
+      case Op::kResize:
+        for (int i = 0; i < planes; ++i) {
+          Array tgt = View(dst + i * dst_plane, stage.out_height,
+                           stage.out_width, plane_channel);
+          ::Resize(View(src + i * src_plane, h, w, plane_channel), &tgt,
+                   use_inter_area);
+        }
+        break;
+      case Op::kChannelFirst:
+        HWCToCHW(src, dst, static_cast<std::size_t>(h) * w, c);
+        break;
+    }
+  }
+
+ public:
+  ImagePipeline() : ImagePipeline(0, 0, 0) {}
+
+  /**
+   * A pipeline of `height x width x channel` raw frames in `layout`.
+   */
+  ImagePipeline(int height, int width, int channel,
+                Layout layout = Layout::kHWC)
+      : height_(height),
+        width_(width),
+        channel_(channel),
+        layout_(layout),
+        use_inter_area_(true) {}
+
+  /**
+   * Keep the `height x width` window whose top-left corner is (top, left).
+   */
+  ImagePipeline& Crop(int top, int left, int height, int width) {
+    if (top < 0 || left < 0 || height <= 0 || width <= 0 ||
+        top + height > height_ || left + width > width_) {
+      throw std::invalid_argument(
+          "Crop window is out of the " + std::to_string(height_) + "x" +
+          std::to_string(width_) + " frame.");
+    }
+    AddStage(Op::kCrop, height, width, channel_, top, left);
+    return *this;
+  }
+
+  /**
+   * RGB to a single channel.
+   */
+  ImagePipeline& GrayScale() {
+    if (layout_ != Layout::kHWC || channel_ != 3) {
+      throw std::invalid_argument("GrayScale needs an HWC RGB frame.");
+    }
+    AddStage(Op::kGrayScale, height_, width_, 1);
+    return *this;
+  }
+
+  /**
+   * Resize to `height x width`, with INTER_AREA or bilinear interpolation.
+   */
+  ImagePipeline& Resize(int height, int width, bool use_inter_area = true) {
+    use_inter_area_ = use_inter_area;
+    if (height != height_ || width != width_) {
+      AddStage(Op::kResize, height, width, channel_);
+    }
+    return *this;
+  }
+
+  /**
+   * Transpose HWC to CHW, which is a no-op for planar or single-channel
+   * frames.
+   */
+  ImagePipeline& ChannelFirst() {
+    if (layout_ == Layout::kHWC && channel_ > 1) {
+      AddStage(Op::kChannelFirst, height_, width_, channel_);
+    }
+    layout_ = Layout::kCHW;
+    return *this;
+  }
+
+  /**
+   * Keep the last `num` frames, which ends the pipeline. A pipeline without
+   * Stack keeps one frame.
+   */
+  ImagePipeline& Stack(int num) {
+    if (!stack_.empty()) {
+      throw std::logic_error("Stack is declared twice.");
+    }
+    for (int i = 0; i < num; ++i) {
+      stack_.emplace_back(Array(Spec<uint8_t>({height_, width_, channel_}),
+                                Allocator::Current()));
+    }
+    return *this;
+  }
+
+  /**
+   * Switch the interpolation of the resize stage, e.g., for a hot
+   * reconfiguration of `use_inter_area_resize`.
+   */
+  void SetInterArea(bool use_inter_area) { use_inter_area_ = use_inter_area; }
+
+  /**
+   * Transform `frame` and push it to the frame stack, dropping the oldest
+   * frame. With `fill`, the whole stack is set to this frame, e.g., at the
+   * start of an episode.
+   */
+  void Push(const Array& frame, bool fill = false) {
+    if (stack_.empty()) {
+      Stack(1);
+    }
+    Array tgt = std::move(stack_.front());
+    stack_.pop_front();
+    auto* dst = static_cast<uint8_t*>(tgt.Data());
+    auto* src = static_cast<uint8_t*>(frame.Data());
+    if (stages_.empty()) {
+      std::memcpy(dst, src, tgt.size);
+    }
+    for (std::size_t i = 0; i < stages_.size(); ++i) {
+      const Stage& stage = stages_[i];
+      auto* out = i + 1 == stages_.size()
+                      ? dst
+                      : static_cast<uint8_t*>(stage.out.Data());
+      Run(stage, src, out, use_inter_area_);
+      src = out;
+    }
+    stack_.push_back(std::move(tgt));
+    if (fill) {
+      for (auto& s : stack_) {
+        if (s.Data() != dst) {
+          std::memcpy(s.Data(), dst, s.size);
+        }
+      }
+    }
+  }
+
+  /**
+   * Copy the frame stack (oldest first) into `obs`, casting to `T` and
+   * multiplying by `scale` if `T` is not uint8, e.g., `Write<float>(obs,
+   * 1.0F / 255)`.
+   */
+  template <typename T = uint8_t>
+  void Write(const Array& obs, float scale = 1.0F) const {
+    DCHECK_EQ(obs.size, FrameSize() * stack_.size())
+        << " obs doesn't match the frame stack";
+    auto* ptr = static_cast<T*>(obs.Data());
+    for (const auto& frame : stack_) {
+      const auto* src = static_cast<const uint8_t*>(frame.Data());
+      if constexpr (std::is_same_v<T, uint8_t>) {
+        std::memcpy(ptr, src, frame.size);
+      } else {
+        for (std::size_t i = 0; i < frame.size; ++i) {
+          ptr[i] = static_cast<T>(src[i] * scale);
+        }
+      }
+      ptr += frame.size;
+    }
+  }
+
+  /**
+   * Shape of the stacked observation, i.e., (num * C, H, W) for a CHW frame
+   * and (num, H, W, C) for an HWC one.
+   */
+  [[nodiscard]] std::vector<int> Shape() const {
+    int num = static_cast<int>(stack_.empty() ? 1 : stack_.size());
+    if (layout_ == Layout::kCHW) {
+      return {num * channel_, height_, width_};
+    }
+    return {num, height_, width_, channel_};
+  }
+
+  [[nodiscard]] std::size_t FrameSize() const {
+    return static_cast<std::size_t>(height_) * width_ * channel_;
+  }
+
+  /**
+   * The stacked frames, oldest first, e.g., for Save / Load of an env.
+   */
+  std::deque<Array>& Frames() { return stack_; }
+};
+
+#endif  // ENVPOOL_UTILS_IMAGE_PIPELINE_H_
@@ -0,0 +1,100 @@
+// Copyright 2022 Garena Online Private Limited
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "envpool/utils/image_pipeline.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+TEST(ImagePipelineTest, CropChannelFirst) {
+  Array frame(Spec<uint8_t>({4, 6, 3}));
+  for (int i = 0; i < 4; ++i) {
+    for (int j = 0; j < 6; ++j) {
+      for (int k = 0; k < 3; ++k) {
+        frame(i, j, k) = static_cast<uint8_t>(i * 100 + j * 10 + k);
+      }
+    }
+  }
+  ImagePipeline pipeline(4, 6, 3);
+  pipeline.Crop(1, 2, 2, 3).ChannelFirst().Stack(2);
+  EXPECT_EQ(pipeline.Shape(), std::vector<int>({6, 2, 3}));
+  pipeline.Push(frame, true);
+  Array obs(Spec<uint8_t>({6, 2, 3}));
+  pipeline.Write(obs);
+  for (int s = 0; s < 2; ++s) {
+    for (int k = 0; k < 3; ++k) {
+      for (int i = 0; i < 2; ++i) {
+        for (int j = 0; j < 3; ++j) {
+          EXPECT_EQ(static_cast<uint8_t>(obs(s * 3 + k, i, j)),
+                    (i + 1) * 100 + (j + 2) * 10 + k);
+        }
+      }
+    }
+  }
+}
+
+TEST(ImagePipelineTest, GrayScaleResizeStack) {
+  Array frame(Spec<uint8_t>({8, 6, 3}));
+  ImagePipeline pipeline(8, 6, 3);
+  pipeline.GrayScale().Resize(4, 3).ChannelFirst().Stack(3);
+  EXPECT_EQ(pipeline.Shape(), std::vector<int>({3, 4, 3}));
+  EXPECT_EQ(pipeline.FrameSize(), 12U);
+  // a gray image stays the same through gray scale and resize
+  frame.Fill(static_cast<uint8_t>(100));
+  pipeline.Push(frame, true);
+  frame.Fill(static_cast<uint8_t>(50));
+  pipeline.Push(frame);
+  Array obs(Spec<uint8_t>({3, 4, 3}));
+  pipeline.Write(obs);
+  EXPECT_EQ(static_cast<uint8_t>(obs(0, 0, 0)), 100);
+  EXPECT_EQ(static_cast<uint8_t>(obs(1, 3, 2)), 100);
+  EXPECT_EQ(static_cast<uint8_t>(obs(2, 0, 0)), 50);
+  EXPECT_EQ(static_cast<uint8_t>(obs(2, 3, 2)), 50);
+  // dtype cast
+  Array obs_float(Spec<float>({3, 4, 3}));
+  pipeline.Write<float>(obs_float, 1.0F / 255);
+  EXPECT_FLOAT_EQ(static_cast<float>(obs_float(0, 1, 1)), 100.0F / 255);
+  EXPECT_FLOAT_EQ(static_cast<float>(obs_float(2, 1, 1)), 50.0F / 255);
+}
+
+TEST(ImagePipelineTest, Planar) {
+  // two planes, e.g., a channel-first screen buffer
+  std::vector<uint8_t> screen(2 * 6 * 4);
+  for (std::size_t i = 0; i < screen.size(); ++i) {
+    screen[i] = i < screen.size() / 2 ? 1 : 2;
+  }
+  Array frame(Spec<uint8_t>({2, 6, 4}), reinterpret_cast<char*>(screen.data()));
+  ImagePipeline pipeline(6, 4, 2, ImagePipeline::Layout::kCHW);
+  pipeline.Crop(0, 0, 6, 2).Resize(3, 2).Stack(1);
+  EXPECT_EQ(pipeline.Shape(), std::vector<int>({2, 3, 2}));
+  pipeline.Push(frame);
+  Array obs(Spec<uint8_t>({2, 3, 2}));
+  pipeline.Write(obs);
+  EXPECT_EQ(static_cast<uint8_t>(obs(0, 2, 1)), 1);
+  EXPECT_EQ(static_cast<uint8_t>(obs(1, 0, 0)), 2);
+  EXPECT_EQ(static_cast<uint8_t>(obs(1, 2, 1)), 2);
+}
+
+TEST(ImagePipelineTest, Invalid) {
+  ImagePipeline pipeline(4, 4, 3);
+  EXPECT_THROW(pipeline.Crop(2, 0, 3, 4), std::invalid_argument);
+  pipeline.ChannelFirst();
+  EXPECT_THROW(pipeline.GrayScale(), std::invalid_argument);
+  pipeline.Stack(2);
+  EXPECT_THROW(pipeline.Resize(2, 2), std::logic_error);
+  EXPECT_THROW(pipeline.Stack(2), std::logic_error);
+}
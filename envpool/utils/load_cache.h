@@ -0,0 +1,76 @@
+/*
+ * Copyright 2022 Garena Online Private Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ENVPOOL_UTILS_LOAD_CACHE_H_
+#define ENVPOOL_UTILS_LOAD_CACHE_H_
+
+#include <exception>
+#include <future>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+/**
+ * Cache of an expensive load per key, e.g., the action set of an Atari rom
+ * or the buttons of a ViZDoom cfg, which every spec construction asks for.
+ * Only the map is locked: the first caller of a key runs the load outside
+ * the lock, the other callers of that key wait for its shared_future, and
+ * the callers of other keys are not blocked. A failed load is rethrown to
+ * the callers waiting for it and not cached, so the next call retries.
+ */
+template <typename T>
+class LoadCache {
+ protected:
+  std::mutex mutex_;
+  std::unordered_map<std::string, std::shared_future<T>> cache_;
+
+ public:
+  /**
+   * The value of `key`, loaded with `load()` on the first call. The
+   * reference stays valid for the lifetime of the cache.
+   */
+  template <typename F>
+  const T& Get(const std::string& key, F&& load) {
+    std::promise<T> promise;
+    std::shared_future<T> future;
+    bool owner = false;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      auto it = cache_.find(key);
+      if (it == cache_.end()) {
+        future = promise.get_future().share();
+        cache_.emplace(key, future);
+        owner = true;
+      } else {
+        future = it->second;
+      }
+    }
+    if (owner) {
+      try {
+        promise.set_value(load());
+      } catch (...) {
+        {
+          std::lock_guard<std::mutex> lock(mutex_);
+          cache_.erase(key);
+        }
+        promise.set_exception(std::current_exception());
+      }
+    }
+    return future.get();
+  }
+};
+
+#endif  // ENVPOOL_UTILS_LOAD_CACHE_H_
@@ -0,0 +1,78 @@
+// Copyright 2022 Garena Online Private Limited
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "envpool/utils/load_cache.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+TEST(LoadCacheTest, LoadOnce) {
+  LoadCache<int> cache;
+  std::atomic<int> num_load{0};
+  auto load = [&] {
+    ++num_load;
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    return 42;
+  };
+  std::vector<std::thread> threads;
+  std::vector<int> result(8);
+  for (int i = 0; i < 8; ++i) {
+    threads.emplace_back([&, i] { result[i] = cache.Get("pong", load); });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  EXPECT_EQ(num_load, 1);
+  for (int r : result) {
+    EXPECT_EQ(r, 42);
+  }
+  EXPECT_EQ(&cache.Get("pong", load), &cache.Get("pong", load));
+  EXPECT_EQ(num_load, 1);
+}
+
+TEST(LoadCacheTest, OtherKeysNotBlocked) {
+  LoadCache<int> cache;
+  std::atomic<bool> release{false};
+  std::thread slow([&] {
+    cache.Get("slow", [&] {
+      while (!release) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+      return 1;
+    });
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  // returns while the load of "slow" is still running
+  EXPECT_EQ(cache.Get("fast", [] { return 2; }), 2);
+  release = true;
+  slow.join();
+  EXPECT_EQ(cache.Get("slow", [] { return 3; }), 1);
+}
+
+TEST(LoadCacheTest, FailureNotCached) {
+  LoadCache<std::string> cache;
+  EXPECT_THROW(cache.Get("missing",
+                         []() -> std::string {
+                           throw std::runtime_error("no such file");
+                         }),
+               std::runtime_error);
+  EXPECT_EQ(cache.Get("missing", [] { return std::string("found"); }),
+            "found");
+}
@@ -0,0 +1,77 @@
+/*
+ * Copyright 2022 Garena Online Private Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ENVPOOL_UTILS_RANDOM_H_
+#define ENVPOOL_UTILS_RANDOM_H_
+
+#include <cstdint>
+#include <istream>
+#include <limits>
+#include <ostream>
+
+/**
+ * PCG32 random engine (single stream, XSH-RR output), see
+ * https://www.pcg-random.org. It only holds 8 bytes of state versus ~5 KB of
+ * std::mt19937, and can be used as the `RandomEngine` of `Env` for tiny envs
+ * (e.g., toy_text) that are created by the million. It satisfies
+ * UniformRandomBitGenerator, so it works with the std distributions.
+ */
+class Pcg32 {
+ protected:
+  static constexpr uint64_t kMultiplier = 6364136223846793005ULL;
+  static constexpr uint64_t kIncrement = 1442695040888963407ULL;
+  uint64_t state_;
+
+ public:
+  using result_type = uint32_t;  // NOLINT
+
+  explicit Pcg32(uint64_t seed = 0) { this->seed(seed); }
+
+  void seed(uint64_t seed) {  // NOLINT
+    state_ = 0;
+    (*this)();
+    state_ += seed;
+    (*this)();
+  }
+
+  result_type operator()() {
+    uint64_t old_state = state_;
+    state_ = old_state * kMultiplier + kIncrement;
+    auto xorshifted =
+        static_cast<uint32_t>(((old_state >> 18U) ^ old_state) >> 27U);
+    auto rot = static_cast<uint32_t>(old_state >> 59U);
+    return (xorshifted >> rot) | (xorshifted << ((-rot) & 31U));
+  }
+
+  static constexpr result_type min() {  // NOLINT
+    return std::numeric_limits<result_type>::min();
+  }
+  static constexpr result_type max() {  // NOLINT
+    return std::numeric_limits<result_type>::max();
+  }
+
+  bool operator==(const Pcg32& other) const { return state_ == other.state_; }
+  bool operator!=(const Pcg32& other) const { return state_ != other.state_; }
+
+  friend std::ostream& operator<<(std::ostream& os, const Pcg32& rng) {
+    return os << rng.state_;
+  }
+  friend std::istream& operator>>(std::istream& is, Pcg32& rng) {
+    return is >> rng.state_;
+  }
+};
+
+#endif  // ENVPOOL_UTILS_RANDOM_H_
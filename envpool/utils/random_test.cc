@@ -0,0 +1,67 @@
+// Copyright 2022 Garena Online Private Limited
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "envpool/utils/random.h"
+
+#include <gtest/gtest.h>
+
+#include <random>
+#include <sstream>
+#include <vector>
+
+TEST(RandomTest, Pcg32) {
+  EXPECT_EQ(sizeof(Pcg32), 8);
+  Pcg32 a(42);
+  Pcg32 b(42);
+  Pcg32 c(43);
+  std::vector<uint32_t> seq;
+  bool same_as_c = true;
+  for (int i = 0; i < 100; ++i) {
+    seq.push_back(a());
+    EXPECT_EQ(seq.back(), b());
+    same_as_c &= seq.back() == c();
+  }
+  EXPECT_FALSE(same_as_c);
+  // reseed restarts the sequence
+  a.seed(42);
+  for (int i = 0; i < 100; ++i) {
+    EXPECT_EQ(a(), seq[i]);
+  }
+  // text round trip, as used by env snapshots
+  std::stringstream ss;
+  ss << a;
+  Pcg32 d;
+  ss >> d;
+  EXPECT_EQ(a, d);
+  EXPECT_EQ(a(), d());
+}
+
+TEST(RandomTest, Pcg32Distribution) {
+  Pcg32 gen(0);
+  std::uniform_int_distribution<> dist(0, 3);
+  std::vector<int> count(4);
+  int n = 40000;
+  for (int i = 0; i < n; ++i) {
+    ++count[dist(gen)];
+  }
+  for (int c : count) {
+    EXPECT_NEAR(c, n / 4, n / 40);
+  }
+  std::uniform_real_distribution<> real(0, 1);
+  double sum = 0;
+  for (int i = 0; i < n; ++i) {
+    sum += real(gen);
+  }
+  EXPECT_NEAR(sum / n, 0.5, 0.01);
+}
@@ -0,0 +1,106 @@
+/*
+ * Copyright 2022 Garena Online Private Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ENVPOOL_UTILS_RETURNS_H_
+#define ENVPOOL_UTILS_RETURNS_H_
+
+#include <cstddef>
+#include <vector>
+
+/**
+ * Advantage and return kernels over a [T, B] rollout, e.g., the one of the
+ * `rollout_len` config, stored row by row. Column b is the trajectory of one
+ * env, which AsyncEnvPool::Rollout checks; an async-mode rollout has to be
+ * reordered by info:env_id first. `value[t]` is the value of the obs that
+ * the action of step t was chosen from, and `reward[t]` / `done[t]` are what
+ * that action got back.
+ * `value` has one more row, the value of the obs after the last step, to
+ * bootstrap from. `done[t]` cuts the trace after step t.
+ *
+ * The recursions run over t, and each step is a loop over the contiguous
+ * batch dimension, which the compiler vectorizes.
+ */
+
+/**
+ * Generalized advantage estimation:
+ *   delta[t] = reward[t] + gamma * value[t + 1] * !done[t] - value[t]
+ *   adv[t] = delta[t] + gamma * lambda * !done[t] * adv[t + 1]
+ *   target[t] = adv[t] + value[t]
+ */
+template <typename T>
+void ComputeGae(std::size_t num_step, std::size_t batch, T gamma, T lambda,
+                const T* value, const T* reward, const bool* done, T* adv,
+                T* target) {
+  for (std::size_t t = num_step; t-- > 0;) {
+    const T* v = value + t * batch;
+    const T* v_next = v + batch;
+    const T* r = reward + t * batch;
+    const bool* d = done + t * batch;
+    T* a = adv + t * batch;
+    T* y = target + t * batch;
+    if (t + 1 == num_step) {
+      for (std::size_t b = 0; b < batch; ++b) {
+        T alive = d[b] ? T(0) : T(1);
+        a[b] = r[b] + gamma * v_next[b] * alive - v[b];
+        y[b] = a[b] + v[b];
+      }
+    } else {
+      const T* a_next = a + batch;
+      for (std::size_t b = 0; b < batch; ++b) {
+        T alive = d[b] ? T(0) : T(1);
+        T delta = r[b] + gamma * v_next[b] * alive - v[b];
+        a[b] = delta + gamma * lambda * alive * a_next[b];
+        y[b] = a[b] + v[b];
+      }
+    }
+  }
+}
+
+/**
+ * n-step return:
+ *   ret[t] = sum_{k < m} gamma^k * reward[t + k] + gamma^m * value[t + m]
+ * with m = min(n, num_step - t), where the sum stops at the first done and
+ * then nothing is bootstrapped.
+ */
+template <typename T>
+void ComputeNStepReturn(std::size_t num_step, std::size_t batch,
+                        std::size_t n, T gamma, const T* value,
+                        const T* reward, const bool* done, T* ret) {
+  // discount of the next term of each column, 0 after a done
+  std::vector<T> scale(batch);
+  for (std::size_t t = 0; t < num_step; ++t) {
+    T* g = ret + t * batch;
+    for (std::size_t b = 0; b < batch; ++b) {
+      g[b] = 0;
+      scale[b] = 1;
+    }
+    std::size_t end = t + n < num_step ? t + n : num_step;
+    for (std::size_t k = t; k < end; ++k) {
+      const T* r = reward + k * batch;
+      const bool* d = done + k * batch;
+      for (std::size_t b = 0; b < batch; ++b) {
+        g[b] += scale[b] * r[b];
+        scale[b] *= d[b] ? T(0) : gamma;
+      }
+    }
+    const T* v = value + end * batch;
+    for (std::size_t b = 0; b < batch; ++b) {
+      g[b] += scale[b] * v[b];
+    }
+  }
+}
+
+#endif  // ENVPOOL_UTILS_RETURNS_H_
@@ -0,0 +1,97 @@
+// Copyright 2022 Garena Online Private Limited
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <pybind11/numpy.h>
+#include <pybind11/pybind11.h>
+
+#include <stdexcept>
+#include <string>
+#include <tuple>
+
+#include "envpool/utils/returns.h"
+
+namespace py = pybind11;
+
+template <typename T>
+using Input = py::array_t<T, py::array::c_style | py::array::forcecast>;
+using Done = py::array_t<bool, py::array::c_style | py::array::forcecast>;
+
+// check that value is [T + 1, B] and reward / done are [T, B]
+static std::tuple<std::size_t, std::size_t> CheckShape(const py::array& value,
+                                                       const py::array& reward,
+                                                       const py::array& done) {
+  if (reward.ndim() != 2 || done.ndim() != 2 || value.ndim() != 2) {
+    throw std::invalid_argument("value, reward and done should be 2-D.");
+  }
+  std::size_t num_step = reward.shape(0);
+  std::size_t batch = reward.shape(1);
+  if (static_cast<std::size_t>(done.shape(0)) != num_step ||
+      static_cast<std::size_t>(done.shape(1)) != batch ||
+      static_cast<std::size_t>(value.shape(0)) != num_step + 1 ||
+      static_cast<std::size_t>(value.shape(1)) != batch) {
+    throw std::invalid_argument(
+        "Expect reward and done of shape [T, B] and value of shape "
+        "[T + 1, B], got T = " +
+        std::to_string(num_step) + ", B = " + std::to_string(batch));
+  }
+  return {num_step, batch};
+}
+
+template <typename T>
+std::tuple<py::array_t<T>, py::array_t<T>> PyComputeGae(
+    const Input<T>& value, const Input<T>& reward, const Done& done, T gamma,
+    T lambda) {
+  auto [num_step, batch] = CheckShape(value, reward, done);
+  py::array_t<T> adv({num_step, batch});
+  py::array_t<T> target({num_step, batch});
+  {
+    py::gil_scoped_release release;
+    ComputeGae(num_step, batch, gamma, lambda, value.data(), reward.data(),
+               done.data(), adv.mutable_data(), target.mutable_data());
+  }
+  return {adv, target};
+}
+
+template <typename T>
+py::array_t<T> PyComputeNStepReturn(const Input<T>& value,
+                                    const Input<T>& reward, const Done& done,
+                                    T gamma, std::size_t n) {
+  auto [num_step, batch] = CheckShape(value, reward, done);
+  if (n == 0) {
+    throw std::invalid_argument("n should be positive.");
+  }
+  py::array_t<T> ret({num_step, batch});
+  {
+    py::gil_scoped_release release;
+    ComputeNStepReturn(num_step, batch, n, gamma, value.data(), reward.data(),
+                       done.data(), ret.mutable_data());
+  }
+  return ret;
+}
+
+PYBIND11_MODULE(returns_py, m) {
+  // float32 first, so that other dtypes are converted to it
+  m.def("compute_gae", &PyComputeGae<float>, py::arg("value"),
+        py::arg("reward"), py::arg("done"), py::arg("gamma"),
+        py::arg("gae_lambda"));
+  m.def("compute_gae", &PyComputeGae<double>, py::arg("value").noconvert(),
+        py::arg("reward").noconvert(), py::arg("done"), py::arg("gamma"),
+        py::arg("gae_lambda"));
+  m.def("compute_nstep_return", &PyComputeNStepReturn<float>,
+        py::arg("value"), py::arg("reward"), py::arg("done"),
+        py::arg("gamma"), py::arg("n"));
+  m.def("compute_nstep_return", &PyComputeNStepReturn<double>,
+        py::arg("value").noconvert(), py::arg("reward").noconvert(),
+        py::arg("done"), py::arg("gamma"), py::arg("n"));
+}
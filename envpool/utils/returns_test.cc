@@ -0,0 +1,111 @@
+// Copyright 2022 Garena Online Private Limited
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "envpool/utils/returns.h"
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <random>
+#include <vector>
+
+// same episodes as examples/ppo_atari/gae.py, in column 0; column 1 has the
+// rewards shifted by 10 and never ends
+TEST(ReturnsTest, Episodic) {
+  std::size_t num_step = 8;
+  std::size_t batch = 2;
+  std::vector<float> value((num_step + 1) * batch, 0.0F);
+  std::vector<float> reward(num_step * batch);
+  std::unique_ptr<bool[]> done(new bool[num_step * batch]);  // NOLINT
+  bool episode_end[] = {true, false, false, true, false, true, false, true};
+  for (std::size_t t = 0; t < num_step; ++t) {
+    reward[t * batch] = static_cast<float>(t);
+    reward[t * batch + 1] = 10.0F;
+    done[t * batch] = episode_end[t];
+    done[t * batch + 1] = false;
+  }
+  float expect[] = {0, 1.23, 2.3, 3, 4.5, 5, 6.7, 7};
+  std::vector<float> adv(num_step * batch);
+  std::vector<float> target(num_step * batch);
+  ComputeGae(num_step, batch, 0.1F, 1.0F, value.data(), reward.data(),
+             done.get(), adv.data(), target.data());
+  std::vector<float> ret(num_step * batch);
+  ComputeNStepReturn(num_step, batch, num_step, 0.1F, value.data(),
+                     reward.data(), done.get(), ret.data());
+  for (std::size_t t = 0; t < num_step; ++t) {
+    EXPECT_NEAR(adv[t * batch], expect[t], 1e-5);
+    EXPECT_NEAR(target[t * batch], expect[t], 1e-5);
+    EXPECT_NEAR(ret[t * batch], expect[t], 1e-5);
+  }
+  // 10 * (1 + 0.1 + 0.01)
+  EXPECT_NEAR(ret[5 * batch + 1], 11.1, 1e-5);
+}
+
+TEST(ReturnsTest, Random) {
+  std::size_t num_step = 64;
+  std::size_t batch = 5;
+  double gamma = 0.9;
+  double lambda = 0.8;
+  std::mt19937 gen(0);
+  std::uniform_real_distribution<double> dist(-1.0, 1.0);
+  std::vector<double> value((num_step + 1) * batch);
+  std::vector<double> reward(num_step * batch);
+  std::unique_ptr<bool[]> done(new bool[num_step * batch]);  // NOLINT
+  for (auto& v : value) {
+    v = dist(gen);
+  }
+  for (std::size_t i = 0; i < num_step * batch; ++i) {
+    reward[i] = dist(gen);
+    done[i] = dist(gen) > 0.8;
+  }
+  std::vector<double> adv(num_step * batch);
+  std::vector<double> target(num_step * batch);
+  ComputeGae(num_step, batch, gamma, lambda, value.data(), reward.data(),
+             done.get(), adv.data(), target.data());
+  for (std::size_t n : {1, 3, 100}) {
+    std::vector<double> ret(num_step * batch);
+    ComputeNStepReturn(num_step, batch, n, gamma, value.data(),
+                       reward.data(), done.get(), ret.data());
+    for (std::size_t b = 0; b < batch; ++b) {
+      for (std::size_t t = 0; t < num_step; ++t) {
+        // plain forward sum of one column
+        double g = 0.0;
+        double discount = 1.0;
+        std::size_t k = t;
+        for (; k < num_step && k < t + n; ++k) {
+          g += discount * reward[k * batch + b];
+          if (done[k * batch + b]) {
+            discount = 0.0;
+            break;
+          }
+          discount *= gamma;
+        }
+        if (discount > 0.0) {
+          g += discount * value[k * batch + b];
+        }
+        EXPECT_NEAR(ret[t * batch + b], g, 1e-9);
+      }
+    }
+  }
+  // GAE with lambda = 1 is the Monte Carlo advantage
+  ComputeGae(num_step, batch, gamma, 1.0, value.data(), reward.data(),
+             done.get(), adv.data(), target.data());
+  std::vector<double> ret(num_step * batch);
+  ComputeNStepReturn(num_step, batch, num_step, gamma, value.data(),
+                     reward.data(), done.get(), ret.data());
+  for (std::size_t i = 0; i < num_step * batch; ++i) {
+    EXPECT_NEAR(target[i], ret[i], 1e-9);
+    EXPECT_NEAR(adv[i], ret[i] - value[i], 1e-9);
+  }
+}
@@ -0,0 +1,378 @@
+/*
+ * Copyright 2022 Garena Online Private Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ENVPOOL_UTILS_SIMD_H_
+#define ENVPOOL_UTILS_SIMD_H_
+
+#if defined(__x86_64__) || defined(__i386__)
+#define ENVPOOL_SIMD_X86
+#include <immintrin.h>
+#endif
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+/**
+ * Runtime CPU-feature dispatch for the hot loops on observations: the frame
+ * kernels and the float64 casts of `obs_dtype`.
+ *
+ * The wheels target the generic x86-64 baseline, so each kernel is also
+ * compiled with `__attribute__((target(...)))` for the newer ISA levels and
+ * the best one supported by the host is picked at the first call. The
+ * environment variable `ENVPOOL_SIMD` (scalar / ssse3 / avx2 / avx512) caps
+ * the level, e.g., for benchmarking. Non-x86 hosts always use the scalar
+ * kernels.
+ */
+enum class SimdLevel : int { kScalar = 0, kSsse3, kAvx2, kAvx512 };
+
+inline const char* SimdLevelName(SimdLevel level) {
+  static const char* const kNames[] = {"scalar", "ssse3", "avx2", "avx512"};
+  return kNames[static_cast<int>(level)];
+}
+
+/**
+ * The highest level supported by both the CPU and the OS. The AVX2 and
+ * AVX-512 levels also need F16C for the float16 cast, which all the CPUs
+ * with AVX2 have.
+ */
+inline SimdLevel DetectSimdLevel() {
+#ifdef ENVPOOL_SIMD_X86
+  __builtin_cpu_init();
+  bool f16c = __builtin_cpu_supports("f16c");
+  if (f16c && __builtin_cpu_supports("avx512bw")) {
+    return SimdLevel::kAvx512;
+  }
+  if (f16c && __builtin_cpu_supports("avx2")) {
+    return SimdLevel::kAvx2;
+  }
+  if (__builtin_cpu_supports("ssse3")) {
+    return SimdLevel::kSsse3;
+  }
+#endif
+  return SimdLevel::kScalar;
+}
+
+/**
+ * IEEE half precision bits of `value`, rounded to nearest even.
+ */
+inline uint16_t FloatToHalf(float value) {
+  uint32_t x;
+  std::memcpy(&x, &value, sizeof(x));
+  auto sign = static_cast<uint16_t>((x >> 16) & 0x8000U);
+  uint32_t abs = x & 0x7FFFFFFFU;
+  if (abs >= 0x7F800000U) {  // inf or nan
+    return sign | 0x7C00U | (abs > 0x7F800000U ? 0x200U : 0U);
+  }
+  if (abs >= 0x477FF000U) {  // rounds to 65520 or more
+    return sign | 0x7C00U;
+  }
+  if (abs < 0x38800000U) {  // below 2^-14, a subnormal half
+    if (abs < 0x33000000U) {  // at most 2^-25, rounds to zero
+      return sign;
+    }
+    uint32_t shift = 126 - (abs >> 23);
+    uint32_t mant = (abs & 0x7FFFFFU) | 0x800000U;
+    uint32_t h = mant >> shift;
+    uint32_t rem = mant & ((1U << shift) - 1);
+    uint32_t halfway = 1U << (shift - 1);
+    h += static_cast<uint32_t>(rem > halfway || (rem == halfway && (h & 1U)));
+    return sign | static_cast<uint16_t>(h);
+  }
+  // rebias the exponent from 127 to 15
+  uint32_t h = (abs - 0x38000000U) >> 13;
+  uint32_t rem = abs & 0x1FFFU;
+  h += static_cast<uint32_t>(rem > 0x1000U || (rem == 0x1000U && (h & 1U)));
+  return sign | static_cast<uint16_t>(h);
+}
+
+/**
+ * Bfloat16 bits of `value`, rounded to nearest even.
+ */
+inline uint16_t FloatToBFloat16(float value) {
+  uint32_t x;
+  std::memcpy(&x, &value, sizeof(x));
+  if ((x & 0x7FFFFFFFU) > 0x7F800000U) {  // keep nan a (quiet) nan
+    return static_cast<uint16_t>((x >> 16) | 0x40U);
+  }
+  x += 0x7FFFU + ((x >> 16) & 1U);
+  return static_cast<uint16_t>(x >> 16);
+}
+
+namespace simd {
+
+using MaxFn = void (*)(uint8_t*, const uint8_t*, std::size_t);
+using TransposeFn = void (*)(const uint8_t*, uint8_t*, std::size_t,
+                             std::size_t);
+using ToFloat32Fn = void (*)(const double*, float*, std::size_t);
+using ToUint16Fn = void (*)(const double*, uint16_t*, std::size_t);
+
+struct Kernels {
+  SimdLevel level;
+  MaxFn max;
+  TransposeFn hwc_to_chw;
+  ToFloat32Fn to_float32;
+  ToUint16Fn to_float16;
+  ToUint16Fn to_bfloat16;
+};
+
+inline void MaxScalar(uint8_t* dst, const uint8_t* src, std::size_t size) {
+  for (std::size_t i = 0; i < size; ++i) {
+    dst[i] = std::max(dst[i], src[i]);
+  }
+}
+
+inline void HWCToCHWScalar(const uint8_t* src, uint8_t* dst, std::size_t hw,
+                           std::size_t channel) {
+  for (std::size_t p = 0; p < hw; ++p) {
+    for (std::size_t c = 0; c < channel; ++c) {
+      dst[c * hw + p] = src[p * channel + c];
+    }
+  }
+}
+
+inline void ToFloat32Scalar(const double* src, float* dst, std::size_t size) {
+  for (std::size_t i = 0; i < size; ++i) {
+    dst[i] = static_cast<float>(src[i]);
+  }
+}
+
+// float16 goes through float32, like the hardware conversion
+inline void ToFloat16Scalar(const double* src, uint16_t* dst,
+                            std::size_t size) {
+  for (std::size_t i = 0; i < size; ++i) {
+    dst[i] = FloatToHalf(static_cast<float>(src[i]));
+  }
+}
+
+inline void ToBFloat16Scalar(const double* src, uint16_t* dst,
+                             std::size_t size) {
+  for (std::size_t i = 0; i < size; ++i) {
+    dst[i] = FloatToBFloat16(static_cast<float>(src[i]));
+  }
+}
+
+#ifdef ENVPOOL_SIMD_X86
+
+/**
+ * pshufb masks that gather channel c of 16 RGB pixels from the 3 input
+ * vectors: kRgbMasks[c * 3 + v] picks the bytes of vector v, -128 elsewhere.
+ */
+constexpr std::array<std::array<int8_t, 16>, 9> MakeRgbMasks() {
+  std::array<std::array<int8_t, 16>, 9> masks{};
+  for (int c = 0; c < 3; ++c) {
+    for (int v = 0; v < 3; ++v) {
+      for (int p = 0; p < 16; ++p) {
+        int index = 3 * p + c;
+        masks[c * 3 + v][p] =
+            static_cast<int8_t>(index / 16 == v ? index % 16 : -128);
+      }
+    }
+  }
+  return masks;
+}
+
+inline constexpr auto kRgbMasks = MakeRgbMasks();
+
+__attribute__((target("ssse3"))) inline void HWCToCHWSsse3(
+    const uint8_t* src, uint8_t* dst, std::size_t hw, std::size_t channel) {
+  if (channel != 3) {
+    HWCToCHWScalar(src, dst, hw, channel);
+    return;
+  }
+  __m128i masks[9];
+  for (int i = 0; i < 9; ++i) {
+    masks[i] = _mm_loadu_si128(
+        reinterpret_cast<const __m128i*>(kRgbMasks[i].data()));
+  }
+  std::size_t p = 0;
+  for (; p + 16 <= hw; p += 16) {
+    const auto* in = reinterpret_cast<const __m128i*>(src + p * 3);
+    __m128i v[3] = {_mm_loadu_si128(in), _mm_loadu_si128(in + 1),
+                    _mm_loadu_si128(in + 2)};
+    for (int c = 0; c < 3; ++c) {
+      __m128i out = _mm_or_si128(
+          _mm_or_si128(_mm_shuffle_epi8(v[0], masks[c * 3]),
+                       _mm_shuffle_epi8(v[1], masks[c * 3 + 1])),
+          _mm_shuffle_epi8(v[2], masks[c * 3 + 2]));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + c * hw + p), out);
+    }
+  }
+  for (; p < hw; ++p) {
+    for (std::size_t c = 0; c < 3; ++c) {
+      dst[c * hw + p] = src[p * 3 + c];
+    }
+  }
+}
+
+__attribute__((target("sse2"))) inline void MaxSse2(uint8_t* dst,
+                                                    const uint8_t* src,
+                                                    std::size_t size) {
+  std::size_t i = 0;
+  for (; i + 16 <= size; i += 16) {
+    auto* d = reinterpret_cast<__m128i*>(dst + i);
+    auto s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+    _mm_storeu_si128(d, _mm_max_epu8(_mm_loadu_si128(d), s));
+  }
+  MaxScalar(dst + i, src + i, size - i);
+}
+
+__attribute__((target("avx2"))) inline void MaxAvx2(uint8_t* dst,
+                                                    const uint8_t* src,
+                                                    std::size_t size) {
+  std::size_t i = 0;
+  for (; i + 32 <= size; i += 32) {
+    auto* d = reinterpret_cast<__m256i*>(dst + i);
+    auto s = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+    _mm256_storeu_si256(d, _mm256_max_epu8(_mm256_loadu_si256(d), s));
+  }
+  MaxScalar(dst + i, src + i, size - i);
+}
+
+__attribute__((target("avx512f,avx512bw"))) inline void MaxAvx512(
+    uint8_t* dst, const uint8_t* src, std::size_t size) {
+  std::size_t i = 0;
+  for (; i + 64 <= size; i += 64) {
+    auto d = _mm512_loadu_si512(dst + i);
+    auto s = _mm512_loadu_si512(src + i);
+    _mm512_storeu_si512(dst + i, _mm512_max_epu8(d, s));
+  }
+  MaxScalar(dst + i, src + i, size - i);
+}
+
+__attribute__((target("avx2"))) inline void ToFloat32Avx2(const double* src,
+                                                          float* dst,
+                                                          std::size_t size) {
+  std::size_t i = 0;
+  for (; i + 4 <= size; i += 4) {
+    _mm_storeu_ps(dst + i, _mm256_cvtpd_ps(_mm256_loadu_pd(src + i)));
+  }
+  ToFloat32Scalar(src + i, dst + i, size - i);
+}
+
+__attribute__((target("avx2,f16c"))) inline void ToFloat16Avx2(
+    const double* src, uint16_t* dst, std::size_t size) {
+  std::size_t i = 0;
+  for (; i + 4 <= size; i += 4) {
+    __m128 f = _mm256_cvtpd_ps(_mm256_loadu_pd(src + i));
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(dst + i),
+                     _mm_cvtps_ph(f, _MM_FROUND_TO_NEAREST_INT));
+  }
+  ToFloat16Scalar(src + i, dst + i, size - i);
+}
+
+/**
+ * FloatToBFloat16 on 8 floats at a time: add 0x7FFF plus the lowest kept bit
+ * to round to nearest even, or set the quiet bit of a nan, then keep the
+ * upper 16 bits.
+ */
+__attribute__((target("avx2"))) inline void ToBFloat16Avx2(const double* src,
+                                                           uint16_t* dst,
+                                                           std::size_t size) {
+  const __m256i abs_mask = _mm256_set1_epi32(0x7FFFFFFF);
+  const __m256i inf = _mm256_set1_epi32(0x7F800000);
+  const __m256i quiet = _mm256_set1_epi32(0x400000);
+  const __m256i bias = _mm256_set1_epi32(0x7FFF);
+  const __m256i one = _mm256_set1_epi32(1);
+  std::size_t i = 0;
+  for (; i + 8 <= size; i += 8) {
+    __m128 lo = _mm256_cvtpd_ps(_mm256_loadu_pd(src + i));
+    __m128 hi = _mm256_cvtpd_ps(_mm256_loadu_pd(src + i + 4));
+    __m256i x = _mm256_castps_si256(
+        _mm256_insertf128_ps(_mm256_castps128_ps256(lo), hi, 1));
+    __m256i lsb = _mm256_and_si256(_mm256_srli_epi32(x, 16), one);
+    __m256i rounded = _mm256_add_epi32(x, _mm256_add_epi32(bias, lsb));
+    __m256i nan = _mm256_cmpgt_epi32(_mm256_and_si256(x, abs_mask), inf);
+    __m256i bits = _mm256_srli_epi32(
+        _mm256_blendv_epi8(rounded, _mm256_or_si256(x, quiet), nan), 16);
+    __m128i packed = _mm_packus_epi32(_mm256_castsi256_si128(bits),
+                                      _mm256_extracti128_si256(bits, 1));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), packed);
+  }
+  ToBFloat16Scalar(src + i, dst + i, size - i);
+}
+
+#endif  // ENVPOOL_SIMD_X86
+
+/**
+ * Kernels of `level`, which should not exceed DetectSimdLevel(). The
+ * 3-channel transpose has no wider variant than SSSE3: the pshufb gathers
+ * don't cross the 128-bit lanes of AVX2 / AVX-512 registers. The float casts
+ * need AVX2, the SSSE3 level uses the scalar loops.
+ */
+inline Kernels GetKernels(SimdLevel level) {
+#ifdef ENVPOOL_SIMD_X86
+  switch (level) {
+    case SimdLevel::kAvx512:
+      return {level,         MaxAvx512,     HWCToCHWSsse3,
+              ToFloat32Avx2, ToFloat16Avx2, ToBFloat16Avx2};
+    case SimdLevel::kAvx2:
+      return {level,         MaxAvx2,       HWCToCHWSsse3,
+              ToFloat32Avx2, ToFloat16Avx2, ToBFloat16Avx2};
+    case SimdLevel::kSsse3:
+      return {level,           MaxSse2,         HWCToCHWSsse3,
+              ToFloat32Scalar, ToFloat16Scalar, ToBFloat16Scalar};
+    default:
+      break;
+  }
+#endif
+  return {SimdLevel::kScalar, MaxScalar,       HWCToCHWScalar,
+          ToFloat32Scalar,    ToFloat16Scalar, ToBFloat16Scalar};
+}
+
+/**
+ * DetectSimdLevel(), capped by the `ENVPOOL_SIMD` environment variable.
+ */
+inline SimdLevel DefaultLevel() {
+  SimdLevel level = DetectSimdLevel();
+  const char* env = std::getenv("ENVPOOL_SIMD");
+  if (env != nullptr) {
+    for (int i = 0; i < static_cast<int>(level); ++i) {
+      if (std::strcmp(env, SimdLevelName(static_cast<SimdLevel>(i))) == 0) {
+        return static_cast<SimdLevel>(i);
+      }
+    }
+  }
+  return level;
+}
+
+inline const Kernels& Active() {
+  static const Kernels kKernels = GetKernels(DefaultLevel());
+  return kKernels;
+}
+
+}  // namespace simd
+
+/**
+ * dst[i] = max(dst[i], src[i]), e.g., the maxpool of the last two frames.
+ */
+inline void MaxInplace(uint8_t* dst, const uint8_t* src, std::size_t size) {
+  simd::Active().max(dst, src, size);
+}
+
+/**
+ * Transpose an HWC image with `hw` pixels into CHW, i.e., dst[c][p] =
+ * src[p][c]. `src` and `dst` should not overlap.
+ */
+inline void HWCToCHW(const uint8_t* src, uint8_t* dst, std::size_t hw,
+                     std::size_t channel) {
+  simd::Active().hwc_to_chw(src, dst, hw, channel);
+}
+
+#endif  // ENVPOOL_UTILS_SIMD_H_
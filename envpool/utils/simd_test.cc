@@ -0,0 +1,138 @@
+// Copyright 2022 Garena Online Private Limited
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "envpool/utils/simd.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <vector>
+
+namespace {
+
+std::vector<uint8_t> RandomBytes(std::size_t size, std::mt19937* gen) {
+  std::uniform_int_distribution<int> dist(0, 255);
+  std::vector<uint8_t> data(size);
+  for (auto& d : data) {
+    d = static_cast<uint8_t>(dist(*gen));
+  }
+  return data;
+}
+
+}  // namespace
+
+TEST(SimdTest, Max) {
+  std::mt19937 gen(0);
+  int top = static_cast<int>(DetectSimdLevel());
+  for (int l = 0; l <= top; ++l) {
+    auto kernels = simd::GetKernels(static_cast<SimdLevel>(l));
+    EXPECT_EQ(static_cast<int>(kernels.level), l);
+    // odd sizes exercise the scalar tail
+    for (std::size_t size : {0, 1, 15, 33, 64, 210 * 160 + 7}) {
+      auto dst = RandomBytes(size, &gen);
+      auto src = RandomBytes(size, &gen);
+      auto ref = dst;
+      simd::MaxScalar(ref.data(), src.data(), size);
+      kernels.max(dst.data(), src.data(), size);
+      EXPECT_EQ(dst, ref) << SimdLevelName(kernels.level) << " " << size;
+    }
+  }
+}
+
+TEST(SimdTest, HWCToCHW) {
+  std::mt19937 gen(1);
+  int top = static_cast<int>(DetectSimdLevel());
+  for (int l = 0; l <= top; ++l) {
+    auto kernels = simd::GetKernels(static_cast<SimdLevel>(l));
+    for (std::size_t channel : {1, 3, 4}) {
+      for (std::size_t hw : {1, 16, 17, 84 * 84}) {
+        auto src = RandomBytes(hw * channel, &gen);
+        std::vector<uint8_t> dst(hw * channel);
+        kernels.hwc_to_chw(src.data(), dst.data(), hw, channel);
+        for (std::size_t p = 0; p < hw; ++p) {
+          for (std::size_t c = 0; c < channel; ++c) {
+            ASSERT_EQ(dst[c * hw + p], src[p * channel + c])
+                << SimdLevelName(kernels.level) << " " << channel << " " << hw;
+          }
+        }
+      }
+    }
+  }
+}
+
+TEST(SimdTest, CastFloat) {
+  std::mt19937 gen(2);
+  std::normal_distribution<double> dist(0.0, 100.0);
+  // odd size to cover the tail of the vector loops
+  std::vector<double> src(1003);
+  for (auto& x : src) {
+    x = dist(gen);
+  }
+  double inf = std::numeric_limits<double>::infinity();
+  // nan, inf, overflow, subnormal and ties of both float16 and bfloat16
+  std::vector<double> special = {std::nan(""),
+                                 -std::nan(""),
+                                 inf,
+                                 -inf,
+                                 1e300,
+                                 1e-7,
+                                 1e-40,
+                                 1.0 + std::ldexp(1.0, -8),
+                                 1.0 + std::ldexp(3.0, -8),
+                                 1.0 + std::ldexp(1.0, -11),
+                                 65520.0,
+                                 -0.0};
+  std::copy(special.begin(), special.end(), src.begin() + 5);
+  std::vector<float> ref32(src.size());
+  std::vector<uint16_t> ref16(src.size());
+  std::vector<uint16_t> ref_bf16(src.size());
+  simd::ToFloat32Scalar(src.data(), ref32.data(), src.size());
+  simd::ToFloat16Scalar(src.data(), ref16.data(), src.size());
+  simd::ToBFloat16Scalar(src.data(), ref_bf16.data(), src.size());
+  int top = static_cast<int>(DetectSimdLevel());
+  for (int l = 0; l <= top; ++l) {
+    auto kernels = simd::GetKernels(static_cast<SimdLevel>(l));
+    std::vector<float> f32(src.size());
+    std::vector<uint16_t> f16(src.size());
+    std::vector<uint16_t> bf16(src.size());
+    kernels.to_float32(src.data(), f32.data(), src.size());
+    kernels.to_float16(src.data(), f16.data(), src.size());
+    kernels.to_bfloat16(src.data(), bf16.data(), src.size());
+    for (std::size_t i = 0; i < src.size(); ++i) {
+      // compare the bits, nan != nan
+      ASSERT_EQ(std::memcmp(&f32[i], &ref32[i], sizeof(float)), 0)
+          << SimdLevelName(kernels.level) << " " << src[i];
+    }
+    EXPECT_EQ(f16, ref16) << SimdLevelName(kernels.level);
+    EXPECT_EQ(bf16, ref_bf16) << SimdLevelName(kernels.level);
+  }
+}
+
+TEST(SimdTest, Dispatch) {
+  EXPECT_LE(static_cast<int>(simd::Active().level),
+            static_cast<int>(DetectSimdLevel()));
+  std::vector<uint8_t> a = {1, 5, 3};
+  std::vector<uint8_t> b = {4, 2, 6};
+  MaxInplace(a.data(), b.data(), a.size());
+  EXPECT_EQ(a, std::vector<uint8_t>({4, 5, 6}));
+  std::vector<uint8_t> rgb = {1, 2, 3, 4, 5, 6};
+  std::vector<uint8_t> chw(6);
+  HWCToCHW(rgb.data(), chw.data(), 2, 3);
+  EXPECT_EQ(chw, std::vector<uint8_t>({1, 4, 2, 5, 3, 6}));
+}
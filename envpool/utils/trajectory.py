@@ -0,0 +1,69 @@
+# Copyright 2022 Garena Online Private Limited
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+"""Reader of the trajectory shards written with ``trajectory_dir``."""
+
+import json
+import os
+from typing import Tuple
+
+import numpy as np
+
+HEADER_SIZE = 64
+MAGIC = int.from_bytes(b"ENVPTRAJ", "little")
+EPISODE_DTYPE = np.dtype(
+  [
+    ("env_id", "<i4"),
+    ("episode", "<i4"),
+    ("length", "<i4"),
+    ("return", "<f4"),
+    ("last_record", "<u8"),
+  ]
+)
+
+
+def record_dtype(trajectory_dir: str) -> np.dtype:
+  """The structured dtype of a record, from ``meta.json``."""
+  with open(os.path.join(trajectory_dir, "meta.json")) as f:
+    meta = json.load(f)
+  if any(field["dtype"] == "bfloat16" for field in meta["fields"]):
+    import ml_dtypes  # noqa: F401
+  return np.dtype(
+    {
+      "names": [field["name"] for field in meta["fields"]],
+      "formats":
+        [(field["dtype"], tuple(field["shape"])) for field in meta["fields"]],
+      "offsets": [field["offset"] for field in meta["fields"]],
+      "itemsize": meta["record_size"],
+    }
+  )
+
+
+def load_shard(path: str) -> Tuple[np.ndarray, np.ndarray]:
+  """Map the shard ``path`` (a ``.traj`` file) without copying.
+
+  It returns the records as a structured array, and the episodes that end
+  in this shard (``EPISODE_DTYPE``) from the ``.index`` file next to it.
+  """
+  header = np.fromfile(path, dtype="<u8", count=HEADER_SIZE // 8)
+  if header[0] != MAGIC:
+    raise ValueError(f"{path} is not an envpool trajectory shard.")
+  dtype = record_dtype(os.path.dirname(path) or ".")
+  records = np.memmap(
+    path, dtype=dtype, mode="r", offset=int(header[2]), shape=(int(header[4]),)
+  )
+  index = os.path.splitext(path)[0] + ".index"
+  episodes = np.fromfile(index, dtype=EPISODE_DTYPE) if os.path.exists(
+    index
+  ) else np.zeros(0, EPISODE_DTYPE)
+  return records, episodes
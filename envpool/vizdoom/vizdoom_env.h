@@ -17,7 +17,6 @@
 #ifndef ENVPOOL_VIZDOOM_VIZDOOM_ENV_H_
 #define ENVPOOL_VIZDOOM_VIZDOOM_ENV_H_
 
-#include <deque>
 #include <map>
 #include <memory>
 #include <string>
@@ -27,7 +26,8 @@
 
 #include "envpool/core/async_envpool.h"
 #include "envpool/core/env.h"
-#include "envpool/utils/image_process.h"
+#include "envpool/utils/image_pipeline.h"
+#include "envpool/utils/load_cache.h"
 #include "utils.h"
 
 namespace vizdoom {
@@ -40,6 +40,28 @@ std::string MergePath(const std::string& base_path,
   return base_path + "/" + file_path;
 }
 
+/**
+ * The part of a cfg file that the specs depend on.
+ */
+struct CfgInfo {
+  int screen_channels;
+  std::vector<Button> available_buttons;
+};
+
+/**
+ * Parse the cfg file with a DoomGame instance. Since the spec is built every
+ * time a config is passed in, the result is cached per cfg path for the whole
+ * process; different cfgs are parsed concurrently.
+ */
+const CfgInfo& GetCfgInfo(const std::string& cfg_path) {
+  static LoadCache<CfgInfo> cache;
+  return cache.Get(cfg_path, [&] {
+    DoomGame dg;
+    dg.loadConfig(cfg_path);
+    return CfgInfo{dg.getScreenChannels(), dg.getAvailableButtons()};
+  });
+}
+
 class VizdoomEnvFns {
  public:
   static decltype(auto) DefaultConfig() {
@@ -81,10 +103,9 @@ class VizdoomEnvFns {
   }
   template <typename Config>
   static decltype(auto) StateSpec(const Config& conf) {
-    DoomGame dg;
-    dg.loadConfig(conf["cfg_path"_]);
+    int channels = GetCfgInfo(conf["cfg_path"_]).screen_channels;
     return MakeDict(
-        "obs"_.Bind(Spec<uint8_t>({conf["stack_num"_] * dg.getScreenChannels(),
+        "obs"_.Bind(Spec<uint8_t>({conf["stack_num"_] * channels,
                                    conf["img_height"_], conf["img_width"_]},
                                   {0, 255})),
         "info:AMMO2"_.Bind(Spec<double>({-1})),
@@ -106,13 +127,11 @@ class VizdoomEnvFns {
   }
   template <typename Config>
   static decltype(auto) ActionSpec(const Config& conf) {
-    DoomGame dg;
-    dg.loadConfig(conf["cfg_path"_]);
+    const auto& button_list = GetCfgInfo(conf["cfg_path"_]).available_buttons;
     if (!conf["use_combined_action"_]) {
-      return MakeDict("action"_.Bind(Spec<double>(
-          {-1, static_cast<int>(dg.getAvailableButtons().size())})));
+      return MakeDict("action"_.Bind(
+          Spec<double>({-1, static_cast<int>(button_list.size())})));
     }
-    auto button_list = dg.getAvailableButtons();
     std::vector<std::tuple<int, float, float>> delta_config(
         button_string_list.size());
     for (auto& i : conf["delta_button_config"_]) {
@@ -139,8 +158,8 @@ class VizdoomEnv : public Env<VizdoomEnvSpec> {
   //  "DAMAGECOUNT", "DEATHCOUNT", "FRAGCOUNT", "HEALTH", "HITCOUNT",
   //  "KILLCOUNT", "SELECTED_WEAPON", "SELECTED_WEAPON_AMMO", "USER2"});
   std::unique_ptr<DoomGame> dg_;
-  Array raw_buf_;
-  std::deque<Array> stack_buf_;
+  // resize of the channel-first screen -> frame stack
+  ImagePipeline pipeline_;
   std::string lmp_dir_;
   bool save_lmp_, episodic_life_, use_combined_action_, use_inter_area_resize_;
   bool done_;
@@ -196,12 +215,12 @@ class VizdoomEnv : public Env<VizdoomEnvSpec> {
     dg_->setDoomMap(spec.config["map_id"_]);
 
     channel_ = dg_->getScreenChannels();
-    raw_buf_ =
-        Array(FrameSpec({dg_->getScreenHeight(), dg_->getScreenWidth(), 1}));
-    for (int i = 0; i < stack_num_; ++i) {
-      stack_buf_.emplace_back(Array(FrameSpec(
-          {channel_, spec.config["img_height"_], spec.config["img_width"_]})));
-    }
+    pipeline_ = ImagePipeline(dg_->getScreenHeight(), dg_->getScreenWidth(),
+                              channel_, ImagePipeline::Layout::kCHW);
+    pipeline_
+        .Resize(spec.config["img_height"_], spec.config["img_width"_],
+                use_inter_area_resize_)
+        .Stack(stack_num_);
     for (auto i : info_index_) {
       dg_->addAvailableGameVariable(static_cast<GameVariable>(i));
     }
@@ -278,6 +297,30 @@ class VizdoomEnv : public Env<VizdoomEnvSpec> {
 
   bool IsDone() override { return done_; }
 
+  static bool IsHotConfig(const std::string& key) {
+    return key == "max_episode_steps" || key == "frame_skip" ||
+           key == "episodic_life" || key == "use_inter_area_resize" ||
+           key == "weapon_duration";
+  }
+
+  void Reconfigure(const Spec& spec) override {
+    Env<VizdoomEnvSpec>::Reconfigure(spec);
+    max_episode_steps_ = spec.config["max_episode_steps"_];
+    frame_skip_ = spec.config["frame_skip"_];
+    episodic_life_ = spec.config["episodic_life"_];
+    use_inter_area_resize_ = spec.config["use_inter_area_resize"_];
+    pipeline_.SetInterArea(use_inter_area_resize_);
+    weapon_duration_ = spec.config["weapon_duration"_];
+    dg_->setEpisodeTimeout((max_episode_steps_ + 1) * frame_skip_);
+  }
+
+  void Reseed(int seed) override {
+    Env<VizdoomEnvSpec>::Reseed(seed);
+    dg_->setSeed(seed_);
+    // start a new episode, which picks up the new seed
+    elapsed_step_ = max_episode_steps_;
+  }
+
   void Reset() override {
     if (dg_->isEpisodeFinished() || elapsed_step_ >= max_episode_steps_) {
       elapsed_step_ = 0;
@@ -399,29 +442,13 @@ class VizdoomEnv : public Env<VizdoomEnvSpec> {
       reward += weapon_reward_[selected_weapon_];
     }
 
-    Array tgt = std::move(*stack_buf_.begin());
-    auto* ptr = static_cast<uint8_t*>(tgt.Data());
-    stack_buf_.pop_front();
-
-    // get screen
-    auto* raw_ptr = static_cast<uint8_t*>(raw_buf_.Data());
-    std::size_t size = raw_buf_.size;
-    for (int c = 0; c < channel_; ++c) {
-      // gamestate->screenBuffer is channel-first image
-      std::memcpy(raw_ptr, gamestate->screenBuffer->data() + c * size, size);
-      auto slice = tgt[c];
-      Resize(raw_buf_, &slice, use_inter_area_resize_);
-    }
-    size = tgt.size;
-    stack_buf_.emplace_back(tgt);
-    if (is_reset) {
-      for (auto& s : stack_buf_) {
-        auto* ptr_s = static_cast<uint8_t*>(s.Data());
-        if (ptr != ptr_s) {
-          std::memcpy(ptr_s, ptr, size);
-        }
-      }
-    }
+    // gamestate->screenBuffer is channel-first image, resize it in place
+    FrameSpec screen_spec(
+        {channel_, dg_->getScreenHeight(), dg_->getScreenWidth()});
+    pipeline_.Push(
+        Array(screen_spec,
+              reinterpret_cast<char*>(gamestate->screenBuffer->data())),
+        is_reset);
     WriteState(reward);
   }
 
@@ -429,11 +456,7 @@ class VizdoomEnv : public Env<VizdoomEnvSpec> {
     State state = Allocate();
     std::vector<Array> state_array(state);
     state["reward"_] = reward;
-    for (int i = 0; i < stack_num_; ++i) {
-      state["obs"_]
-          .Slice(i * channel_, (i + 1) * channel_)
-          .Assign(stack_buf_[i]);
-    }
+    pipeline_.Write(state["obs"_]);
     // info
     double zero = 0.0;
     std::size_t offset = state_array.size() - gv_info_index_.size();
@@ -0,0 +1,31 @@
+// Copyright 2022 Garena Online Private Limited
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <string>
+
+#include "envpool/core/workload.h"
+#include "envpool/vizdoom/vizdoom_env.h"
+
+using vizdoom::VizdoomEnvPool;
+
+int main(int argc, char** argv) {
+  int num_steps = argc > 1 ? std::stoi(argv[1]) : 5000;
+  for (std::string map : {"D1_basic", "D3_battle"}) {
+    auto config = WorkloadConfig<VizdoomEnvPool>(8);
+    config["cfg_path"_] = "envpool/vizdoom/maps/" + map + ".cfg";
+    config["wad_path"_] = "envpool/vizdoom/maps/" + map + ".wad";
+    RunWorkload<VizdoomEnvPool>(map, config, num_steps);
+  }
+  return 0;
+}
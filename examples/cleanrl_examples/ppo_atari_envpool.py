@@ -205,54 +205,6 @@ def parse_args():
   return args
 
 
-class RecordEpisodeStatistics(gym.Wrapper):
-
-  def __init__(self, env, deque_size=100):
-    super(RecordEpisodeStatistics, self).__init__(env)
-    self.num_envs = getattr(env, "num_envs", 1)
-    self.episode_returns = None
-    self.episode_lengths = None
-    # get if the env has lives
-    self.has_lives = False
-    env.reset()
-    info = env.step(np.zeros(self.num_envs, dtype=int))[-1]
-    if info["lives"].sum() > 0:
-      self.has_lives = True
-      print("env has lives")
-
-  def reset(self, **kwargs):
-    observations = super(RecordEpisodeStatistics, self).reset(**kwargs)
-    self.episode_returns = np.zeros(self.num_envs, dtype=np.float32)
-    self.episode_lengths = np.zeros(self.num_envs, dtype=np.int32)
-    self.lives = np.zeros(self.num_envs, dtype=np.int32)
-    self.returned_episode_returns = np.zeros(self.num_envs, dtype=np.float32)
-    self.returned_episode_lengths = np.zeros(self.num_envs, dtype=np.int32)
-    return observations
-
-  def step(self, action):
-    observations, rewards, dones, infos = super(RecordEpisodeStatistics,
-                                                self).step(action)
-    self.episode_returns += infos["reward"]
-    self.episode_lengths += 1
-    self.returned_episode_returns[:] = self.episode_returns
-    self.returned_episode_lengths[:] = self.episode_lengths
-    all_lives_exhausted = infos["lives"] == 0
-    if self.has_lives:
-      self.episode_returns *= 1 - all_lives_exhausted
-      self.episode_lengths *= 1 - all_lives_exhausted
-    else:
-      self.episode_returns *= 1 - dones
-      self.episode_lengths *= 1 - dones
-    infos["r"] = self.returned_episode_returns
-    infos["l"] = self.returned_episode_lengths
-    return (
-      observations,
-      rewards,
-      dones,
-      infos,
-    )
-
-
 def layer_init(layer, std=2**0.5, bias_const=0.0):
   torch.nn.init.orthogonal_(layer.weight, std)
   torch.nn.init.constant_(layer.bias, bias_const)
@@ -334,7 +286,6 @@ if __name__ == "__main__":
   envs.num_envs = args.num_envs
   envs.single_action_space = envs.action_space
   envs.single_observation_space = envs.observation_space
-  envs = RecordEpisodeStatistics(envs)
   assert isinstance(
     envs.action_space, gym.spaces.Discrete
   ), "only discrete action space is supported"
@@ -388,18 +339,21 @@ if __name__ == "__main__":
         done
       ).to(device)
 
+      # the unclipped return / length of a whole game, tracked by envpool
       for idx, d in enumerate(done):
         if d and info["lives"][idx] == 0:
-          print(f"global_step={global_step}, episodic_return={info['r'][idx]}")
-          avg_returns.append(info["r"][idx])
+          episodic_return = info["episode_raw_return"][idx]
+          print(f"global_step={global_step}, episodic_return={episodic_return}")
+          avg_returns.append(episodic_return)
           writer.add_scalar(
             "charts/avg_episodic_return", np.average(avg_returns), global_step
           )
           writer.add_scalar(
-            "charts/episodic_return", info["r"][idx], global_step
+            "charts/episodic_return", episodic_return, global_step
           )
           writer.add_scalar(
-            "charts/episodic_length", info["l"][idx], global_step
+            "charts/episodic_length", info["episode_raw_length"][idx],
+            global_step
           )
 
     # bootstrap value if not done